@@ -0,0 +1,168 @@
+#ifndef BENCHMARKHARNESS_H
+#define BENCHMARKHARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** Summary of the samples of one phase, in ns; the mean and median exclude outliers, the tail percentiles do not */
+struct PhaseStats {
+    string phase;
+    size_t samples; // kept after outlier rejection
+    size_t outliers;
+    double mean;
+    double median;
+    double p90; // of all samples, outliers included
+    double p99;
+    double medianLow; // 95% confidence interval of the median
+    double medianHigh;
+};
+
+/** @brief Records the duration of every timed call, grouped by phase, with a monotonic nanosecond clock.
+ *
+ * Every call is a sample of its phase, so a phase that runs several times per iteration
+ * (e.g. encrypting four inputs) reports the latency of a single operation.
+ */
+class PhaseTimer {
+
+    public:
+        PhaseTimer() {};
+        ~PhaseTimer() {};
+
+        void time(const string& phase, const function<void()>& operation) {
+            auto start = chrono::steady_clock::now();
+            operation();
+            auto finish = chrono::steady_clock::now();
+            record(phase, chrono::duration<double, nano>(finish - start).count());
+        }
+
+        void record(const string& phase, double nanoseconds) {
+            if (samples.find(phase) == samples.end()) {
+                phases.push_back(phase);
+            }
+            samples[phase].push_back(nanoseconds);
+        }
+
+        /** Returns the phases in the order they were first timed */
+        const vector<string>& getPhases() const {
+            return phases;
+        }
+
+        const vector<double>& getSamples(const string& phase) const {
+            return samples.at(phase);
+        }
+
+    private:
+        vector<string> phases;
+        map<string, vector<double>> samples;
+};
+
+/** @brief Runs a workload repeatedly and summarizes the time of each of its phases.
+ *
+ * The workload is run `warmupIterations` times without being recorded, so that caches, allocators
+ * and lazily built tables are settled, and then `iterations` times. Samples outside Tukey's fences
+ * (`outlierFence` interquartile ranges beyond the quartiles) are rejected as outliers, e.g. those hit
+ * by a context switch, before the mean and median are computed. The p90 and p99 are computed on every
+ * sample, since the slow samples are exactly the tail they report. The confidence interval of the
+ * median comes from the order statistics, so it does not assume normally distributed timings.
+ */
+class BenchmarkHarness {
+
+    public:
+        BenchmarkHarness(int warmupIterations = 2, int iterations = 20, double outlierFence = 1.5)
+            : warmupIterations(warmupIterations), iterations(iterations), outlierFence(outlierFence) {};
+        ~BenchmarkHarness() {};
+
+        vector<PhaseStats> run(const function<void(PhaseTimer&)>& iteration) const {
+            for (int i = 0; i < warmupIterations; i++) {
+                PhaseTimer warmup;
+                iteration(warmup);
+            }
+            PhaseTimer timer;
+            for (int i = 0; i < iterations; i++) {
+                iteration(timer);
+            }
+
+            vector<PhaseStats> stats;
+            for (const string& phase : timer.getPhases()) {
+                stats.push_back(summarize(phase, timer.getSamples(phase)));
+            }
+            return stats;
+        }
+
+        PhaseStats summarize(const string& phase, vector<double> samples) const {
+            sort(samples.begin(), samples.end());
+            size_t total = samples.size();
+            PhaseStats stats{phase, total, 0, 0, 0, 0, 0, 0, 0};
+            if (samples.empty()) {
+                return stats;
+            }
+            stats.p90 = getPercentile(samples, 90);
+            stats.p99 = getPercentile(samples, 99);
+
+            if (samples.size() >= 4) {
+                double q1 = getPercentile(samples, 25);
+                double q3 = getPercentile(samples, 75);
+                double low = q1 - outlierFence * (q3 - q1);
+                double high = q3 + outlierFence * (q3 - q1);
+                samples.erase(remove_if(samples.begin(), samples.end(), [low, high](double sample) {
+                    return sample < low || sample > high;
+                }), samples.end());
+            }
+
+            stats.samples = samples.size();
+            stats.outliers = total - samples.size();
+            for (double sample : samples) {
+                stats.mean += sample;
+            }
+            stats.mean /= samples.size();
+            stats.median = getPercentile(samples, 50);
+
+            // The ranks n/2 -+ 1.96 sqrt(n)/2 bound the median with about 95% confidence
+            double n = samples.size();
+            double halfWidth = 0.98 * sqrt(n);
+            size_t lowRank = static_cast<size_t>(max(0.0, floor(n / 2 - halfWidth)));
+            size_t highRank = static_cast<size_t>(min(n - 1, ceil(n / 2 + halfWidth) - 1));
+            stats.medianLow = samples[lowRank];
+            stats.medianHigh = samples[max(lowRank, highRank)];
+            return stats;
+        }
+
+        /** Prints one row per phase, in ms by default; `unit` is the number of ns in one `unitName` */
+        static void printReport(const vector<PhaseStats>& stats, double unit = 1e6, const string& unitName = "ms") {
+            cout << left << setw(22) << "Phase" << right << setw(8) << "Samples" << setw(9) << "Outliers"
+                << setw(12) << "Median" << setw(24) << "95% CI of median" << setw(12) << "p90" << setw(12) << "p99" << " (" << unitName << ")" << endl;
+            cout << fixed << setprecision(3);
+            for (const PhaseStats& phase : stats) {
+                cout << left << setw(22) << phase.phase << right << setw(8) << phase.samples << setw(9) << phase.outliers
+                    << setw(12) << phase.median / unit
+                    << setw(11) << phase.medianLow / unit << " - " << setw(10) << phase.medianHigh / unit
+                    << setw(12) << phase.p90 / unit << setw(12) << phase.p99 / unit << endl;
+            }
+            cout << defaultfloat << setprecision(6) << endl;
+        }
+
+    private:
+        int warmupIterations;
+        int iterations;
+        double outlierFence;
+
+        /** Interpolates linearly between the closest ranks of the sorted samples */
+        static double getPercentile(const vector<double>& sorted, double percentile) {
+            double rank = percentile / 100 * (sorted.size() - 1);
+            size_t below = static_cast<size_t>(floor(rank));
+            size_t above = min(below + 1, sorted.size() - 1);
+            return sorted[below] + (rank - below) * (sorted[above] - sorted[below]);
+        }
+};
+
+#endif // BENCHMARKHARNESS_H
@@ -0,0 +1,282 @@
+#ifndef CIRCUIT_H
+#define CIRCUIT_H
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** Operations supported by a homomorphic circuit */
+enum class CircuitOp { Input, Sub, Add, Mult, Square, Rotate, Relin, Rescale };
+
+/** @brief A single operation in a circuit. Operands always refer to earlier nodes,
+ * so the node order is a valid evaluation order.
+ */
+struct CircuitNode {
+    CircuitOp op;
+    vector<size_t> operands;
+    int rotation; // number of slots to rotate to the left, only used by Rotate
+    string name; // only used by Input
+};
+
+/** @brief Represents a library-independent homomorphic circuit.
+ *
+ * Workloads are written with `input`, `sub`, `add`, `mult`, `square` and `rotate`.
+ * Products are left unrelinearized and unrescaled; `optimize` removes repeated and
+ * unused nodes and then inserts Relin and Rescale nodes only where they are needed.
+ */
+class Circuit {
+
+    public:
+        Circuit() {};
+        ~Circuit() {};
+
+        size_t input(const string& name) {
+            return addNode(CircuitOp::Input, {}, 0, name);
+        }
+
+        size_t sub(size_t a, size_t b) {
+            return addNode(CircuitOp::Sub, {a, b});
+        }
+
+        size_t add(size_t a, size_t b) {
+            return addNode(CircuitOp::Add, {a, b});
+        }
+
+        size_t mult(size_t a, size_t b) {
+            return addNode(CircuitOp::Mult, {a, b});
+        }
+
+        size_t square(size_t a) {
+            return addNode(CircuitOp::Square, {a});
+        }
+
+        size_t rotate(size_t a, int rotation) {
+            return addNode(CircuitOp::Rotate, {a}, rotation);
+        }
+
+        size_t relin(size_t a) {
+            return addNode(CircuitOp::Relin, {a});
+        }
+
+        size_t rescale(size_t a) {
+            return addNode(CircuitOp::Rescale, {a});
+        }
+
+        void output(size_t a) {
+            outputs.push_back(a);
+        }
+
+        const vector<CircuitNode>& getNodes() const {
+            return nodes;
+        }
+
+        const vector<size_t>& getOutputs() const {
+            return outputs;
+        }
+
+        /** Returns the Input nodes in the order they were declared */
+        vector<size_t> getInputs() const {
+            vector<size_t> inputs;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                if (nodes[i].op == CircuitOp::Input) {
+                    inputs.push_back(i);
+                }
+            }
+            return inputs;
+        }
+
+        /** Returns the multiplicative depth of the circuit */
+        int getDepth() const {
+            vector<int> depths(nodes.size(), 0);
+            int depth = 0;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                for (size_t operand : nodes[i].operands) {
+                    depths[i] = max(depths[i], depths[operand]);
+                }
+                if (nodes[i].op == CircuitOp::Mult || nodes[i].op == CircuitOp::Square) {
+                    depths[i] += 1;
+                }
+            }
+            for (size_t output : outputs) {
+                depth = max(depth, depths[output]);
+            }
+            return depth;
+        }
+
+        /** Runs every pass; `lazyRelin` and `rescale` should reflect what the evaluating backend supports */
+        void optimize(bool lazyRelin, bool rescale) {
+            eliminateCommonSubexpressions();
+            placeMaintenance(lazyRelin, rescale);
+        }
+
+        /** Merges nodes computing the same value, rewrites mult(a, a) as square(a)
+         *  and drops nodes that do not contribute to an output. Inputs are always kept.
+         */
+        void eliminateCommonSubexpressions();
+
+        /** Inserts Relin and Rescale nodes as late as possible:
+         *  a product is only relinearized before it is multiplied or rotated, or when it is an output,
+         *  and only rescaled before it is multiplied, added to a fresh value, or when it is an output.
+         *  Sums of products are therefore relinearized and rescaled once. Operands that end up at different
+         *  levels, e.g. a fresh input and a rescaled product, are left to the backend to align.
+         */
+        void placeMaintenance(bool lazyRelin, bool rescale);
+
+    private:
+        vector<CircuitNode> nodes;
+        vector<size_t> outputs;
+
+        size_t addNode(CircuitOp op, vector<size_t> operands, int rotation = 0, const string& name = "") {
+            nodes.push_back(CircuitNode{op, operands, rotation, name});
+            return nodes.size() - 1;
+        }
+};
+
+inline void Circuit::eliminateCommonSubexpressions() {
+    // Mark the nodes that contribute to an output
+    vector<bool> isLive(nodes.size(), false);
+    for (size_t output : outputs) {
+        isLive[output] = true;
+    }
+    for (size_t i = nodes.size(); i-- > 0;) {
+        if (isLive[i]) {
+            for (size_t operand : nodes[i].operands) {
+                isLive[operand] = true;
+            }
+        }
+    }
+
+    typedef tuple<CircuitOp, vector<size_t>, int, string> NodeKey;
+    map<NodeKey, size_t> seen;
+    vector<size_t> remap(nodes.size());
+    Circuit optimized;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        CircuitNode node = nodes[i];
+        if (!isLive[i] && node.op != CircuitOp::Input) {
+            continue;
+        }
+
+        for (size_t& operand : node.operands) {
+            operand = remap[operand];
+        }
+        if (node.op == CircuitOp::Mult && node.operands[0] == node.operands[1]) {
+            node.op = CircuitOp::Square;
+            node.operands.pop_back();
+        }
+        if (node.op == CircuitOp::Add || node.op == CircuitOp::Mult) {
+            sort(node.operands.begin(), node.operands.end());
+        }
+
+        NodeKey key(node.op, node.operands, node.rotation, node.name);
+        auto iter = seen.find(key);
+        if (iter != seen.end()) {
+            remap[i] = iter->second;
+        } else {
+            remap[i] = optimized.addNode(node.op, node.operands, node.rotation, node.name);
+            seen[key] = remap[i];
+        }
+    }
+
+    for (size_t output : outputs) {
+        optimized.output(remap[output]);
+    }
+    *this = optimized;
+}
+
+inline void Circuit::placeMaintenance(bool lazyRelin, bool rescale) {
+    Circuit placed;
+    vector<size_t> remap(nodes.size());
+
+    // Per node of `placed`: whether it is an unrelinearized product, and its scale degree
+    vector<bool> isRaw;
+    vector<int> scaleDegree;
+    map<size_t, size_t> relinOf;
+    map<size_t, size_t> rescaleOf;
+
+    auto append = [&](CircuitOp op, vector<size_t> operands, int rotation, const string& name, bool raw, int degree) {
+        size_t index = placed.addNode(op, operands, rotation, name);
+        isRaw.push_back(raw);
+        scaleDegree.push_back(degree);
+        return index;
+    };
+
+    auto relinearized = [&](size_t a) {
+        if (!lazyRelin || !isRaw[a]) {
+            return a;
+        }
+        if (relinOf.count(a) == 0) {
+            relinOf[a] = append(CircuitOp::Relin, {a}, 0, "", false, scaleDegree[a]);
+        }
+        return relinOf[a];
+    };
+
+    auto rescaled = [&](size_t a) {
+        if (!rescale || scaleDegree[a] <= 1) {
+            return a;
+        }
+        if (rescaleOf.count(a) == 0) {
+            rescaleOf[a] = append(CircuitOp::Rescale, {a}, 0, "", isRaw[a], 1);
+        }
+        return rescaleOf[a];
+    };
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const CircuitNode& node = nodes[i];
+        vector<size_t> operands;
+        for (size_t operand : node.operands) {
+            operands.push_back(remap[operand]);
+        }
+
+        switch (node.op) {
+            case CircuitOp::Input:
+                remap[i] = append(node.op, operands, 0, node.name, false, 1);
+                break;
+            case CircuitOp::Mult:
+            case CircuitOp::Square: {
+                int degree = 0;
+                for (size_t& operand : operands) {
+                    operand = rescaled(relinearized(operand));
+                    degree += scaleDegree[operand];
+                }
+                if (node.op == CircuitOp::Square) {
+                    degree *= 2;
+                }
+                remap[i] = append(node.op, operands, 0, "", lazyRelin, degree);
+                break;
+            }
+            case CircuitOp::Rotate:
+                operands[0] = relinearized(operands[0]);
+                remap[i] = append(node.op, operands, node.rotation, "", false, scaleDegree[operands[0]]);
+                break;
+            case CircuitOp::Add:
+            case CircuitOp::Sub:
+                // Relinearized first so that a product also multiplied later shares its Relin and Rescale nodes
+                if (scaleDegree[operands[0]] != scaleDegree[operands[1]]) {
+                    operands[0] = rescaled(relinearized(operands[0]));
+                    operands[1] = rescaled(relinearized(operands[1]));
+                }
+                remap[i] = append(node.op, operands, 0, "", isRaw[operands[0]] || isRaw[operands[1]],
+                                  max(scaleDegree[operands[0]], scaleDegree[operands[1]]));
+                break;
+            case CircuitOp::Relin:
+                remap[i] = append(node.op, operands, 0, "", false, scaleDegree[operands[0]]);
+                break;
+            case CircuitOp::Rescale:
+                remap[i] = append(node.op, operands, 0, "", isRaw[operands[0]], 1);
+                break;
+        }
+    }
+
+    for (size_t output : outputs) {
+        placed.output(rescaled(relinearized(remap[output])));
+    }
+    *this = placed;
+}
+
+#endif // CIRCUIT_H
@@ -0,0 +1,223 @@
+#ifndef CIRCUITEXECUTOR_H
+#define CIRCUITEXECUTOR_H
+
+#include <algorithm>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "circuit.h"
+#include "tracer.h"
+
+using namespace std;
+using std::vector;
+
+/** @brief Evaluates a circuit with a backend, running independent nodes concurrently.
+ *
+ * Nodes are grouped into waves by their distance from the inputs; every node of a wave
+ * only depends on earlier waves, so a wave is evaluated on up to `numThreads` threads.
+ * Rotations of the same value within a wave, as in a rotate-and-sum reduction, are
+ * evaluated together with `rotateMany`, so that a backend can hoist the work they share.
+ * A backend provides a `CiphertextType` and the methods `sub`, `add`, `mult`, `square`,
+ * `rotate`, `rotateMany`, `relinearize` and `rescale`, all of which must be safe to call concurrently.
+ */
+template <class Backend>
+class CircuitExecutor {
+
+    public:
+        typedef typename Backend::CiphertextType CiphertextType;
+
+        CircuitExecutor(const Backend* backend, size_t numThreads = thread::hardware_concurrency())
+            : backend(backend), numThreads(max<size_t>(numThreads, 1)) {};
+        ~CircuitExecutor() {};
+
+        /** Returns a copy of the circuit optimized for what the backend supports */
+        Circuit compile(const Circuit& circuit) const {
+            Circuit compiled = circuit;
+            compiled.optimize(backend->supportsLazyRelinearization(), backend->usesRescaling());
+            return compiled;
+        }
+
+        /** Records a span for every node evaluated, on the thread that evaluates it; nullptr disables it */
+        void setTracer(Tracer* tracer) {
+            this->tracer = tracer;
+        }
+
+        /** Evaluates the circuit, binding `inputs` to the Input nodes in declaration order */
+        vector<CiphertextType> execute(const Circuit& circuit, const vector<CiphertextType>& inputs) const;
+
+        static string getOpName(CircuitOp op) {
+            switch (op) {
+                case CircuitOp::Input:
+                    return "input";
+                case CircuitOp::Sub:
+                    return "sub";
+                case CircuitOp::Add:
+                    return "add";
+                case CircuitOp::Mult:
+                    return "mult";
+                case CircuitOp::Square:
+                    return "square";
+                case CircuitOp::Rotate:
+                    return "rotate";
+                case CircuitOp::Relin:
+                    return "relinearize";
+                default:
+                    return "rescale";
+            }
+        }
+
+    private:
+        const Backend* backend;
+        size_t numThreads;
+        Tracer* tracer = nullptr;
+
+        CiphertextType evaluateNode(const CircuitNode& node, const vector<const CiphertextType*>& operandValues) const;
+
+        /** Evaluates a single node, or several rotations of the same operand */
+        vector<CiphertextType> evaluateJob(const vector<CircuitNode>& nodes, const vector<size_t>& job,
+                                           const vector<const CiphertextType*>& operandValues) const;
+
+        /** Splits a wave into jobs: one per node, except for the rotations of the same operand, which share one */
+        static vector<vector<size_t>> getJobs(const vector<CircuitNode>& nodes, const vector<size_t>& wave);
+};
+
+template <class Backend>
+vector<typename Backend::CiphertextType> CircuitExecutor<Backend>::execute(const Circuit& circuit,
+                                                                          const vector<CiphertextType>& inputs) const {
+    const vector<CircuitNode>& nodes = circuit.getNodes();
+    vector<size_t> inputNodes = circuit.getInputs();
+    if (inputNodes.size() != inputs.size()) {
+        throw invalid_argument("Circuit expects " + to_string(inputNodes.size()) + " inputs");
+    }
+
+    // Group the nodes into waves and find the last wave that reads each node
+    vector<size_t> wave(nodes.size(), 0);
+    size_t numWaves = 1;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (size_t operand : nodes[i].operands) {
+            wave[i] = max(wave[i], wave[operand] + 1);
+        }
+        numWaves = max(numWaves, wave[i] + 1);
+    }
+    vector<vector<size_t>> waves(numWaves);
+    vector<size_t> lastUse(wave);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        waves[wave[i]].push_back(i);
+        for (size_t operand : nodes[i].operands) {
+            lastUse[operand] = max(lastUse[operand], wave[i]);
+        }
+    }
+    for (size_t output : circuit.getOutputs()) {
+        lastUse[output] = numWaves;
+    }
+
+    // Inputs are read in place rather than copied into `values`
+    vector<CiphertextType> values(nodes.size());
+    vector<const CiphertextType*> operandValues(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        operandValues[i] = &values[i];
+    }
+    for (size_t i = 0; i < inputNodes.size(); i++) {
+        operandValues[inputNodes[i]] = &inputs[i];
+    }
+
+    for (size_t w = 1; w < numWaves; w++) {
+        vector<vector<size_t>> jobs = getJobs(nodes, waves[w]);
+        for (size_t start = 0; start < jobs.size(); start += numThreads) {
+            size_t end = min(start + numThreads, jobs.size());
+
+            // The last job of each batch runs on the calling thread
+            vector<future<vector<CiphertextType>>> pending;
+            for (size_t j = start; j + 1 < end; j++) {
+                pending.push_back(async(launch::async, &CircuitExecutor<Backend>::evaluateJob, this,
+                                        cref(nodes), cref(jobs[j]), cref(operandValues)));
+            }
+            vector<CiphertextType> last = evaluateJob(nodes, jobs[end - 1], operandValues);
+            for (size_t j = start; j < end; j++) {
+                vector<CiphertextType> results = j + 1 < end ? pending[j - start].get() : move(last);
+                for (size_t k = 0; k < jobs[j].size(); k++) {
+                    values[jobs[j][k]] = move(results[k]);
+                }
+            }
+        }
+
+        // Release intermediate results that no later wave reads
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (lastUse[i] == w && nodes[i].op != CircuitOp::Input) {
+                values[i] = CiphertextType();
+            }
+        }
+    }
+
+    vector<CiphertextType> outputs;
+    for (size_t output : circuit.getOutputs()) {
+        outputs.push_back(*operandValues[output]);
+    }
+    return outputs;
+}
+
+template <class Backend>
+vector<vector<size_t>> CircuitExecutor<Backend>::getJobs(const vector<CircuitNode>& nodes, const vector<size_t>& wave) {
+    vector<vector<size_t>> jobs;
+    map<size_t, size_t> rotationJobOf; // operand -> index in jobs
+    for (size_t i : wave) {
+        if (nodes[i].op != CircuitOp::Rotate) {
+            jobs.push_back({i});
+            continue;
+        }
+        size_t operand = nodes[i].operands[0];
+        auto iter = rotationJobOf.find(operand);
+        if (iter == rotationJobOf.end()) {
+            rotationJobOf[operand] = jobs.size();
+            jobs.push_back({i});
+        } else {
+            jobs[iter->second].push_back(i);
+        }
+    }
+    return jobs;
+}
+
+template <class Backend>
+vector<typename Backend::CiphertextType> CircuitExecutor<Backend>::evaluateJob(const vector<CircuitNode>& nodes, const vector<size_t>& job,
+                                                                              const vector<const CiphertextType*>& operandValues) const {
+    if (job.size() == 1) {
+        return {evaluateNode(nodes[job[0]], operandValues)};
+    }
+    vector<int> rotations;
+    for (size_t i : job) {
+        rotations.push_back(nodes[i].rotation);
+    }
+    Tracer::Span span(tracer, getOpName(CircuitOp::Rotate), "circuit");
+    return backend->rotateMany(*operandValues[nodes[job[0]].operands[0]], rotations);
+}
+
+template <class Backend>
+typename Backend::CiphertextType CircuitExecutor<Backend>::evaluateNode(const CircuitNode& node,
+                                                                        const vector<const CiphertextType*>& operandValues) const {
+    auto operand = [&](size_t index) -> const CiphertextType& {
+        return *operandValues[node.operands[index]];
+    };
+    Tracer::Span span(tracer, getOpName(node.op), "circuit");
+    switch (node.op) {
+        case CircuitOp::Sub:
+            return backend->sub(operand(0), operand(1));
+        case CircuitOp::Add:
+            return backend->add(operand(0), operand(1));
+        case CircuitOp::Mult:
+            return backend->mult(operand(0), operand(1));
+        case CircuitOp::Square:
+            return backend->square(operand(0));
+        case CircuitOp::Rotate:
+            return backend->rotate(operand(0), node.rotation);
+        case CircuitOp::Relin:
+            return backend->relinearize(operand(0));
+        case CircuitOp::Rescale:
+            return backend->rescale(operand(0));
+        default:
+            throw logic_error("Input nodes are bound before execution");
+    }
+}
+
+#endif // CIRCUITEXECUTOR_H
@@ -0,0 +1,180 @@
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** Implementations whose costs scale differently from the synthetic estimates: RNS limbs, or multiprecision coefficients */
+enum class CostFamily { RNS, Poly };
+
+/** Sizes that the cost of the basic operations depends on */
+struct CostShape {
+    size_t ringDimension;
+    double logQ; // bits of the ciphertext modulus
+    size_t limbs; // RNS limbs of the ciphertext modulus, or the cost of one multiprecision coefficient in words
+    size_t specialLimbs; // limbs only used while key switching
+    size_t digits; // key switching digits
+    CostFamily family = CostFamily::RNS;
+};
+
+/** Predicted latencies (in ms) and memory (in bytes) for one parameter set */
+struct CostEstimate {
+    double keyGen; // including the relinearization key
+    double encrypt;
+    double mult; // including relinearization
+    double decrypt;
+    size_t memory; // keys and four fresh ciphertexts
+
+    double getWorkloadTime(size_t encryptions, size_t mults, size_t decryptions) const {
+        return keyGen + encryptions * encrypt + mults * mult + decryptions * decrypt;
+    }
+};
+
+/** @brief Analytic model of the latency and memory of the basic operations of RLWE schemes.
+ *
+ * Every operation is counted in limb-sized NTTs (n log n) and limb-sized pointwise products (n),
+ * whose costs on the host are measured by `calibrate` with a short synthetic benchmark. Key
+ * switching costs grow with the number of digits times the limbs of the extended basis, and
+ * decryption with the square of the limbs for the CRT reconstruction. The synthetic benchmark only
+ * ranks parameter sets: its absolute values can be off by an order of magnitude from the libraries',
+ * so a model that is used against a time limit must first be rescaled with `addObservation` by
+ * times actually measured with the library. Each CostFamily is rescaled on its own, since a
+ * multiprecision implementation is off from the synthetic NTTs by a different factor than an RNS one;
+ * a family that has no observations yet uses the factor of all observations.
+ */
+class CostModel {
+
+    public:
+        CostModel(double nttCost = 0, double mulCost = 0) : nttCost(nttCost), mulCost(mulCost) {};
+        ~CostModel() {};
+
+        /** Measures the cost of NTT butterflies and pointwise modular products on vectors of `n` coefficients */
+        static CostModel calibrate(size_t n = 4096, int repetitions = 5) {
+            const uint64_t q = 998244353;
+            vector<uint64_t> a(n), b(n), w(n);
+            for (size_t i = 0; i < n; i++) {
+                a[i] = (i * 2654435761u) % q;
+                b[i] = (i * 40503u + 1) % q;
+                w[i] = (i * 69069u + 7) % q;
+            }
+
+            double nttTime = -1, mulTime = -1;
+            uint64_t checksum = 0;
+            for (int r = 0; r < repetitions; r++) {
+                auto start = chrono::steady_clock::now();
+                for (size_t len = n / 2; len >= 1; len /= 2) {
+                    for (size_t block = 0; block < n; block += 2 * len) {
+                        for (size_t j = block; j < block + len; j++) {
+                            uint64_t u = a[j];
+                            uint64_t v = a[j + len] * w[len + j - block] % q;
+                            a[j] = u + v >= q ? u + v - q : u + v;
+                            a[j + len] = u >= v ? u - v : u + q - v;
+                        }
+                    }
+                }
+                auto middle = chrono::steady_clock::now();
+                for (size_t i = 0; i < n; i++) {
+                    b[i] = a[i] * b[i] % q;
+                }
+                auto finish = chrono::steady_clock::now();
+                checksum += a[r % n] + b[r % n];
+
+                double ntt = chrono::duration<double, milli>(middle - start).count();
+                double mul = chrono::duration<double, milli>(finish - middle).count();
+                nttTime = nttTime < 0 ? ntt : min(nttTime, ntt);
+                mulTime = mulTime < 0 ? mul : min(mulTime, mul);
+            }
+            volatile uint64_t sink = checksum; // keeps the loops from being optimized away
+            (void) sink;
+
+            return CostModel(nttTime / (n * log2(n)), mulTime / n);
+        }
+
+        CostEstimate estimate(const CostShape& shape) const {
+            double n = shape.ringDimension;
+            double l = shape.limbs;
+            double extended = shape.digits * double(shape.limbs + shape.specialLimbs);
+            double scale = getScale(shape.family);
+            auto ntt = [&](double count) {
+                return scale * count * n * log2(n) * nttCost;
+            };
+            auto mul = [&](double count) {
+                return scale * count * n * mulCost;
+            };
+
+            CostEstimate estimate;
+            estimate.keyGen = ntt(2 * l + extended) + mul(2 * l + 2 * extended);
+            estimate.encrypt = ntt(3 * l) + mul(2 * l);
+            estimate.mult = ntt(extended + 2 * l) + mul(4 * l + 2 * extended);
+            estimate.decrypt = ntt(l) + mul(l + l * l);
+            // 8-byte words: public key (2 l), secret key (l), relinearization key (2 per extended limb), 4 ciphertexts (2 l each)
+            estimate.memory = static_cast<size_t>(8 * n * (11 * l + 2 * extended));
+            return estimate;
+        }
+
+        /** Rescales the family so that its predictions match the measured times on average (geometrically) */
+        void addObservation(CostFamily family, double predicted, double measured) {
+            addObservations(family, {{predicted, measured}});
+        }
+
+        /** Adds measurements of tasks of one family that were all predicted by the model as it is now,
+         *  before any of them rescales it
+         */
+        void addObservations(CostFamily family, const vector<pair<double, double>>& predictedAndMeasured) {
+            double scale = getScale(family);
+            for (const auto& observation : predictedAndMeasured) {
+                if (observation.first > 0 && observation.second > 0) {
+                    double logRatio = log(observation.second / (observation.first / scale));
+                    logRatioSums[family] += logRatio;
+                    observations[family]++;
+                }
+            }
+        }
+
+        /** Returns the factor by which observations have rescaled the synthetic estimates of the family */
+        double getCalibration(CostFamily family) const {
+            return getScale(family);
+        }
+
+        /** Returns the smallest ring dimension that is secure at 128 bits for a modulus of `logQ` bits, following the HE standard */
+        static size_t getMinRingDimension(double logQ) {
+            const vector<pair<size_t, double>> maxLogQ = {{1024, 27}, {2048, 54}, {4096, 109}, {8192, 218}, {16384, 438}, {32768, 881}};
+            for (const auto& entry : maxLogQ) {
+                if (logQ <= entry.second) {
+                    return entry.first;
+                }
+            }
+            return 65536;
+        }
+
+    private:
+        double nttCost; // ms per coefficient and level of an NTT on one limb
+        double mulCost; // ms per coefficient of a pointwise product on one limb
+        map<CostFamily, double> logRatioSums;
+        map<CostFamily, size_t> observations;
+
+        /** Returns the factor of the family, or of all observations if it has none, 1 if there are none at all */
+        double getScale(CostFamily family) const {
+            auto count = observations.find(family);
+            if (count != observations.end() && count->second > 0) {
+                return exp(logRatioSums.at(family) / count->second);
+            }
+            double logRatioSum = 0;
+            size_t total = 0;
+            for (const auto& entry : observations) {
+                logRatioSum += logRatioSums.at(entry.first);
+                total += entry.second;
+            }
+            return total > 0 ? exp(logRatioSum / total) : 1;
+        }
+};
+
+#endif // COSTMODEL_H
@@ -0,0 +1,72 @@
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace std;
+using std::vector;
+
+/** @brief Tells physical cores apart from the SMT (hyper-)threads that share them.
+ *
+ * Two threads of one core share its execution units and caches, so work placed on both interferes
+ * as much as work on a single core would; concurrent benchmarks are placed on physical cores instead.
+ */
+class CpuTopology {
+
+    public:
+        /** Returns one logical CPU per physical core, the lowest-numbered of its SMT siblings,
+         *  or every logical CPU if the topology cannot be read
+         */
+        static vector<size_t> getPhysicalCores() {
+            vector<size_t> cores;
+#ifdef _WIN32
+            DWORD length = 0;
+            GetLogicalProcessorInformation(nullptr, &length);
+            vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+            if (!infos.empty() && GetLogicalProcessorInformation(infos.data(), &length)) {
+                for (const auto& info : infos) {
+                    if (info.Relationship == RelationProcessorCore && info.ProcessorMask != 0) {
+                        size_t cpu = 0;
+                        while (((info.ProcessorMask >> cpu) & 1) == 0) {
+                            cpu++;
+                        }
+                        cores.push_back(cpu);
+                    }
+                }
+            }
+#else
+            size_t logicalCpus = thread::hardware_concurrency();
+            for (size_t cpu = 0; cpu < logicalCpus; cpu++) {
+                // e.g. "0,8" or "0-1"; a core is counted at its first sibling
+                ifstream siblings("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/thread_siblings_list");
+                size_t first;
+                if (!(siblings >> first) || first == cpu) {
+                    cores.push_back(cpu);
+                }
+            }
+#endif
+            if (cores.empty()) {
+                for (size_t cpu = 0; cpu < max(1u, thread::hardware_concurrency()); cpu++) {
+                    cores.push_back(cpu);
+                }
+            }
+            return cores;
+        }
+
+        static size_t getPhysicalCoreCount() {
+            return getPhysicalCores().size();
+        }
+};
+
+#endif // CPUTOPOLOGY_H
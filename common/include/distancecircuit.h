@@ -0,0 +1,43 @@
+#ifndef DISTANCECIRCUIT_H
+#define DISTANCECIRCUIT_H
+
+#include "circuit.h"
+#include "expression.h"
+
+/** (x1 - x2)^2 + (y1 - y2)^2 with inputs x1, y1, x2 and y2 */
+typedef decltype(square(InputExpr<0>() - InputExpr<2>()) + square(InputExpr<1>() - InputExpr<3>())) DistanceSquaredExpression;
+
+static_assert(DistanceSquaredExpression::depth() == 1, "The distance workload should need a single level");
+static_assert(DistanceSquaredExpression::Rotations::size() == 0, "The distance workload should need no rotation keys");
+
+/** Builds the circuit for (x1 - x2)^2 + (y1 - y2)^2 with inputs x1, y1, x2 and y2 */
+inline Circuit buildDistanceSquaredCircuit() {
+    return toCircuit<DistanceSquaredExpression>({"x1", "y1", "x2", "y2"});
+}
+
+/** Builds the circuit summing the first `count` slots of its input x into the first slot, as a balanced tree of
+ *  x + rotate(x, 1) + ... + rotate(x, count - 1). All rotations are of x and in the same wave, so CircuitExecutor
+ *  passes them to the backend together. The backend needs keys for the rotations by 1 to count - 1.
+ */
+inline Circuit buildSlotSumCircuit(int count) {
+    Circuit circuit;
+    size_t x = circuit.input("x");
+    vector<size_t> terms{x};
+    for (int i = 1; i < count; i++) {
+        terms.push_back(circuit.rotate(x, i));
+    }
+    while (terms.size() > 1) {
+        vector<size_t> sums;
+        for (size_t i = 0; i + 1 < terms.size(); i += 2) {
+            sums.push_back(circuit.add(terms[i], terms[i + 1]));
+        }
+        if (terms.size() % 2 == 1) {
+            sums.push_back(terms.back());
+        }
+        terms = sums;
+    }
+    circuit.output(terms[0]);
+    return circuit;
+}
+
+#endif // DISTANCECIRCUIT_H
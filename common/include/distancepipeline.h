@@ -0,0 +1,320 @@
+#ifndef DISTANCEPIPELINE_H
+#define DISTANCEPIPELINE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "circuitexecutor.h"
+#include "distancecircuit.h"
+#include "subprocess.h"
+
+using namespace std;
+using std::vector;
+
+/** Outcome of one homomorphic distance computation */
+struct DistanceResult {
+    string library;
+    size_t ringDimension;
+    double expected;
+    double actual;
+    bool correct;
+    double evaluationTime; // in ms, covering only the circuit evaluation
+    size_t resultSize; // in bytes, of the serialized result after compaction
+};
+
+/** @brief Library-independent interface for running the distance workload,
+ * so that the backend can be chosen at runtime for each parameter set.
+ */
+class DistanceRunner {
+
+    public:
+        virtual ~DistanceRunner() {};
+        virtual DistanceResult run(double x1, double y1, double x2, double y2) = 0;
+};
+
+/** @brief Runs the distance workload end to end on a single backend.
+ *
+ * On top of the evaluation methods used by CircuitExecutor, a backend provides
+ * `getLibrary`, `getRingDimension`, `isExact`, `getFixedPointScale`, `generateKeys`,
+ * `encrypt(double)`, `decrypt` (returning the first slot) and `prepareInputs`, which may move
+ * fresh inputs to the lowest level that still fits a circuit of a given depth and a result of
+ * a given magnitude, `compactOutput`, which shrinks the result before it is sent back, and
+ * `getSerializedSize`. Coordinates are multiplied by the fixed-point scale before encryption,
+ * so integer schemes keep the same number of decimal places for every library.
+ */
+template <class Backend>
+class DistancePipeline: public DistanceRunner {
+
+    public:
+        DistancePipeline(unique_ptr<Backend> backend, double tolerance = 0.000001)
+            : backend(move(backend)), tolerance(tolerance) {};
+
+        DistanceResult run(double x1, double y1, double x2, double y2) override {
+            double fixedPointScale = backend->getFixedPointScale();
+            vector<double> coords = {x1, y1, x2, y2};
+            for (double& coord : coords) {
+                coord *= fixedPointScale;
+                if (backend->isExact()) {
+                    coord = round(coord);
+                }
+            }
+
+            backend->generateKeys();
+            vector<typename Backend::CiphertextType> inputs;
+            for (double coord : coords) {
+                inputs.push_back(backend->encrypt(coord));
+            }
+
+            CircuitExecutor<Backend> executor(backend.get());
+            Circuit circuit = executor.compile(buildDistanceSquaredCircuit());
+
+            // (x1 - x2)^2 + (y1 - y2)^2 is at most 2 * (2 * max |coord|)^2
+            double maxCoord = 0;
+            for (double coord : coords) {
+                maxCoord = max(maxCoord, abs(coord));
+            }
+            backend->prepareInputs(inputs, circuit.getDepth(), 8 * maxCoord * maxCoord);
+
+            auto start = chrono::steady_clock::now();
+            auto outputs = executor.execute(circuit, inputs);
+            auto finish = chrono::steady_clock::now();
+
+            backend->compactOutput(outputs[0], 8 * maxCoord * maxCoord);
+
+            double actual = backend->decrypt(outputs[0]);
+            double expected = pow(coords[0] - coords[2], 2) + pow(coords[1] - coords[3], 2);
+            bool correct = backend->isExact() ? (llround(actual) == llround(expected)) : (abs(actual - expected) < tolerance);
+
+            double resultScale = fixedPointScale * fixedPointScale;
+            return DistanceResult{backend->getLibrary(), backend->getRingDimension(), expected / resultScale, actual / resultScale,
+                                  correct, chrono::duration<double, milli>(finish - start).count(),
+                                  backend->getSerializedSize(outputs[0])};
+        }
+
+    private:
+        unique_ptr<Backend> backend;
+        double tolerance;
+};
+
+/** @brief Runs the distance workload on a parameter set of the other library, in its binary.
+ *
+ * PALISADE and SEAL are built as separate binaries (C++14 against PALISADE, C++17 against SEAL),
+ * so the sets of the other library are run by its binary with `--unified-task <name> x1 y1 x2 y2`,
+ * which prints the result as a single line (see reportResult). Its sets are listed with
+ * `--list-backends` (see reportParamSetName).
+ */
+class RemoteDistanceRunner: public DistanceRunner {
+
+    public:
+        RemoteDistanceRunner(const string& executable, const string& paramSetName)
+            : executable(executable), paramSetName(paramSetName) {};
+
+        DistanceResult run(double x1, double y1, double x2, double y2) override {
+            ostringstream command;
+            command.precision(17);
+            command << "\"" << executable << "\" --unified-task \"" << paramSetName << "\" " << x1 << " " << y1 << " " << x2 << " " << y2;
+            string output;
+            if (!Subprocess::run(command.str(), output)) {
+                throw runtime_error("Could not start " + executable);
+            }
+
+            DistanceResult result;
+            if (!parseResult(output, result)) {
+                throw runtime_error(executable + " did not report a result for " + paramSetName);
+            }
+            return result;
+        }
+
+        /** Reads the result that reportResult printed somewhere in `output`; returns false if there is none */
+        static bool parseResult(const string& output, DistanceResult& result) {
+            istringstream lines(output);
+            string line;
+            while (getline(lines, line)) {
+                istringstream fields(line);
+                string tag;
+                if (fields >> tag && tag == "UNIFIED_RESULT" && fields >> result.library >> result.ringDimension >> result.expected
+                    >> result.actual >> result.correct >> result.evaluationTime >> result.resultSize) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Returns the names of the sets that `executable` registers, or none if it could not be run */
+        static vector<string> getParamSetNames(const string& executable) {
+            vector<string> names;
+            string output;
+            if (!Subprocess::run("\"" + executable + "\" --list-backends", output)) {
+                return names;
+            }
+            istringstream lines(output);
+            string line;
+            const string tag = "BACKEND ";
+            while (getline(lines, line)) {
+                if (line.compare(0, tag.size(), tag) == 0) {
+                    names.push_back(line.substr(tag.size()));
+                }
+            }
+            return names;
+        }
+
+        /** Prints the line that parseResult reads a result from */
+        static void reportResult(const DistanceResult& result) {
+            streamsize precision = cout.precision(17);
+            cout << "UNIFIED_RESULT " << result.library << " " << result.ringDimension << " " << result.expected << " " << result.actual
+                 << " " << result.correct << " " << result.evaluationTime << " " << result.resultSize << endl;
+            cout.precision(precision);
+        }
+
+        /** Prints the line that `getParamSetNames` reads a set from */
+        static void reportParamSetName(const string& paramSetName) {
+            cout << "BACKEND " << paramSetName << endl;
+        }
+
+    private:
+        string executable;
+        string paramSetName;
+};
+
+/** @brief Maps parameter set names to the backend that should run them.
+ *
+ * Each binary registers the sets of its own library, run in process with DistancePipeline, and may
+ * register those of the other library's binary, run with RemoteDistanceRunner. Names are prefixed
+ * with the library so that the sets of both libraries can share a registry.
+ */
+class BackendRegistry {
+
+    public:
+        typedef function<unique_ptr<DistanceRunner>()> Factory;
+
+        void add(const string& paramSetName, Factory factory) {
+            factories[paramSetName] = factory;
+        }
+
+        unique_ptr<DistanceRunner> create(const string& paramSetName) const {
+            auto iter = factories.find(paramSetName);
+            if (iter == factories.end()) {
+                throw out_of_range("No backend registered for parameter set " + paramSetName);
+            }
+            return iter->second();
+        }
+
+        vector<string> getParamSetNames() const {
+            vector<string> names;
+            for (const auto& entry : factories) {
+                names.push_back(entry.first);
+            }
+            return names;
+        }
+
+    private:
+        map<string, Factory> factories;
+};
+
+/** Registers every set that the binary of the other library lists, to be run by it; returns their names */
+inline vector<string> registerRemoteBackends(BackendRegistry& registry, const string& executable) {
+    vector<string> names = RemoteDistanceRunner::getParamSetNames(executable);
+    for (const string& name : names) {
+        registry.add(name, [executable, name]() {
+            return unique_ptr<DistanceRunner>(new RemoteDistanceRunner(executable, name));
+        });
+    }
+    return names;
+}
+
+/** @brief Routes the distance workload of each ring dimension to the parameter set, of either library,
+ * that computes it fastest.
+ *
+ * Every candidate set is run `trials` times; among those whose results are all correct, the one with the
+ * lowest median evaluation time wins its ring dimension.
+ */
+class BackendRouter {
+
+    public:
+        struct Route {
+            string paramSetName;
+            string library;
+            double evaluationTime; // median, in ms
+            vector<pair<string, double>> alternatives; // the other correct sets of the ring dimension, with their median times
+        };
+
+        BackendRouter(size_t trials = 3) : trials(max<size_t>(trials, 1)) {};
+
+        void measure(const BackendRegistry& registry, const vector<string>& paramSetNames, double x1, double y1, double x2, double y2) {
+            map<size_t, vector<Route>> candidates;
+            for (const string& paramSetName : paramSetNames) {
+                vector<double> times;
+                size_t ringDimension = 0;
+                string library;
+                bool correct = true;
+                try {
+                    for (size_t trial = 0; trial < trials && correct; trial++) {
+                        DistanceResult result = registry.create(paramSetName)->run(x1, y1, x2, y2);
+                        correct = result.correct;
+                        ringDimension = result.ringDimension;
+                        library = result.library;
+                        times.push_back(result.evaluationTime);
+                    }
+                } catch (const exception& e) {
+                    cout << "Skipping " << paramSetName << ": " << e.what() << endl;
+                    continue;
+                }
+                if (!correct) {
+                    cout << "Skipping " << paramSetName << ": incorrect result" << endl;
+                    continue;
+                }
+                sort(times.begin(), times.end());
+                candidates[ringDimension].push_back(Route{paramSetName, library, times[times.size() / 2], {}});
+            }
+
+            routes.clear();
+            for (auto& entry : candidates) {
+                vector<Route>& sets = entry.second;
+                stable_sort(sets.begin(), sets.end(), [](const Route& a, const Route& b) { return a.evaluationTime < b.evaluationTime; });
+                Route route = sets[0];
+                for (size_t i = 1; i < sets.size(); i++) {
+                    route.alternatives.push_back({sets[i].paramSetName, sets[i].evaluationTime});
+                }
+                routes[entry.first] = route;
+            }
+        }
+
+        /** Returns the routes by ring dimension */
+        const map<size_t, Route>& getRoutes() const {
+            return routes;
+        }
+
+        /** Returns the name of the set the workload of `ringDimension` is routed to */
+        const string& route(size_t ringDimension) const {
+            auto iter = routes.find(ringDimension);
+            if (iter == routes.end()) {
+                throw out_of_range("No parameter set measured for ring dimension " + to_string(ringDimension));
+            }
+            return iter->second.paramSetName;
+        }
+
+        void printRoutes() const {
+            for (const auto& entry : routes) {
+                const Route& route = entry.second;
+                cout << "n = " << entry.first << ": " << route.paramSetName << " (" << route.evaluationTime << "ms)";
+                for (const auto& alternative : route.alternatives) {
+                    cout << ", over " << alternative.first << " (" << alternative.second << "ms)";
+                }
+                cout << endl;
+            }
+        }
+
+    private:
+        size_t trials;
+        map<size_t, Route> routes;
+};
+
+#endif // DISTANCEPIPELINE_H
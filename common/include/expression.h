@@ -0,0 +1,193 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "circuit.h"
+
+using namespace std;
+using std::vector;
+
+/** @brief Compile-time list of rotation indices */
+template <int... Rotations>
+struct RotationList {
+    static constexpr size_t size() {
+        return sizeof...(Rotations);
+    }
+
+    /** Returns the distinct rotation indices in increasing order */
+    static vector<int> toVector() {
+        vector<int> rotations = {Rotations...};
+        sort(rotations.begin(), rotations.end());
+        rotations.erase(unique(rotations.begin(), rotations.end()), rotations.end());
+        return rotations;
+    }
+};
+
+template <class A, class B>
+struct ConcatRotations;
+
+template <int... A, int... B>
+struct ConcatRotations<RotationList<A...>, RotationList<B...>> {
+    typedef RotationList<A..., B...> type;
+};
+
+/** @brief Base of every expression, so that the operators below only apply to expressions.
+ *
+ * An expression is a type describing a homomorphic workload: its multiplicative depth, the
+ * rotations it needs and the number of inputs are all known at compile time, so they can
+ * be checked with `static_assert` and used to pick parameters and keys before anything is
+ * encrypted. `toCircuit` turns an expression into a Circuit that can be run on any backend.
+ */
+template <class Derived>
+struct Expression {};
+
+/** The `Index`th input of the workload */
+template <size_t Index>
+struct InputExpr: Expression<InputExpr<Index>> {
+    typedef RotationList<> Rotations;
+
+    static constexpr size_t depth() {
+        return 0;
+    }
+
+    static constexpr size_t inputCount() {
+        return Index + 1;
+    }
+
+    static size_t addTo(Circuit& /*circuit*/, const vector<size_t>& inputs) {
+        return inputs[Index];
+    }
+};
+
+template <class L, class R>
+struct SubExpr: Expression<SubExpr<L, R>> {
+    typedef typename ConcatRotations<typename L::Rotations, typename R::Rotations>::type Rotations;
+
+    static constexpr size_t depth() {
+        return L::depth() > R::depth() ? L::depth() : R::depth();
+    }
+
+    static constexpr size_t inputCount() {
+        return L::inputCount() > R::inputCount() ? L::inputCount() : R::inputCount();
+    }
+
+    static size_t addTo(Circuit& circuit, const vector<size_t>& inputs) {
+        size_t a = L::addTo(circuit, inputs);
+        size_t b = R::addTo(circuit, inputs);
+        return circuit.sub(a, b);
+    }
+};
+
+template <class L, class R>
+struct AddExpr: Expression<AddExpr<L, R>> {
+    typedef typename ConcatRotations<typename L::Rotations, typename R::Rotations>::type Rotations;
+
+    static constexpr size_t depth() {
+        return L::depth() > R::depth() ? L::depth() : R::depth();
+    }
+
+    static constexpr size_t inputCount() {
+        return L::inputCount() > R::inputCount() ? L::inputCount() : R::inputCount();
+    }
+
+    static size_t addTo(Circuit& circuit, const vector<size_t>& inputs) {
+        size_t a = L::addTo(circuit, inputs);
+        size_t b = R::addTo(circuit, inputs);
+        return circuit.add(a, b);
+    }
+};
+
+template <class L, class R>
+struct MultExpr: Expression<MultExpr<L, R>> {
+    typedef typename ConcatRotations<typename L::Rotations, typename R::Rotations>::type Rotations;
+
+    static constexpr size_t depth() {
+        return 1 + (L::depth() > R::depth() ? L::depth() : R::depth());
+    }
+
+    static constexpr size_t inputCount() {
+        return L::inputCount() > R::inputCount() ? L::inputCount() : R::inputCount();
+    }
+
+    static size_t addTo(Circuit& circuit, const vector<size_t>& inputs) {
+        size_t a = L::addTo(circuit, inputs);
+        size_t b = R::addTo(circuit, inputs);
+        return circuit.mult(a, b);
+    }
+};
+
+template <class E>
+struct SquareExpr: Expression<SquareExpr<E>> {
+    typedef typename E::Rotations Rotations;
+
+    static constexpr size_t depth() {
+        return 1 + E::depth();
+    }
+
+    static constexpr size_t inputCount() {
+        return E::inputCount();
+    }
+
+    static size_t addTo(Circuit& circuit, const vector<size_t>& inputs) {
+        return circuit.square(E::addTo(circuit, inputs));
+    }
+};
+
+/** Rotates the slots of `E` to the left by `Rotation` */
+template <class E, int Rotation>
+struct RotateExpr: Expression<RotateExpr<E, Rotation>> {
+    typedef typename ConcatRotations<typename E::Rotations, RotationList<Rotation>>::type Rotations;
+
+    static constexpr size_t depth() {
+        return E::depth();
+    }
+
+    static constexpr size_t inputCount() {
+        return E::inputCount();
+    }
+
+    static size_t addTo(Circuit& circuit, const vector<size_t>& inputs) {
+        return circuit.rotate(E::addTo(circuit, inputs), Rotation);
+    }
+};
+
+template <class L, class R>
+constexpr SubExpr<L, R> operator-(const Expression<L>&, const Expression<R>&) {
+    return SubExpr<L, R>();
+}
+
+template <class L, class R>
+constexpr AddExpr<L, R> operator+(const Expression<L>&, const Expression<R>&) {
+    return AddExpr<L, R>();
+}
+
+template <class L, class R>
+constexpr MultExpr<L, R> operator*(const Expression<L>&, const Expression<R>&) {
+    return MultExpr<L, R>();
+}
+
+template <class E>
+constexpr SquareExpr<E> square(const Expression<E>&) {
+    return SquareExpr<E>();
+}
+
+template <int Rotation, class E>
+constexpr RotateExpr<E, Rotation> rotate(const Expression<E>&) {
+    return RotateExpr<E, Rotation>();
+}
+
+/** Builds the circuit of an expression, naming its inputs after `inputNames` */
+template <class E>
+Circuit toCircuit(const vector<string>& inputNames) {
+    Circuit circuit;
+    vector<size_t> inputs;
+    for (size_t i = 0; i < E::inputCount(); i++) {
+        inputs.push_back(circuit.input(i < inputNames.size() ? inputNames[i] : "input" + to_string(i)));
+    }
+    circuit.output(E::addTo(circuit, inputs));
+    return circuit;
+}
+
+#endif // EXPRESSION_H
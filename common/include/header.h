@@ -0,0 +1,20 @@
+#ifndef HEADER_H
+#define HEADER_H
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/** Prints a boxed "| <action> <scheme> <set> parameter set... |" banner before the output of a parameter set,
+ *  followed by a blank line
+ */
+inline void printHeader(const string& schemeName, const string& setNumber, const string& action = "Running") {
+    string title = "| " + action + " " + schemeName + " " + setNumber + " parameter set... |";
+    string border(title.length(), '-');
+    cout << border << endl;
+    cout << title << endl;
+    cout << border << "\n" << endl;
+}
+
+#endif // HEADER_H
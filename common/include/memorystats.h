@@ -0,0 +1,82 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/** @brief Resident set size (RSS) of this process, in bytes.
+ *
+ * The peak is the high-water mark since the process started or since the last successful
+ * `resetPeakRSS`, so resetting it at the start of every phase gives the peak of that phase.
+ * Only Linux (4.0 and later) can reset it; elsewhere the peak covers every earlier phase too.
+ */
+class MemoryStats {
+
+    public:
+        static size_t getCurrentRSS() {
+#ifdef _WIN32
+            PROCESS_MEMORY_COUNTERS counters;
+            return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+            ifstream statm("/proc/self/statm");
+            size_t pages = 0, residentPages = 0;
+            if (statm >> pages >> residentPages) {
+                return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            }
+            return 0;
+#endif
+        }
+
+        static size_t getPeakRSS() {
+#ifdef _WIN32
+            PROCESS_MEMORY_COUNTERS counters;
+            return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+            ifstream status("/proc/self/status");
+            string line;
+            while (getline(status, line)) {
+                if (line.compare(0, 6, "VmHWM:") == 0) {
+                    size_t kilobytes = 0;
+                    istringstream(line.substr(6)) >> kilobytes;
+                    return kilobytes * 1024;
+                }
+            }
+            // Without procfs, getrusage reports the peak since the process started (in kB on Linux, bytes on macOS)
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+            return static_cast<size_t>(usage.ru_maxrss);
+#else
+            return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+        }
+
+        /** Resets the peak to the current RSS; returns false if the platform does not support it */
+        static bool resetPeakRSS() {
+#ifdef __linux__
+            ofstream clearRefs("/proc/self/clear_refs");
+            clearRefs << "5";
+            clearRefs.flush();
+            return static_cast<bool>(clearRefs);
+#else
+            return false;
+#endif
+        }
+};
+
+#endif // MEMORYSTATS_H
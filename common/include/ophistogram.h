@@ -0,0 +1,117 @@
+#ifndef OPHISTOGRAM_H
+#define OPHISTOGRAM_H
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** @brief Distribution of the latencies of one library operation, in µs.
+ *
+ * Samples are counted in power-of-two buckets: bucket 0 holds samples under 2µs and bucket i
+ * holds samples in [2^i, 2^{i+1}) µs, so operations from additions to key generation fit in a
+ * few dozen counters without keeping every sample.
+ */
+class OpHistogram {
+
+    public:
+        OpHistogram() : count(0), total(0), minimum(0), maximum(0) {};
+        ~OpHistogram() {};
+
+        void add(double microseconds) {
+            size_t bucket = microseconds < 2 ? 0 : static_cast<size_t>(floor(log2(microseconds)));
+            if (bucket >= buckets.size()) {
+                buckets.resize(bucket + 1, 0);
+            }
+            buckets[bucket]++;
+            minimum = count == 0 ? microseconds : min(minimum, microseconds);
+            maximum = count == 0 ? microseconds : max(maximum, microseconds);
+            count++;
+            total += microseconds;
+        }
+
+        size_t getCount() const {
+            return count;
+        }
+
+        double getTotal() const {
+            return total;
+        }
+
+        double getMean() const {
+            return count > 0 ? total / count : 0;
+        }
+
+        double getMin() const {
+            return minimum;
+        }
+
+        double getMax() const {
+            return maximum;
+        }
+
+        /** Returns the number of samples in each power-of-two bucket */
+        const vector<size_t>& getBuckets() const {
+            return buckets;
+        }
+
+    private:
+        size_t count;
+        double total;
+        double minimum;
+        double maximum;
+        vector<size_t> buckets;
+};
+
+/** @brief Latency histograms of the operations run on one parameter set, keyed by operation name */
+class OpProfile {
+
+    public:
+        OpProfile() {};
+        ~OpProfile() {};
+
+        void add(const string& operation, double microseconds) {
+            histograms[operation].add(microseconds);
+        }
+
+        const map<string, OpHistogram>& getHistograms() const {
+            return histograms;
+        }
+
+        /** Prints one row per operation, with its share of the total time and the non-empty buckets as "2^i:count" */
+        void print() const {
+            double total = 0;
+            for (const auto& entry : histograms) {
+                total += entry.second.getTotal();
+            }
+
+            cout << left << setw(22) << "Operation" << right << setw(8) << "Count" << setw(12) << "Total (ms)" << setw(8) << "Share"
+                << setw(12) << "Mean (us)" << setw(12) << "Min (us)" << setw(12) << "Max (us)" << "  Histogram (us)" << endl;
+            cout << fixed << setprecision(1);
+            for (const auto& entry : histograms) {
+                const OpHistogram& histogram = entry.second;
+                cout << left << setw(22) << entry.first << right << setw(8) << histogram.getCount()
+                    << setw(12) << histogram.getTotal() / 1000 << setw(7) << (total > 0 ? 100 * histogram.getTotal() / total : 0) << "%"
+                    << setw(12) << histogram.getMean() << setw(12) << histogram.getMin() << setw(12) << histogram.getMax() << " ";
+                const vector<size_t>& buckets = histogram.getBuckets();
+                for (size_t i = 0; i < buckets.size(); i++) {
+                    if (buckets[i] > 0) {
+                        cout << " 2^" << i << ":" << buckets[i];
+                    }
+                }
+                cout << endl;
+            }
+            cout << defaultfloat << setprecision(6) << endl;
+        }
+
+    private:
+        map<string, OpHistogram> histograms;
+};
+
+#endif // OPHISTOGRAM_H
@@ -0,0 +1,133 @@
+#ifndef PARAMAUTOTUNER_H
+#define PARAMAUTOTUNER_H
+
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "distancepipeline.h"
+
+using namespace std;
+using std::vector;
+
+/** One configuration in the search space of the autotuner; `name` should be the code that builds `param` */
+template <class ParamType>
+struct AutotuneCandidate {
+    string name;
+    ParamType param;
+};
+
+/** Measurements of one candidate */
+struct AutotuneResult {
+    string name;
+    bool feasible; // false if the library rejected the parameters
+    bool correct; // whether the result was within the precision target
+    size_t ringDimension;
+    double error;
+    double avgTime; // in ms, covering context generation, key generation, encryption, evaluation and decryption
+    int samples;
+};
+
+/** @brief Searches a space of candidate parameter sets for the fastest one that runs the distance
+ * workload within a precision target, so that new workloads do not need hand-curated sets.
+ *
+ * Every candidate is built into a DistanceRunner and run end to end. Candidates the library rejects
+ * (e.g. insecure ring dimensions or moduli too large for the security level) are infeasible, and
+ * candidates whose result is further from the expected distance than the precision target are
+ * incorrect; neither is timed further. A correct candidate is run `sampleNum` times, unless its
+ * first run already takes `pruneFactor` times the best average found so far, so listing the
+ * candidates from the cheapest up keeps the search short.
+ */
+template <class ParamType>
+class ParamAutotuner {
+
+    public:
+        typedef function<unique_ptr<DistanceRunner>(const ParamType&)> RunnerFactory;
+
+        ParamAutotuner(RunnerFactory makeRunner, double precision, int sampleNum = 3, double pruneFactor = 2)
+            : makeRunner(makeRunner), precision(precision), sampleNum(sampleNum > 0 ? sampleNum : 1), pruneFactor(pruneFactor) {};
+        ~ParamAutotuner() {};
+
+        /** Returns the index of the fastest correct candidate; throws runtime_error if no candidate is correct */
+        size_t tune(const vector<AutotuneCandidate<ParamType>>& candidates, double x1, double y1, double x2, double y2) {
+            results.clear();
+            bool found = false;
+            size_t best = 0;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                results.push_back(measure(candidates[i], x1, y1, x2, y2, found ? results[best].avgTime : 0));
+                const AutotuneResult& result = results.back();
+                if (result.correct && result.samples == sampleNum && (!found || result.avgTime < results[best].avgTime)) {
+                    found = true;
+                    best = i;
+                }
+            }
+            if (!found) {
+                throw runtime_error("No candidate runs the workload within a precision of " + to_string(precision));
+            }
+            return best;
+        }
+
+        /** Returns the measurements of the last search, in the order of the candidates */
+        const vector<AutotuneResult>& getResults() const {
+            return results;
+        }
+
+        void printResults() const {
+            for (const AutotuneResult& result : results) {
+                cout << result.name << ": ";
+                if (!result.feasible) {
+                    cout << "rejected by the library" << endl;
+                } else if (!result.correct) {
+                    cout << "incorrect (error " << result.error << ")" << endl;
+                } else {
+                    cout << "n = " << result.ringDimension << ", error " << result.error << ", " << result.avgTime << "ms"
+                        << (result.samples < sampleNum ? " (pruned)" : "") << endl;
+                }
+            }
+        }
+
+    private:
+        RunnerFactory makeRunner;
+        double precision;
+        int sampleNum;
+        double pruneFactor;
+        vector<AutotuneResult> results;
+
+        AutotuneResult measure(const AutotuneCandidate<ParamType>& candidate, double x1, double y1, double x2, double y2, double bestTime) const {
+            AutotuneResult result{candidate.name, true, true, 0, 0, 0, 0};
+            double totalTime = 0;
+            while (result.samples < sampleNum) {
+                auto start = chrono::steady_clock::now();
+                DistanceResult distance;
+                try {
+                    distance = makeRunner(candidate.param)->run(x1, y1, x2, y2);
+                } catch (const exception&) {
+                    result.feasible = false;
+                    result.correct = false;
+                    return result;
+                }
+                auto finish = chrono::steady_clock::now();
+
+                result.ringDimension = distance.ringDimension;
+                result.error = max(result.error, abs(distance.actual - distance.expected));
+                if (!(result.error <= precision)) {
+                    result.correct = false;
+                    return result;
+                }
+                totalTime += chrono::duration<double, milli>(finish - start).count();
+                result.samples++;
+                result.avgTime = totalTime / result.samples;
+                if (bestTime > 0 && result.avgTime > pruneFactor * bestTime) {
+                    break;
+                }
+            }
+            return result;
+        }
+};
+
+#endif // PARAMAUTOTUNER_H
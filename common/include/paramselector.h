@@ -0,0 +1,58 @@
+#ifndef PARAMSELECTOR_H
+#define PARAMSELECTOR_H
+
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+using namespace std;
+
+/** @brief Picks the cheapest parameter set that supports a workload of a given multiplicative depth,
+ * so that depth known at compile time (see expression.h) is never over-provisioned by hand.
+ *
+ * Among the sets with at least `depth` levels, the one with the smallest ring dimension wins,
+ * then the one with the fewest levels, then the one with the highest precision; remaining
+ * ties go to the smallest key.
+ */
+template <class ParamType>
+class ParamSelector {
+
+    public:
+        typedef function<size_t(const ParamType&)> Getter;
+
+        ParamSelector(Getter getDepth, Getter getRingDimension, Getter getPrecision = [](const ParamType&) { return 0; })
+            : getDepth(getDepth), getRingDimension(getRingDimension), getPrecision(getPrecision) {};
+        ~ParamSelector() {};
+
+        /** Returns the key of the selected set; throws out_of_range if no set supports the depth */
+        int select(const map<int, ParamType>& paramSets, size_t depth) const {
+            bool found = false;
+            int selected = 0;
+            tuple<size_t, size_t, long long> bestCost;
+            for (const auto& entry : paramSets) {
+                const ParamType& value = entry.second;
+                if (getDepth(value) < depth) {
+                    continue;
+                }
+                auto cost = make_tuple(getRingDimension(value), getDepth(value), -static_cast<long long>(getPrecision(value)));
+                if (!found || cost < bestCost) {
+                    found = true;
+                    selected = entry.first;
+                    bestCost = cost;
+                }
+            }
+            if (!found) {
+                throw out_of_range("No parameter set supports multiplicative depth " + to_string(depth));
+            }
+            return selected;
+        }
+
+    private:
+        Getter getDepth;
+        Getter getRingDimension;
+        Getter getPrecision;
+};
+
+#endif // PARAMSELECTOR_H
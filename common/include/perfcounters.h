@@ -0,0 +1,153 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using std::vector;
+
+/** Hardware event counts over one phase; a count is -1 if its counter could not be opened */
+struct CounterSample {
+    int64_t cycles;
+    int64_t instructions;
+    int64_t cacheMisses; // last level cache
+    int64_t branchMisses;
+
+    /** Instructions per cycle, or 0 if either is unknown */
+    double getIPC() const {
+        return cycles > 0 && instructions >= 0 ? static_cast<double>(instructions) / cycles : 0;
+    }
+
+    /** Cache misses per thousand instructions (MPKI), or 0 if either is unknown */
+    double getCacheMPKI() const {
+        return instructions > 0 && cacheMisses >= 0 ? 1000.0 * cacheMisses / instructions : 0;
+    }
+};
+
+/** @brief Counts cycles, instructions, cache misses and branch misses with Linux `perf_event_open`.
+ *
+ * Only user-space events of this thread, and of the threads it creates after the counters are opened, are
+ * counted, so that it works without privileges (perf_event_paranoid up to 2). Each counter is opened on its own
+ * rather than as a group, so that a counter the CPU or hypervisor does not expose only leaves its own count
+ * unknown; if the kernel multiplexes them, counts are scaled by the time each counter actually ran.
+ * A low IPC along with a high cache MPKI marks a phase as bound by memory rather than by compute.
+ * Elsewhere than on Linux, `isAvailable` is false and every count is -1.
+ */
+class PerfCounters {
+
+    public:
+        PerfCounters() {
+#ifdef __linux__
+            uint64_t configs[CounterNum] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+            for (int i = 0; i < CounterNum; i++) {
+                struct perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[i];
+                attr.disabled = 1;
+                attr.inherit = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+#else
+            for (int i = 0; i < CounterNum; i++) {
+                fds[i] = -1;
+            }
+#endif
+        };
+        ~PerfCounters() {
+#ifdef __linux__
+            for (int i = 0; i < CounterNum; i++) {
+                if (fds[i] >= 0) {
+                    close(fds[i]);
+                }
+            }
+#endif
+        };
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        /** Returns true if at least one counter could be opened */
+        bool isAvailable() const {
+            for (int i = 0; i < CounterNum; i++) {
+                if (fds[i] >= 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Resets the counters and starts counting */
+        void start() {
+#ifdef __linux__
+            for (int i = 0; i < CounterNum; i++) {
+                if (fds[i] >= 0) {
+                    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        /** Stops counting and returns the counts since `start` */
+        CounterSample stop() {
+            int64_t counts[CounterNum];
+            for (int i = 0; i < CounterNum; i++) {
+                counts[i] = -1;
+#ifdef __linux__
+                if (fds[i] < 0) {
+                    continue;
+                }
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                uint64_t values[3]; // count, time enabled, time running
+                if (read(fds[i], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values)) && values[2] > 0) {
+                    counts[i] = static_cast<int64_t>(values[2] < values[1]
+                                                     ? static_cast<double>(values[0]) * values[1] / values[2] : values[0]);
+                }
+#endif
+            }
+            return {counts[0], counts[1], counts[2], counts[3]};
+        }
+
+        /** Prints the counts of every phase of a run, with its IPC and cache MPKI */
+        static void printReport(const vector<pair<string, CounterSample>>& phases) {
+            cout << left << setw(22) << "Phase" << right << setw(16) << "Cycles" << setw(16) << "Instructions" << setw(8) << "IPC"
+                << setw(14) << "Cache misses" << setw(8) << "MPKI" << setw(14) << "Branch misses" << endl;
+            cout << fixed;
+            for (const auto& phase : phases) {
+                const CounterSample& sample = phase.second;
+                cout << left << setw(22) << phase.first << right << setw(16) << formatCount(sample.cycles)
+                    << setw(16) << formatCount(sample.instructions) << setprecision(2) << setw(8) << sample.getIPC()
+                    << setw(14) << formatCount(sample.cacheMisses) << setw(8) << sample.getCacheMPKI()
+                    << setw(14) << formatCount(sample.branchMisses) << endl;
+            }
+            cout << defaultfloat << setprecision(6) << endl;
+        }
+
+    private:
+        static const int CounterNum = 4;
+        int fds[CounterNum];
+
+        static string formatCount(int64_t count) {
+            return count < 0 ? "n/a" : to_string(count);
+        }
+};
+
+#endif // PERFCOUNTERS_H
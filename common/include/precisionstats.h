@@ -0,0 +1,54 @@
+#ifndef PRECISIONSTATS_H
+#define PRECISIONSTATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** @brief Error of the decrypted slots of an approximate scheme (CKKS) against the expected values */
+struct PrecisionStats {
+    double maxError;
+    double meanError;
+
+    /** Returns the number of bits that are correct in every slot, -log2 of the largest error */
+    double getPrecisionBits() const {
+        return maxError > 0 ? -log2(maxError) : numeric_limits<double>::infinity();
+    }
+
+    /** Returns -log2 of the mean error */
+    double getMeanPrecisionBits() const {
+        return meanError > 0 ? -log2(meanError) : numeric_limits<double>::infinity();
+    }
+
+    /** Compares the first `expected.size()` slots of `actual` with `expected` */
+    static PrecisionStats compare(const vector<complex<double>>& expected, const vector<complex<double>>& actual) {
+        PrecisionStats stats{0, 0};
+        size_t count = min(expected.size(), actual.size());
+        for (size_t i = 0; i < count; i++) {
+            double error = abs(expected[i] - actual[i]);
+            stats.maxError = max(stats.maxError, error);
+            stats.meanError += error;
+        }
+        stats.meanError = count > 0 ? stats.meanError / count : 0;
+        return stats;
+    }
+
+    /** Returns `count` distinct points of the unit circle; squaring keeps them on it, so the
+     *  error after any number of squarings is measured against values of the same magnitude
+     */
+    static vector<complex<double>> makeUnitCircleSlots(size_t count) {
+        const double pi = acos(-1);
+        vector<complex<double>> slots(count);
+        for (size_t i = 0; i < count; i++) {
+            slots[i] = polar(1.0, 2 * pi * (i + 0.5) / count);
+        }
+        return slots;
+    }
+};
+
+#endif // PRECISIONSTATS_H
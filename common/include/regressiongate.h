@@ -0,0 +1,426 @@
+#ifndef REGRESSIONGATE_H
+#define REGRESSIONGATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "resultswriter.h"
+
+using namespace std;
+using std::vector;
+
+/** @brief Reads the results files written by ResultsWriter back into RunRecords, in either format.
+ *
+ * Columns and keys are looked up by name, so files of later schema versions can still be read.
+ */
+class ResultsReader {
+
+    public:
+        static vector<RunRecord> read(const string& path) {
+            ifstream file(path);
+            if (!file) {
+                throw runtime_error("Could not open the results file " + path);
+            }
+            return ResultsWriter::isCSVPath(path) ? readCSV(file) : readJSONLines(file);
+        }
+
+    private:
+        static vector<RunRecord> readCSV(istream& file) {
+            vector<RunRecord> records;
+            string line;
+            if (!getline(file, line)) {
+                return records;
+            }
+            vector<string> header = splitCSV(line);
+            map<string, size_t> columns;
+            for (size_t i = 0; i < header.size(); i++) {
+                columns[header[i]] = i;
+            }
+            for (const char* name : {"timestamp", "run", "library", "scheme", "param_set", "phase", "time_ms"}) {
+                if (columns.find(name) == columns.end()) {
+                    throw runtime_error("The results file has no " + string(name) + " column");
+                }
+            }
+
+            // The rows of a run are consecutive and share its timestamp and number
+            string lastRun;
+            while (getline(file, line)) {
+                if (line.empty()) {
+                    continue;
+                }
+                vector<string> fields = splitCSV(line);
+                if (fields.size() < header.size()) {
+                    continue;
+                }
+                auto field = [&](const string& name) {
+                    return fields[columns.at(name)];
+                };
+                string run = field("timestamp") + "," + field("run") + "," + field("library") + "," + field("scheme") + "," + field("param_set");
+                if (records.empty() || run != lastRun) {
+                    RunRecord record = RunRecord();
+                    record.library = field("library");
+                    record.scheme = field("scheme");
+                    record.paramSet = field("param_set");
+                    if (columns.count("correct") > 0) {
+                        record.correct = field("correct") == "true";
+                    }
+                    records.push_back(record);
+                    lastRun = run;
+                }
+                records.back().phases.push_back({field("phase"), stod(field("time_ms"))});
+            }
+            return records;
+        }
+
+        static vector<string> splitCSV(const string& line) {
+            vector<string> fields(1);
+            bool quoted = false;
+            for (size_t i = 0; i < line.size(); i++) {
+                char c = line[i];
+                if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                    fields.back() += '"';
+                    i++;
+                } else if (c == '"') {
+                    quoted = !quoted;
+                } else if (c == ',' && !quoted) {
+                    fields.push_back("");
+                } else if (c != '\r') {
+                    fields.back() += c;
+                }
+            }
+            return fields;
+        }
+
+        /** Reads the objects written by ResultsWriter::toJSON, whose only nested objects map phases to values or arrays */
+        static vector<RunRecord> readJSONLines(istream& file) {
+            vector<RunRecord> records;
+            string line;
+            while (getline(file, line)) {
+                size_t position = line.find('{');
+                if (position == string::npos) {
+                    continue;
+                }
+                RunRecord record = RunRecord();
+                position++;
+                while (position < line.size() && line[position] != '}') {
+                    string key = readString(line, position);
+                    position = line.find(':', position) + 1;
+                    if (key == "phases_ms") {
+                        position = line.find('{', position) + 1;
+                        while (line[position] != '}') {
+                            string phase = readString(line, position);
+                            position = line.find(':', position) + 1;
+                            record.phases.push_back({phase, stod(readValue(line, position))});
+                            skipComma(line, position);
+                        }
+                        position++;
+                    } else if (line[position] == '{') {
+                        position = line.find('}', position) + 1; // other nested objects, e.g. peak_rss_bytes or counters
+                    } else {
+                        string value = line[position] == '"' ? readString(line, position) : readValue(line, position);
+                        if (key == "library") {
+                            record.library = value;
+                        } else if (key == "scheme") {
+                            record.scheme = value;
+                        } else if (key == "param_set") {
+                            record.paramSet = value;
+                        } else if (key == "correct") {
+                            record.correct = value == "true";
+                        }
+                    }
+                    skipComma(line, position);
+                }
+                records.push_back(record);
+            }
+            return records;
+        }
+
+        static string readString(const string& line, size_t& position) {
+            position = line.find('"', position) + 1;
+            string value;
+            while (position < line.size() && line[position] != '"') {
+                if (line[position] == '\\' && position + 1 < line.size()) {
+                    position++;
+                    value += line[position] == 'n' ? '\n' : line[position];
+                } else {
+                    value += line[position];
+                }
+                position++;
+            }
+            position++;
+            return value;
+        }
+
+        static string readValue(const string& line, size_t& position) {
+            size_t end = line.find_first_of(",}", position);
+            string value = line.substr(position, end - position);
+            position = end;
+            return value;
+        }
+
+        static void skipComma(const string& line, size_t& position) {
+            if (position < line.size() && line[position] == ',') {
+                position++;
+            }
+        }
+};
+
+/** Comparison of one parameter set between the baseline and a fresh sweep */
+struct RegressionResult {
+    string name; // library, scheme and parameter set
+    size_t baselineSamples;
+    size_t currentSamples;
+    double baselineMedian; // in ms, of the total time of a run
+    double currentMedian; // in ms, of the total time of a run
+    double pValue; // of the fresh sweep being slower, one-sided, before the multiple-comparison correction
+    bool regressed;
+    bool missing; // from the fresh sweep, or some of its phases are
+    string slowestPhase; // whose median slowed down the most, to point at the cause of a regression
+    double slowestPhaseChange; // as a fraction of its baseline median
+};
+
+/** @brief Compares the timings of a fresh sweep with those of a stored baseline.
+ *
+ * Each parameter set is a single test on the total time of its runs, with the phases only reported, so that a
+ * sweep of a few dozen sets is a few dozen tests rather than hundreds. A set regresses if a one-sided Mann-Whitney
+ * U test finds the fresh totals slower than the baseline ones and its median is also at least `minSlowdown` (a
+ * fraction) slower, so that neither noise nor a statistically significant but negligible change fails the gate.
+ * The test only uses ranks, so it does not assume normally distributed timings; without ties and for up to
+ * `ExactSamples` runs on each side its p-value is exact, above that it uses the normal approximation.
+ *
+ * The p-values are corrected with the Benjamini-Hochberg procedure at the `significance` level. A single
+ * regressed set among m must still reach significance / m, which takes enough runs: with n runs on each side the
+ * smallest p-value is 1 / C(2n, n), so getRequiredRuns tells how many a baseline needs. Sets with fewer than
+ * `minSamples` runs on either side are reported but never fail the gate; a set of the baseline that the fresh
+ * sweep did not run, or ran without some of its phases, is reported as missing and fails the gate.
+ */
+class RegressionGate {
+
+    public:
+        static const size_t ExactSamples = 20;
+
+        RegressionGate(double significance = 0.01, double minSlowdown = 0.1, size_t minSamples = 5)
+            : significance(significance), minSlowdown(minSlowdown), minSamples(minSamples) {};
+        ~RegressionGate() {};
+
+        /** Returns one result per parameter set of the baseline; both must only hold runs of the same library */
+        vector<RegressionResult> compare(const vector<RunRecord>& baseline, const vector<RunRecord>& current) const {
+            map<string, SetSamples> baselineSets = groupSamples(baseline);
+            map<string, SetSamples> currentSets = groupSamples(current);
+
+            vector<RegressionResult> results;
+            vector<size_t> tested; // results with enough samples on both sides to take part in the tests
+            for (const auto& entry : baselineSets) {
+                auto iter = currentSets.find(entry.first);
+                const SetSamples& before = entry.second;
+                const SetSamples after = iter != currentSets.end() ? iter->second : SetSamples();
+                RegressionResult result{entry.first, before.totals.size(), after.totals.size(), getMedian(before.totals),
+                                        getMedian(after.totals), getPValue(before.totals, after.totals), false, after.totals.empty(),
+                                        "", 0};
+                for (const auto& phase : before.phases) {
+                    auto afterPhase = after.phases.find(phase.first);
+                    if (afterPhase == after.phases.end()) {
+                        result.missing = true;
+                        continue;
+                    }
+                    double baselineMedian = getMedian(phase.second);
+                    double change = baselineMedian > 0 ? getMedian(afterPhase->second) / baselineMedian - 1 : 0;
+                    if (result.slowestPhase.empty() || change > result.slowestPhaseChange) {
+                        result.slowestPhase = phase.first;
+                        result.slowestPhaseChange = change;
+                    }
+                }
+                if (before.totals.size() >= minSamples && after.totals.size() >= minSamples) {
+                    tested.push_back(results.size());
+                }
+                results.push_back(result);
+            }
+
+            // Benjamini-Hochberg: the k smallest of m p-values are significant, for the largest k whose k-th smallest
+            // p-value is at most k / m * significance
+            stable_sort(tested.begin(), tested.end(), [&results](size_t a, size_t b) {
+                return results[a].pValue < results[b].pValue;
+            });
+            size_t significant = 0;
+            for (size_t k = 1; k <= tested.size(); k++) {
+                if (results[tested[k - 1]].pValue <= significance * k / tested.size()) {
+                    significant = k;
+                }
+            }
+            for (size_t k = 0; k < significant; k++) {
+                RegressionResult& result = results[tested[k]];
+                result.regressed = result.currentMedian > (1 + minSlowdown) * result.baselineMedian;
+            }
+            return results;
+        }
+
+        /** Returns the fewest runs on each side, at least `minSamples`, with which one regressed set among `sets`
+         *  can reach the corrected significance
+         */
+        size_t getRequiredRuns(size_t sets) const {
+            size_t runs = max<size_t>(minSamples, 1);
+            while (getMinPValue(runs, runs) > significance / max<size_t>(sets, 1)) {
+                runs++;
+            }
+            return runs;
+        }
+
+        /** Returns the smallest p-value of the test with `n1` and `n2` samples, when all of the second are the largest */
+        static double getMinPValue(size_t n1, size_t n2) {
+            double p = 1;
+            for (size_t i = 1; i <= n2; i++) {
+                p *= static_cast<double>(i) / (n1 + i); // 1 / C(n1 + n2, n2)
+            }
+            return p;
+        }
+
+        /** Returns whether any parameter set regressed or is missing from the fresh sweep */
+        static bool hasRegression(const vector<RegressionResult>& results) {
+            return any_of(results.begin(), results.end(), [](const RegressionResult& result) {
+                return result.regressed || result.missing;
+            });
+        }
+
+        static void printReport(const vector<RegressionResult>& results) {
+            cout << left << setw(36) << "Parameter set" << right << setw(8) << "Runs" << setw(14) << "Baseline"
+                << setw(14) << "Current" << setw(10) << "Change" << setw(10) << "p" << "  Slowest phase (medians of the total in ms)" << endl;
+            cout << fixed;
+            for (const RegressionResult& result : results) {
+                double change = result.baselineMedian > 0 ? 100 * (result.currentMedian / result.baselineMedian - 1) : 0;
+                cout << left << setw(36) << result.name << right << setw(4) << result.baselineSamples << "/" << setw(3) << result.currentSamples
+                    << setprecision(3) << setw(14) << result.baselineMedian << setw(14) << result.currentMedian
+                    << setprecision(1) << setw(9) << showpos << change << "%" << noshowpos
+                    << setprecision(4) << setw(10) << result.pValue << "  " << result.slowestPhase;
+                if (!result.slowestPhase.empty()) {
+                    cout << setprecision(1) << " (" << showpos << 100 * result.slowestPhaseChange << "%" << noshowpos << ")";
+                }
+                cout << (result.regressed ? "  REGRESSION" : "") << (result.missing ? "  MISSING" : "") << endl;
+            }
+            cout << defaultfloat << setprecision(6) << endl;
+        }
+
+    private:
+        double significance;
+        double minSlowdown;
+        size_t minSamples;
+
+        /** Total times of the runs of a parameter set, and the times of each of its phases */
+        struct SetSamples {
+            vector<double> totals;
+            map<string, vector<double>> phases;
+        };
+
+        static map<string, SetSamples> groupSamples(const vector<RunRecord>& records) {
+            map<string, SetSamples> sets;
+            for (const RunRecord& record : records) {
+                SetSamples& samples = sets[record.library + " " + record.scheme + " " + record.paramSet];
+                double total = 0;
+                for (const auto& phase : record.phases) {
+                    samples.phases[phase.first].push_back(phase.second);
+                    total += phase.second;
+                }
+                samples.totals.push_back(total);
+            }
+            return sets;
+        }
+
+        static double getMedian(vector<double> samples) {
+            if (samples.empty()) {
+                return 0;
+            }
+            sort(samples.begin(), samples.end());
+            size_t middle = samples.size() / 2;
+            return samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+        }
+
+        /** Returns the p-value of `after` being stochastically larger than `before`: exact for samples without ties
+         *  of up to ExactSamples each, otherwise with the normal approximation of the U statistic, corrected for
+         *  ties and continuity
+         */
+        static double getPValue(const vector<double>& before, const vector<double>& after) {
+            double n1 = before.size();
+            double n2 = after.size();
+            if (n1 == 0 || n2 == 0) {
+                return 1;
+            }
+
+            vector<pair<double, bool>> pooled; // (sample, is from after)
+            for (double sample : before) {
+                pooled.push_back({sample, false});
+            }
+            for (double sample : after) {
+                pooled.push_back({sample, true});
+            }
+            sort(pooled.begin(), pooled.end());
+
+            double afterRankSum = 0;
+            double tieTerm = 0;
+            for (size_t i = 0; i < pooled.size();) {
+                size_t j = i;
+                while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+                    j++;
+                }
+                double rank = (i + 1 + j) / 2.0; // average of the ranks i + 1 to j
+                for (size_t k = i; k < j; k++) {
+                    if (pooled[k].second) {
+                        afterRankSum += rank;
+                    }
+                }
+                double ties = j - i;
+                tieTerm += ties * ties * ties - ties;
+                i = j;
+            }
+
+            double n = n1 + n2;
+            double u = afterRankSum - n2 * (n2 + 1) / 2; // pairs in which the sample from after is the larger one
+            if (tieTerm == 0 && before.size() <= ExactSamples && after.size() <= ExactSamples) {
+                return getExactPValue(before.size(), after.size(), static_cast<size_t>(llround(u)));
+            }
+            double variance = n1 * n2 / 12 * ((n + 1) - tieTerm / (n * (n - 1)));
+            if (variance <= 0) {
+                return 1;
+            }
+            double z = (u - n1 * n2 / 2 - 0.5) / sqrt(variance);
+            return 0.5 * erfc(z / sqrt(2.0));
+        }
+
+        /** Returns P(U >= u) when all C(n1 + n2, n2) orderings are equally likely. The orderings of i samples
+         *  from before and j from after with a given U follow from the largest sample: from after, it is larger
+         *  than all i samples from before, so counts[i][j][u] = counts[i][j - 1][u - i] + counts[i - 1][j][u]
+         */
+        static double getExactPValue(size_t n1, size_t n2, size_t u) {
+            size_t maxU = n1 * n2;
+            // counts of the previous and the current number of samples from after, for every number from before
+            vector<vector<double>> previous(n1 + 1, vector<double>(maxU + 1, 0));
+            for (size_t i = 0; i <= n1; i++) {
+                previous[i][0] = 1; // no sample from after
+            }
+            for (size_t j = 1; j <= n2; j++) {
+                vector<vector<double>> counts(n1 + 1, vector<double>(maxU + 1, 0));
+                for (size_t i = 0; i <= n1; i++) {
+                    for (size_t v = 0; v <= i * j; v++) {
+                        counts[i][v] = (v >= i ? previous[i][v - i] : 0) + (i > 0 ? counts[i - 1][v] : 0);
+                    }
+                }
+                previous = move(counts);
+            }
+            double total = 0;
+            double tail = 0;
+            for (size_t v = 0; v <= maxU; v++) {
+                total += previous[n1][v];
+                if (v >= u) {
+                    tail += previous[n1][v];
+                }
+            }
+            return tail / total;
+        }
+};
+
+#endif // REGRESSIONGATE_H
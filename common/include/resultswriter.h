@@ -0,0 +1,229 @@
+#ifndef RESULTSWRITER_H
+#define RESULTSWRITER_H
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "perfcounters.h"
+
+using namespace std;
+using std::vector;
+
+/** One run of the distance workload on one parameter set */
+struct RunRecord {
+    string library;
+    string scheme;
+    string paramSet;
+    size_t ringDimension;
+    double logQ; // bits of the ciphertext modulus
+    uint64_t plaintextModulus; // 0 for the approximate scheme (CKKS)
+    double scale; // 0 for the exact schemes (BGV and BGVrns)
+    vector<pair<string, double>> phases; // in ms, in the order they ran
+    size_t ciphertextSize; // in bytes, of a serialized fresh ciphertext
+    size_t resultSize; // in bytes, of the serialized result before compaction
+    size_t compactedResultSize; // in bytes, of the serialized result after compaction
+    bool correct;
+    size_t publicKeySize; // in bytes, serialized
+    size_t publicKeyMemory; // in bytes, of the coefficients held in memory
+    size_t secretKeySize;
+    size_t secretKeyMemory;
+    size_t evalKeySize; // relinearization (EvalMult) keys
+    size_t evalKeyMemory;
+    size_t ciphertextMemory; // of a fresh ciphertext
+    size_t poolAllocation; // in bytes, allocated by SEAL's global memory pool; 0 for PALISADE
+    vector<pair<string, size_t>> peakRSS; // in bytes, for every phase
+    vector<pair<string, CounterSample>> counters; // for every phase, if hardware counters were collected
+};
+
+/** @brief Appends RunRecords to a results file, as CSV if its name ends in ".csv" and as JSON lines otherwise.
+ *
+ * The schema is versioned (`schema_version`) and only ever extended, so that dashboards do not have to
+ * scrape the console output. CSV has one row per phase of a run, with the fields of the run repeated,
+ * so that its columns do not depend on the phases; a JSON line holds a whole run, with its phases as
+ * an object. The header of a CSV file is only written if the file is empty, so that successive runs
+ * append to the same file, and every record is flushed as soon as it is written. A file that already
+ * holds records of another schema version is refused rather than appended to, as its columns would
+ * no longer line up; such a file has to be moved away first.
+ */
+class ResultsWriter {
+
+    public:
+        static const int SchemaVersion = 3; // 2 added the memory fields, 3 the hardware counters
+
+        ResultsWriter(const string& path) : csv(isCSVPath(path)), runs(0) {
+            checkSchema(path, csv);
+            file.open(path, ios::out | ios::app);
+            if (!file) {
+                throw runtime_error("Could not open the results file " + path);
+            }
+            file.seekp(0, ios::end);
+            if (csv && file.tellp() == 0) {
+                file << getCSVHeader() << endl;
+            }
+        };
+        ~ResultsWriter() {};
+
+        void write(const RunRecord& record) {
+            runs++;
+            file << (csv ? toCSV(record, runs) : toJSON(record, runs) + "\n") << flush;
+        }
+
+        static bool isCSVPath(const string& path) {
+            return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        }
+
+        static string getCSVHeader() {
+            return "schema_version,timestamp,run,library,scheme,param_set,ring_dimension,log_q,plaintext_modulus,scale,"
+                "ciphertext_bytes,result_bytes,compacted_result_bytes,correct,phase,time_ms,public_key_bytes,public_key_memory_bytes,"
+                "secret_key_bytes,secret_key_memory_bytes,eval_key_bytes,eval_key_memory_bytes,ciphertext_memory_bytes,pool_bytes,peak_rss_bytes,"
+                "cycles,instructions,cache_misses,branch_misses";
+        }
+
+        /** Returns one line per phase, each ending in a newline; `run` tells the runs written in the same second apart */
+        static string toCSV(const RunRecord& record, size_t run) {
+            ostringstream fields;
+            fields << setprecision(17) << SchemaVersion << "," << getTimestamp() << "," << run << "," << quoteCSV(record.library) << ","
+                << quoteCSV(record.scheme) << "," << quoteCSV(record.paramSet) << "," << record.ringDimension << ","
+                << record.logQ << "," << record.plaintextModulus << "," << record.scale << "," << record.ciphertextSize << ","
+                << record.resultSize << "," << record.compactedResultSize << "," << (record.correct ? "true" : "false");
+            ostringstream memory;
+            memory << record.publicKeySize << "," << record.publicKeyMemory << "," << record.secretKeySize << "," << record.secretKeyMemory
+                << "," << record.evalKeySize << "," << record.evalKeyMemory << "," << record.ciphertextMemory << "," << record.poolAllocation;
+
+            ostringstream lines;
+            lines << setprecision(17);
+            for (const auto& phase : record.phases) {
+                lines << fields.str() << "," << quoteCSV(phase.first) << "," << phase.second << "," << memory.str() << ","
+                    << getPeakRSS(record, phase.first) << "," << getCountersCSV(record, phase.first) << "\n";
+            }
+            return lines.str();
+        }
+
+        static string toJSON(const RunRecord& record, size_t run) {
+            ostringstream line;
+            line << setprecision(17) << "{\"schema_version\":" << SchemaVersion << ",\"timestamp\":" << quoteJSON(getTimestamp()) << ",\"run\":" << run
+                << ",\"library\":" << quoteJSON(record.library) << ",\"scheme\":" << quoteJSON(record.scheme)
+                << ",\"param_set\":" << quoteJSON(record.paramSet) << ",\"ring_dimension\":" << record.ringDimension
+                << ",\"log_q\":" << record.logQ << ",\"plaintext_modulus\":" << record.plaintextModulus << ",\"scale\":" << record.scale
+                << ",\"ciphertext_bytes\":" << record.ciphertextSize << ",\"result_bytes\":" << record.resultSize
+                << ",\"compacted_result_bytes\":" << record.compactedResultSize << ",\"correct\":" << (record.correct ? "true" : "false")
+                << ",\"public_key_bytes\":" << record.publicKeySize << ",\"public_key_memory_bytes\":" << record.publicKeyMemory
+                << ",\"secret_key_bytes\":" << record.secretKeySize << ",\"secret_key_memory_bytes\":" << record.secretKeyMemory
+                << ",\"eval_key_bytes\":" << record.evalKeySize << ",\"eval_key_memory_bytes\":" << record.evalKeyMemory
+                << ",\"ciphertext_memory_bytes\":" << record.ciphertextMemory << ",\"pool_bytes\":" << record.poolAllocation
+                << ",\"phases_ms\":{";
+            for (size_t i = 0; i < record.phases.size(); i++) {
+                line << (i == 0 ? "" : ",") << quoteJSON(record.phases[i].first) << ":" << record.phases[i].second;
+            }
+            line << "},\"peak_rss_bytes\":{";
+            for (size_t i = 0; i < record.peakRSS.size(); i++) {
+                line << (i == 0 ? "" : ",") << quoteJSON(record.peakRSS[i].first) << ":" << record.peakRSS[i].second;
+            }
+            line << "}";
+            // Counts are [cycles, instructions, cache misses, branch misses], null if their counter could not be opened
+            if (!record.counters.empty()) {
+                line << ",\"counters\":{";
+                for (size_t i = 0; i < record.counters.size(); i++) {
+                    const CounterSample& sample = record.counters[i].second;
+                    line << (i == 0 ? "" : ",") << quoteJSON(record.counters[i].first) << ":[" << formatCount(sample.cycles) << ","
+                        << formatCount(sample.instructions) << "," << formatCount(sample.cacheMisses) << ","
+                        << formatCount(sample.branchMisses) << "]";
+                }
+                line << "}";
+            }
+            line << "}";
+            return line.str();
+        }
+
+    private:
+        bool csv;
+        ofstream file;
+        size_t runs; // written by this writer
+
+        /** Throws if the first line of an existing, non-empty file is not the header, or a record, of this schema version */
+        static void checkSchema(const string& path, bool csv) {
+            ifstream existing(path);
+            string line;
+            if (!existing || !getline(existing, line)) {
+                return;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                return;
+            }
+            string prefix = "{\"schema_version\":" + to_string(SchemaVersion) + ",";
+            if (csv ? line != getCSVHeader() : line.compare(0, prefix.size(), prefix) != 0) {
+                throw runtime_error("The results file " + path + " was written with another schema version than "
+                                    + to_string(SchemaVersion) + "; move it away or choose another file");
+            }
+        }
+
+        static size_t getPeakRSS(const RunRecord& record, const string& phase) {
+            for (const auto& entry : record.peakRSS) {
+                if (entry.first == phase) {
+                    return entry.second;
+                }
+            }
+            return 0;
+        }
+
+        /** Returns the counts of `phase`, with empty fields for the ones that were not collected */
+        static string getCountersCSV(const RunRecord& record, const string& phase) {
+            for (const auto& entry : record.counters) {
+                if (entry.first == phase) {
+                    const CounterSample& sample = entry.second;
+                    return formatCount(sample.cycles, "") + "," + formatCount(sample.instructions, "") + ","
+                        + formatCount(sample.cacheMisses, "") + "," + formatCount(sample.branchMisses, "");
+                }
+            }
+            return ",,,";
+        }
+
+        static string formatCount(int64_t count, const string& unknown = "null") {
+            return count < 0 ? unknown : to_string(count);
+        }
+
+        /** Returns the current UTC time in ISO 8601 */
+        static string getTimestamp() {
+            time_t now = time(nullptr);
+            char buffer[32];
+            strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+            return buffer;
+        }
+
+        static string quoteCSV(const string& value) {
+            if (value.find_first_of(",\"\n") == string::npos) {
+                return value;
+            }
+            string quoted = "\"";
+            for (char c : value) {
+                quoted += c == '"' ? "\"\"" : string(1, c);
+            }
+            return quoted + "\"";
+        }
+
+        static string quoteJSON(const string& value) {
+            string quoted = "\"";
+            for (char c : value) {
+                if (c == '\n') {
+                    quoted += "\\n";
+                    continue;
+                }
+                if (c == '"' || c == '\\') {
+                    quoted += '\\';
+                }
+                quoted += c;
+            }
+            return quoted + "\"";
+        }
+};
+
+#endif // RESULTSWRITER_H
@@ -0,0 +1,141 @@
+#ifndef SCALABILITYBENCHMARK_H
+#define SCALABILITYBENCHMARK_H
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cputopology.h"
+
+using namespace std;
+using std::vector;
+
+/** Throughput of the distance workload at one thread count and batch size */
+struct ScalabilityPoint {
+    size_t threads;
+    size_t batchSize; // distances computed by a batch, one per slot
+    double batchTime; // in ms per batch, as all the threads together process them
+    double throughput; // distances per second
+    double speedup; // over the fewest threads, at the same batch size
+    double efficiency; // speedup per thread, relative to the fewest threads
+};
+
+/** @brief Sweeps the thread count and the batch size of the distance workload and derives its throughput curves.
+ *
+ * The caller measures a batch at a given thread count and batch size; each measurement is repeated `iterations`
+ * times after `warmupIterations` unrecorded ones and its median is kept. Efficiency is the speedup over the fewest
+ * threads divided by the ratio of thread counts, so 1 is perfect scaling; the scaling limit is the largest thread
+ * count that still reaches `minEfficiency` on the largest batch.
+ */
+class ScalabilityBenchmark {
+
+    public:
+        ScalabilityBenchmark(int warmupIterations = 1, int iterations = 5)
+            : warmupIterations(warmupIterations), iterations(iterations) {};
+        ~ScalabilityBenchmark() {};
+
+        /** Returns 1, 2, 4, ... up to and including `maxThreads`, by default the number of physical cores:
+         *  SMT siblings share the execution units of a core, so points beyond it would not measure scaling
+         */
+        static vector<size_t> getThreadCounts(size_t maxThreads = CpuTopology::getPhysicalCoreCount()) {
+            vector<size_t> counts;
+            for (size_t count = 1; count < maxThreads; count *= 2) {
+                counts.push_back(count);
+            }
+            counts.push_back(max<size_t>(maxThreads, 1));
+            return counts;
+        }
+
+        /** Returns 1, 4, 16, ... up to and including `slots`, the full batch */
+        static vector<size_t> getBatchSizes(size_t slots) {
+            vector<size_t> sizes;
+            for (size_t size = 1; size < slots; size *= 4) {
+                sizes.push_back(size);
+            }
+            sizes.push_back(max<size_t>(slots, 1));
+            return sizes;
+        }
+
+        /** @param batchTime returns the time in ms per batch of `batchSize` distances on `threads` threads */
+        vector<ScalabilityPoint> run(const vector<size_t>& threadCounts, const vector<size_t>& batchSizes,
+                                     const function<double(size_t threads, size_t batchSize)>& batchTime) const {
+            vector<ScalabilityPoint> points;
+            for (size_t batchSize : batchSizes) {
+                double baseThroughput = 0;
+                for (size_t threads : threadCounts) {
+                    for (int i = 0; i < warmupIterations; i++) {
+                        batchTime(threads, batchSize);
+                    }
+                    vector<double> samples;
+                    for (int i = 0; i < iterations; i++) {
+                        samples.push_back(batchTime(threads, batchSize));
+                    }
+                    sort(samples.begin(), samples.end());
+                    double time = samples[samples.size() / 2];
+
+                    ScalabilityPoint point{threads, batchSize, time, time > 0 ? 1000 * batchSize / time : 0, 1, 1};
+                    if (threads == threadCounts.front()) {
+                        baseThroughput = point.throughput;
+                    }
+                    point.speedup = baseThroughput > 0 ? point.throughput / baseThroughput : 0;
+                    point.efficiency = point.speedup * threadCounts.front() / threads;
+                    points.push_back(point);
+                }
+            }
+            return points;
+        }
+
+        /** Returns the largest thread count whose efficiency on the largest batch is at least `minEfficiency` */
+        static size_t getScalingLimit(const vector<ScalabilityPoint>& points, double minEfficiency = 0.7) {
+            size_t largestBatch = 0;
+            for (const ScalabilityPoint& point : points) {
+                largestBatch = max(largestBatch, point.batchSize);
+            }
+            size_t limit = 1;
+            for (const ScalabilityPoint& point : points) {
+                if (point.batchSize == largestBatch && point.efficiency >= minEfficiency) {
+                    limit = max(limit, point.threads);
+                }
+            }
+            return limit;
+        }
+
+        /** Prints one row per batch size and thread count, grouped by batch size */
+        static void printCurves(const vector<ScalabilityPoint>& points) {
+            cout << right << setw(8) << "Batch" << setw(9) << "Threads" << setw(14) << "ms / batch" << setw(16) << "Distances / s"
+                << setw(10) << "Speedup" << setw(12) << "Efficiency" << endl;
+            cout << fixed;
+            for (const ScalabilityPoint& point : points) {
+                cout << setw(8) << point.batchSize << setw(9) << point.threads << setprecision(3) << setw(14) << point.batchTime
+                    << setprecision(1) << setw(16) << point.throughput << setprecision(2) << setw(10) << point.speedup
+                    << setw(12) << point.efficiency << endl;
+            }
+            cout << defaultfloat << setprecision(6);
+            cout << "Scales up to " << getScalingLimit(points) << " threads (efficiency of at least 0.7 on the full batch)\n" << endl;
+        }
+
+        static string getCSVHeader() {
+            return "library,scheme,param_set,ring_dimension,batch_size,threads,batch_ms,throughput,speedup,efficiency";
+        }
+
+        /** Writes one line per point, each ending in a newline */
+        static void writeCSV(ostream& out, const string& library, const string& scheme, const string& paramSet, size_t ringDimension,
+                             const vector<ScalabilityPoint>& points) {
+            out << setprecision(17);
+            for (const ScalabilityPoint& point : points) {
+                out << library << "," << scheme << "," << paramSet << "," << ringDimension << "," << point.batchSize << ","
+                    << point.threads << "," << point.batchTime << "," << point.throughput << "," << point.speedup << ","
+                    << point.efficiency << "\n";
+            }
+            out << flush;
+        }
+
+    private:
+        int warmupIterations;
+        int iterations;
+};
+
+#endif // SCALABILITYBENCHMARK_H
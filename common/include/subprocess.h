@@ -0,0 +1,40 @@
+#ifndef SUBPROCESS_H
+#define SUBPROCESS_H
+
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+/** @brief Runs another process and collects what it prints, for the modes that run parameter sets
+ * in a process of their own or in the binary of the other library.
+ */
+class Subprocess {
+
+    public:
+        /** Runs `command` through the shell and stores its standard output in `output`; returns false if it could not be started */
+        static bool run(const string& command, string& output) {
+#ifdef _WIN32
+            FILE* process = _popen(command.c_str(), "r");
+#else
+            FILE* process = popen(command.c_str(), "r");
+#endif
+            output.clear();
+            if (process == nullptr) {
+                return false;
+            }
+
+            char buffer[256];
+            while (fgets(buffer, sizeof(buffer), process) != nullptr) {
+                output += buffer;
+            }
+#ifdef _WIN32
+            _pclose(process);
+#else
+            pclose(process);
+#endif
+            return true;
+        }
+};
+
+#endif // SUBPROCESS_H
@@ -0,0 +1,233 @@
+#ifndef SWEEPSCHEDULER_H
+#define SWEEPSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cputopology.h"
+#include "subprocess.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sched.h>
+#include <time.h>
+#endif
+
+using namespace std;
+using std::vector;
+
+/** One parameter set of a sweep, run as `command` in its own process */
+struct SweepTask {
+    string name;
+    string command;
+    double predictedTime; // in ms, 0 if unknown
+};
+
+/** Timings reported by a sweep task; a contention ratio well above 1 means the task was held up by others */
+struct SweepResult {
+    string name;
+    bool succeeded;
+    double wallTime; // in ms
+    double cpuTime; // in ms
+    double cacheMPKI; // last level cache misses per thousand instructions, -1 if unknown
+    bool rerunInIsolation;
+    double slowdown; // wall time in the parallel phase over the isolated one, 0 if the task was not rerun
+
+    double getContentionRatio() const {
+        return cpuTime > 0 ? wallTime / cpuTime : 0;
+    }
+};
+
+/** @brief Runs the parameter sets of a sweep concurrently on a configurable number of workers.
+ *
+ * Every task runs in a separate process, as the libraries keep their contexts and keys
+ * in global state that is not safe to share between threads. Each worker owns one physical
+ * core, so that no two tasks share a core through SMT, and passes it to its tasks with `--cpu`,
+ * so that a task pinned with `SweepWorker::pinToCore` and limited to a single thread never
+ * competes with another task for a core.
+ *
+ * Tasks still share the last level cache and memory bandwidth. Stalls on those count as CPU
+ * time, so the ratio of wall to CPU time only catches oversubscription; instead, every task
+ * reports its last level cache misses per thousand instructions (MPKI), and the tasks that
+ * interference slows down are found by running them again on their own once the parallel
+ * phase is over, from the highest MPKI down. How much MPKI it takes to be slowed down depends
+ * on the host, so rather than trusting a fixed threshold, the reruns stop at the first task
+ * that ran no slower in parallel than alone (within the tolerance): the tasks with a lower MPKI
+ * are taken to be unaffected as well. `minMemoryBoundMPKI` only spares the tasks below it,
+ * which are compute bound on any host, from being checked. A rerun task keeps its isolated
+ * result. Without hardware counters only the oversubscribed tasks, whose wall time exceeds
+ * their CPU time by more than the tolerance, are rerun.
+ *
+ * Tasks are started in decreasing order of predicted time, so that the longest ones do not
+ * start last and leave the other workers idle.
+ */
+class SweepScheduler {
+
+    public:
+        /** @param numWorkers 0 for one worker per physical core */
+        SweepScheduler(size_t numWorkers = 0, bool pinToCores = true, double contentionTolerance = 1.1, double minMemoryBoundMPKI = 1)
+            : cores(CpuTopology::getPhysicalCores()), pinToCores(pinToCores), contentionTolerance(contentionTolerance),
+              minMemoryBoundMPKI(minMemoryBoundMPKI) {
+            this->numWorkers = numWorkers > 0 ? numWorkers : cores.size();
+        };
+        ~SweepScheduler() {};
+
+        /** Returns the results in the order of `tasks`
+         *  @param memoryBoundMPKI if given, receives the MPKI from which tasks were found to be slowed down by the
+         *  others: the lowest MPKI of a task that was, or -1 if none was
+         */
+        vector<SweepResult> run(const vector<SweepTask>& tasks, double* memoryBoundMPKI = nullptr) const {
+            vector<SweepResult> results(tasks.size());
+            vector<size_t> order(tasks.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            stable_sort(order.begin(), order.end(), [&tasks](size_t a, size_t b) {
+                return tasks[a].predictedTime > tasks[b].predictedTime;
+            });
+
+            atomic<size_t> nextTask(0);
+            vector<thread> workers;
+            for (size_t worker = 0; worker < min(numWorkers, tasks.size()); worker++) {
+                workers.emplace_back([this, &tasks, &results, &order, &nextTask, worker]() {
+                    for (size_t next = nextTask++; next < order.size(); next = nextTask++) {
+                        results[order[next]] = runTask(tasks[order[next]], worker);
+                    }
+                });
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+
+            // Oversubscribed tasks are always rerun; the others from the highest MPKI down, until one was not slowed down
+            vector<size_t> candidates;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                if (!results[i].succeeded) {
+                    continue;
+                }
+                if (results[i].getContentionRatio() > contentionTolerance) {
+                    rerunInIsolation(tasks[i], results[i]);
+                } else if (results[i].cacheMPKI >= minMemoryBoundMPKI) {
+                    candidates.push_back(i);
+                }
+            }
+            stable_sort(candidates.begin(), candidates.end(), [&results](size_t a, size_t b) {
+                return results[a].cacheMPKI > results[b].cacheMPKI;
+            });
+            double lowestSlowedMPKI = -1;
+            for (size_t i : candidates) {
+                double mpki = results[i].cacheMPKI;
+                if (!rerunInIsolation(tasks[i], results[i])) {
+                    continue;
+                }
+                if (results[i].slowdown <= contentionTolerance) {
+                    break;
+                }
+                lowestSlowedMPKI = mpki;
+            }
+            if (memoryBoundMPKI != nullptr) {
+                *memoryBoundMPKI = lowestSlowedMPKI;
+            }
+            return results;
+        }
+
+        /** Prints the MPKI from which `run` found sets to be slowed down by the sets running alongside them */
+        static void printMemoryBound(double memoryBoundMPKI) {
+            if (memoryBoundMPKI < 0) {
+                cout << "No set was slower in parallel than alone\n" << endl;
+            } else {
+                cout << "Sets with an LLC MPKI of " << memoryBoundMPKI << " or more were slower in parallel than alone\n" << endl;
+            }
+        }
+
+    private:
+        vector<size_t> cores;
+        size_t numWorkers;
+        bool pinToCores;
+        double contentionTolerance;
+        double minMemoryBoundMPKI;
+
+        /** Runs a task again on its own and keeps that run, with its slowdown in parallel; returns false if it failed */
+        bool rerunInIsolation(const SweepTask& task, SweepResult& result) const {
+            SweepResult isolated = runTask(task, 0);
+            if (!isolated.succeeded) {
+                return false;
+            }
+            isolated.rerunInIsolation = true;
+            isolated.slowdown = isolated.wallTime > 0 ? result.wallTime / isolated.wallTime : 0;
+            result = isolated;
+            return true;
+        }
+
+        SweepResult runTask(const SweepTask& task, size_t worker) const {
+            size_t core = cores[worker % cores.size()];
+            string command = task.command + (pinToCores ? " --cpu " + to_string(core) : "");
+            SweepResult result{task.name, false, 0, 0, -1, false, 0};
+            string output;
+            if (!Subprocess::run(command, output)) {
+                return result;
+            }
+
+            istringstream lines(output);
+            string line;
+            while (getline(lines, line)) {
+                istringstream fields(line);
+                string tag;
+                if (fields >> tag && tag == "SWEEP_RESULT" && fields >> result.wallTime >> result.cpuTime) {
+                    result.succeeded = true;
+                    if (!(fields >> result.cacheMPKI)) {
+                        result.cacheMPKI = -1;
+                    }
+                }
+            }
+            return result;
+        }
+};
+
+/** @brief Helpers for the process running a single sweep task */
+class SweepWorker {
+
+    public:
+        /** Restricts the current process to a single core; returns false if the platform refused */
+        static bool pinToCore(size_t core) {
+#ifdef _WIN32
+            return SetProcessAffinityMask(GetCurrentProcess(), static_cast<DWORD_PTR>(1) << core) != 0;
+#else
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core, &cpus);
+            return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#endif
+        }
+
+        /** Returns the CPU time used by the current process so far, in ms */
+        static double getProcessCpuTime() {
+#ifdef _WIN32
+            FILETIME creation, exitTime, kernel, user;
+            GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user);
+            auto toMs = [](const FILETIME& time) {
+                return ((static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10000.0;
+            };
+            return toMs(kernel) + toMs(user);
+#else
+            timespec time;
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+            return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+#endif
+        }
+
+        /** Prints the line the scheduler reads the timings of a task from; `cacheMPKI` is -1 if unknown */
+        static void reportResult(double wallTime, double cpuTime, double cacheMPKI = -1) {
+            cout << "SWEEP_RESULT " << wallTime << " " << cpuTime << " " << cacheMPKI << endl;
+        }
+};
+
+#endif // SWEEPSCHEDULER_H
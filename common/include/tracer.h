@@ -0,0 +1,156 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** @brief Records spans of time on every thread and writes them as Chrome trace events.
+ *
+ * The file opens in chrome://tracing or Perfetto, with a track per thread, so that gaps between
+ * stages, serialization and threads waiting on each other show up. Threads are numbered in the order
+ * they first record a span, the one that creates the tracer being 0. Recording is thread-safe;
+ * every span is kept in memory until `write`. Every method that takes a `Tracer*` does nothing
+ * when it is nullptr, so that tracing can be left off at no cost.
+ */
+class Tracer {
+
+    public:
+        typedef chrono::steady_clock::time_point TimePoint;
+
+        /** Records the span from its construction to its destruction */
+        class Span {
+
+            public:
+                Span(Tracer* tracer, const string& name, const string& category)
+                    : tracer(tracer), name(name), category(category), start(chrono::steady_clock::now()) {};
+                ~Span() {
+                    if (tracer != nullptr) {
+                        tracer->addSpan(name, category, start, chrono::steady_clock::now());
+                    }
+                };
+                Span(const Span&) = delete;
+                Span& operator=(const Span&) = delete;
+
+            private:
+                Tracer* tracer;
+                string name;
+                string category;
+                TimePoint start;
+        };
+
+        /** Records consecutive stages: each `begin` ends the stage before it, and destruction ends the last one */
+        class Stages {
+
+            public:
+                Stages(Tracer* tracer, const string& category) : tracer(tracer), category(category), started(false) {};
+                ~Stages() {
+                    end();
+                };
+                Stages(const Stages&) = delete;
+                Stages& operator=(const Stages&) = delete;
+
+                void begin(const string& name) {
+                    end();
+                    current = name;
+                    start = chrono::steady_clock::now();
+                    started = true;
+                }
+
+                void end() {
+                    if (tracer != nullptr && started) {
+                        tracer->addSpan(current, category, start, chrono::steady_clock::now());
+                    }
+                    started = false;
+                }
+
+            private:
+                Tracer* tracer;
+                string category;
+                string current;
+                TimePoint start;
+                bool started;
+        };
+
+        Tracer() : origin(chrono::steady_clock::now()) {
+            getThread(this_thread::get_id());
+        };
+        ~Tracer() {};
+
+        void addSpan(const string& name, const string& category, TimePoint start, TimePoint finish) {
+            lock_guard<mutex> lock(eventsMutex);
+            events.push_back({name, category, chrono::duration<double, micro>(start - origin).count(),
+                              chrono::duration<double, micro>(finish - start).count(), getThread(this_thread::get_id())});
+        }
+
+        size_t getSpanCount() {
+            lock_guard<mutex> lock(eventsMutex);
+            return events.size();
+        }
+
+        /** Writes every span recorded so far to `path`; returns false if the file could not be written */
+        bool write(const string& path) {
+            lock_guard<mutex> lock(eventsMutex);
+            ofstream file(path);
+            file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            for (size_t tid = 0; tid < threads.size(); tid++) {
+                file << (tid == 0 ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                    << ",\"args\":{\"name\":\"" << (tid == 0 ? string("main") : "worker " + to_string(tid)) << "\"}}";
+            }
+            file << fixed;
+            file.precision(3);
+            for (const Event& event : events) {
+                file << ",\n{\"name\":" << quote(event.name) << ",\"cat\":" << quote(event.category) << ",\"ph\":\"X\",\"ts\":"
+                    << event.start << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << event.tid << "}";
+            }
+            file << "\n]}\n";
+            file.close();
+            return static_cast<bool>(file);
+        }
+
+    private:
+        struct Event {
+            string name;
+            string category;
+            double start; // in us since the tracer was created
+            double duration; // in us
+            size_t tid;
+        };
+
+        TimePoint origin;
+        mutex eventsMutex;
+        vector<Event> events;
+        map<thread::id, size_t> threads;
+
+        /** Returns the number of a thread, numbering it if it is new; the caller holds `eventsMutex` but for the constructor */
+        size_t getThread(thread::id id) {
+            auto iter = threads.find(id);
+            if (iter != threads.end()) {
+                return iter->second;
+            }
+            size_t tid = threads.size();
+            threads[id] = tid;
+            return tid;
+        }
+
+        static string quote(const string& value) {
+            string quoted = "\"";
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    quoted += '\\';
+                }
+                quoted += c;
+            }
+            return quoted + "\"";
+        }
+};
+
+#endif // TRACER_H
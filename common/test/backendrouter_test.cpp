@@ -0,0 +1,82 @@
+// backendrouter_test.cpp : Tests of BackendRouter on runners with fixed timings.
+//
+
+#include <stdexcept>
+#include "distancepipeline.h"
+#include "testing.h"
+
+namespace {
+
+/** Reports the same result for every run, or throws if it has none */
+class FixedDistanceRunner: public DistanceRunner {
+
+    public:
+        FixedDistanceRunner(const DistanceResult* result) : result(result) {};
+
+        DistanceResult run(double, double, double, double) override {
+            if (result == nullptr) {
+                throw runtime_error("backend unavailable");
+            }
+            return *result;
+        }
+
+    private:
+        const DistanceResult* result;
+};
+
+void addFixed(BackendRegistry& registry, const string& name, const DistanceResult* result) {
+    registry.add(name, [result]() { return unique_ptr<DistanceRunner>(new FixedDistanceRunner(result)); });
+}
+
+}
+
+TEST(eachRingDimensionIsRoutedToItsFastestCorrectSet) {
+    DistanceResult palisade8192{"PALISADE", 8192, 1, 1, true, 5, 100};
+    DistanceResult seal8192{"SEAL", 8192, 1, 1, true, 3, 100};
+    DistanceResult wrong8192{"SEAL", 8192, 1, 2, false, 1, 100};
+    DistanceResult palisade16384{"PALISADE", 16384, 1, 1, true, 9, 100};
+    BackendRegistry registry;
+    addFixed(registry, "PALISADE CKKS 1", &palisade8192);
+    addFixed(registry, "SEAL CKKS 1", &seal8192);
+    addFixed(registry, "SEAL CKKS 2", &wrong8192);
+    addFixed(registry, "PALISADE CKKS 2", &palisade16384);
+    addFixed(registry, "SEAL CKKS 3", nullptr);
+
+    BackendRouter router(3);
+    router.measure(registry, registry.getParamSetNames(), 1, 2, 3, 4);
+    CHECK(router.getRoutes().size() == 2);
+    CHECK(router.route(8192) == "SEAL CKKS 1");
+    CHECK(router.getRoutes().at(8192).library == "SEAL");
+    CHECK(router.getRoutes().at(8192).alternatives.size() == 1);
+    CHECK(router.route(16384) == "PALISADE CKKS 2");
+
+    bool threw = false;
+    try {
+        router.route(32768);
+    } catch (const out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(outputWithoutAResultIsRejected) {
+    DistanceResult parsed;
+    CHECK(!RemoteDistanceRunner::parseResult("Usage: --unified-task <name> <x1> <y1> <x2> <y2>\n", parsed));
+}
+
+TEST(remoteResultsRoundTripThroughTheirReportLine) {
+    DistanceResult result{"SEAL", 16384, 0.005, 0.0050000001, true, 12.5, 131072};
+    ostringstream output;
+    streambuf* previous = cout.rdbuf(output.rdbuf());
+    RemoteDistanceRunner::reportResult(result);
+    cout.rdbuf(previous);
+
+    DistanceResult parsed;
+    CHECK(RemoteDistanceRunner::parseResult("Encrypting...\n" + output.str(), parsed));
+    CHECK(parsed.library == "SEAL");
+    CHECK(parsed.ringDimension == 16384);
+    CHECK_NEAR(parsed.actual, result.actual, 1e-15);
+    CHECK(parsed.correct);
+    CHECK_NEAR(parsed.evaluationTime, 12.5, 1e-12);
+    CHECK(parsed.resultSize == 131072);
+}
@@ -0,0 +1,25 @@
+// benchmarkharness_test.cpp : Tests of how BenchmarkHarness summarizes samples with a slow tail.
+//
+
+#include "benchmarkharness.h"
+#include "testing.h"
+
+TEST(outliersAreLeftOutOfTheMedianButNotTheTail) {
+    vector<double> samples(99, 100);
+    samples.push_back(10000);
+    PhaseStats stats = BenchmarkHarness().summarize("phase", samples);
+    CHECK(stats.samples == 99);
+    CHECK(stats.outliers == 1);
+    CHECK_NEAR(stats.mean, 100, 1e-9);
+    CHECK_NEAR(stats.median, 100, 1e-9);
+    CHECK_NEAR(stats.p90, 100, 1e-9);
+    CHECK(stats.p99 > 100);
+}
+
+TEST(fewSamplesAreKeptWhole) {
+    PhaseStats stats = BenchmarkHarness().summarize("phase", {300, 100, 200});
+    CHECK(stats.samples == 3);
+    CHECK(stats.outliers == 0);
+    CHECK_NEAR(stats.median, 200, 1e-9);
+    CHECK_NEAR(stats.mean, 200, 1e-9);
+}
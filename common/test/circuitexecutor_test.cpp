@@ -0,0 +1,299 @@
+// circuitexecutor_test.cpp : Tests of CircuitExecutor on a backend that evaluates circuits on plaintext slots.
+//
+
+#include <atomic>
+#include <stdexcept>
+#include "circuitexecutor.h"
+#include "distancecircuit.h"
+#include "testing.h"
+
+namespace {
+
+/** Evaluates every operation on plaintext slots, and counts how rotations reach it */
+class PlainBackend {
+
+    public:
+        typedef vector<double> CiphertextType;
+
+        PlainBackend(bool lazyRelin, bool rescaling) : lazyRelin(lazyRelin), rescaling(rescaling) {};
+
+        bool supportsLazyRelinearization() const {
+            return lazyRelin;
+        }
+
+        bool usesRescaling() const {
+            return rescaling;
+        }
+
+        CiphertextType sub(const CiphertextType& a, const CiphertextType& b) const {
+            return zip(a, b, [](double x, double y) { return x - y; });
+        }
+
+        CiphertextType add(const CiphertextType& a, const CiphertextType& b) const {
+            return zip(a, b, [](double x, double y) { return x + y; });
+        }
+
+        CiphertextType mult(const CiphertextType& a, const CiphertextType& b) const {
+            return zip(a, b, [](double x, double y) { return x * y; });
+        }
+
+        CiphertextType square(const CiphertextType& a) const {
+            return mult(a, a);
+        }
+
+        /** Rotates to the left, wrapping around */
+        CiphertextType rotate(const CiphertextType& a, int rotation) const {
+            singleRotations++;
+            return rotateSlots(a, rotation);
+        }
+
+        vector<CiphertextType> rotateMany(const CiphertextType& a, const vector<int>& rotations) const {
+            batchedRotations++;
+            vector<CiphertextType> rotated;
+            for (int rotation : rotations) {
+                rotated.push_back(rotateSlots(a, rotation));
+            }
+            return rotated;
+        }
+
+        CiphertextType relinearize(const CiphertextType& a) const {
+            return a;
+        }
+
+        CiphertextType rescale(const CiphertextType& a) const {
+            return a;
+        }
+
+        mutable atomic<int> singleRotations{0};
+        mutable atomic<int> batchedRotations{0};
+
+    private:
+        bool lazyRelin;
+        bool rescaling;
+
+        static CiphertextType zip(const CiphertextType& a, const CiphertextType& b, double (*op)(double, double)) {
+            CiphertextType result(a.size());
+            for (size_t i = 0; i < a.size(); i++) {
+                result[i] = op(a[i], b[i]);
+            }
+            return result;
+        }
+
+        static CiphertextType rotateSlots(const CiphertextType& a, int rotation) {
+            int n = static_cast<int>(a.size());
+            CiphertextType rotated(a.size());
+            for (int i = 0; i < n; i++) {
+                rotated[i] = a[((i + rotation) % n + n) % n];
+            }
+            return rotated;
+        }
+};
+
+/** A ciphertext of MaintainedBackend: its slots, its number of components and the power of the scale it carries */
+struct MaintainedCiphertext {
+    vector<double> slots;
+    int components = 2;
+    int scaleDegree = 1;
+};
+
+/** @brief Evaluates on plaintext slots like PlainBackend, but with lazy relinearization and rescaling, and throws
+ *  whenever an operation gets operands a real backend could not take: an unrelinearized or unrescaled operand of
+ *  a product, an unrelinearized operand of a rotation, or operands of a sum at different scales.
+ */
+class MaintainedBackend {
+
+    public:
+        typedef MaintainedCiphertext CiphertextType;
+
+        bool supportsLazyRelinearization() const {
+            return true;
+        }
+
+        bool usesRescaling() const {
+            return true;
+        }
+
+        CiphertextType sub(const CiphertextType& a, const CiphertextType& b) const {
+            return combine(a, b, plain.sub(a.slots, b.slots));
+        }
+
+        CiphertextType add(const CiphertextType& a, const CiphertextType& b) const {
+            return combine(a, b, plain.add(a.slots, b.slots));
+        }
+
+        CiphertextType mult(const CiphertextType& a, const CiphertextType& b) const {
+            checkMultiplicand(a);
+            checkMultiplicand(b);
+            return CiphertextType{plain.mult(a.slots, b.slots), 3, a.scaleDegree + b.scaleDegree};
+        }
+
+        CiphertextType square(const CiphertextType& a) const {
+            checkMultiplicand(a);
+            return CiphertextType{plain.square(a.slots), 3, 2 * a.scaleDegree};
+        }
+
+        CiphertextType rotate(const CiphertextType& a, int rotation) const {
+            checkRelinearized(a);
+            return CiphertextType{plain.rotate(a.slots, rotation), a.components, a.scaleDegree};
+        }
+
+        vector<CiphertextType> rotateMany(const CiphertextType& a, const vector<int>& rotations) const {
+            vector<CiphertextType> rotated;
+            for (int rotation : rotations) {
+                rotated.push_back(rotate(a, rotation));
+            }
+            return rotated;
+        }
+
+        CiphertextType relinearize(const CiphertextType& a) const {
+            if (a.components != 3) {
+                throw logic_error("relinearized a ciphertext that is already relinearized");
+            }
+            return CiphertextType{a.slots, 2, a.scaleDegree};
+        }
+
+        CiphertextType rescale(const CiphertextType& a) const {
+            if (a.scaleDegree <= 1) {
+                throw logic_error("rescaled a ciphertext that is already at the base scale");
+            }
+            return CiphertextType{a.slots, a.components, 1};
+        }
+
+    private:
+        PlainBackend plain{false, false};
+
+        static void checkRelinearized(const CiphertextType& a) {
+            if (a.components != 2) {
+                throw logic_error("operand is not relinearized");
+            }
+        }
+
+        static void checkMultiplicand(const CiphertextType& a) {
+            checkRelinearized(a);
+            if (a.scaleDegree != 1) {
+                throw logic_error("operand of a product is not rescaled");
+            }
+        }
+
+        static CiphertextType combine(const CiphertextType& a, const CiphertextType& b, const vector<double>& slots) {
+            if (a.scaleDegree != b.scaleDegree) {
+                throw logic_error("operands of a sum are at different scales");
+            }
+            return CiphertextType{slots, max(a.components, b.components), a.scaleDegree};
+        }
+};
+
+/** Checks that the compiled circuit computes what the circuit does when evaluated node by node, with every
+ *  output relinearized and rescaled, and returns the compiled circuit
+ */
+Circuit checkCompiledMatchesUnoptimized(const Circuit& circuit, const vector<vector<double>>& inputs) {
+    PlainBackend plain(false, false);
+    vector<vector<double>> expected = CircuitExecutor<PlainBackend>(&plain, 1).execute(circuit, inputs);
+
+    MaintainedBackend maintained;
+    CircuitExecutor<MaintainedBackend> executor(&maintained, 4);
+    Circuit compiled = executor.compile(circuit);
+    vector<MaintainedCiphertext> maintainedInputs;
+    for (const vector<double>& input : inputs) {
+        maintainedInputs.push_back(MaintainedCiphertext{input, 2, 1});
+    }
+    vector<MaintainedCiphertext> outputs = executor.execute(compiled, maintainedInputs);
+
+    CHECK(outputs.size() == expected.size());
+    for (size_t i = 0; i < outputs.size() && i < expected.size(); i++) {
+        CHECK(outputs[i].components == 2);
+        CHECK(outputs[i].scaleDegree == 1);
+        CHECK(outputs[i].slots == expected[i]);
+    }
+    return compiled;
+}
+
+size_t countOps(const Circuit& circuit, CircuitOp op) {
+    size_t count = 0;
+    for (const CircuitNode& node : circuit.getNodes()) {
+        count += node.op == op ? 1 : 0;
+    }
+    return count;
+}
+
+}
+
+TEST(slotSumRotationsOfOneValueShareOneRotateMany) {
+    PlainBackend backend(true, true);
+    CircuitExecutor<PlainBackend> executor(&backend, 4);
+    Circuit circuit = executor.compile(buildSlotSumCircuit(8));
+    vector<vector<double>> outputs = executor.execute(circuit, {{1, 2, 3, 4, 5, 6, 7, 8, 9}});
+    CHECK(outputs.size() == 1);
+    CHECK_NEAR(outputs[0][0], 36, 0);
+    CHECK_NEAR(outputs[0][1], 44, 0);
+    CHECK(backend.batchedRotations == 1);
+    CHECK(backend.singleRotations == 0);
+}
+
+TEST(singleRotationIsNotBatched) {
+    PlainBackend backend(true, true);
+    CircuitExecutor<PlainBackend> executor(&backend, 4);
+    Circuit circuit = executor.compile(buildSlotSumCircuit(2));
+    vector<vector<double>> outputs = executor.execute(circuit, {{1, 2, 3}});
+    CHECK_NEAR(outputs[0][0], 3, 0);
+    CHECK_NEAR(outputs[0][2], 4, 0);
+    CHECK(backend.batchedRotations == 0);
+    CHECK(backend.singleRotations == 1);
+}
+
+TEST(compiledDistanceCircuitMatchesUnoptimized) {
+    Circuit compiled = checkCompiledMatchesUnoptimized(buildDistanceSquaredCircuit(), {{1, -2, 3}, {4, 5, -6}, {7, 8, 9}, {0.5, 1, 2}});
+    // The sum of the two squares is relinearized and rescaled once
+    CHECK(countOps(compiled, CircuitOp::Relin) == 1);
+    CHECK(countOps(compiled, CircuitOp::Rescale) == 1);
+}
+
+TEST(commonSubexpressionsAndDeadNodesAreRemoved) {
+    Circuit circuit;
+    size_t x = circuit.input("x");
+    size_t y = circuit.input("y");
+    size_t difference = circuit.sub(x, y);
+    size_t product = circuit.mult(circuit.sub(x, y), difference); // a square once both differences are merged
+    circuit.mult(x, y); // read by no output
+    circuit.output(circuit.add(product, circuit.add(y, x)));
+    circuit.output(circuit.add(circuit.add(x, y), product));
+
+    Circuit compiled = checkCompiledMatchesUnoptimized(circuit, {{1, 2, 3}, {-4, 0.25, 6}});
+    CHECK(countOps(compiled, CircuitOp::Sub) == 1);
+    CHECK(countOps(compiled, CircuitOp::Square) == 1);
+    CHECK(countOps(compiled, CircuitOp::Mult) == 0);
+    CHECK(countOps(compiled, CircuitOp::Add) == 2);
+    CHECK(compiled.getOutputs().size() == 2);
+    CHECK(compiled.getOutputs().size() == 2 && compiled.getOutputs()[0] == compiled.getOutputs()[1]);
+}
+
+TEST(compiledDeeperCircuitMatchesUnoptimized) {
+    // (x * y)^2 + x * y + x and a rotation of x * y: products feed products, sums of products meet fresh values
+    Circuit circuit;
+    size_t x = circuit.input("x");
+    size_t y = circuit.input("y");
+    size_t product = circuit.mult(x, y);
+    circuit.output(circuit.add(circuit.add(circuit.mult(product, product), product), x));
+    circuit.output(circuit.rotate(product, 1));
+    checkCompiledMatchesUnoptimized(circuit, {{1, 2, 3, 4}, {2, -1, 0.5, 3}});
+}
+
+TEST(compiledSlotSumMatchesUnoptimized) {
+    checkCompiledMatchesUnoptimized(buildSlotSumCircuit(5), {{1, 2, 3, 4, 5, 6, 7, 8}});
+}
+
+TEST(uncompiledCircuitIsRejectedByMaintainedBackend) {
+    // Without the passes the square of x is neither relinearized nor rescaled before it is squared again
+    Circuit circuit;
+    size_t x = circuit.input("x");
+    size_t product = circuit.square(circuit.square(x));
+    circuit.output(product);
+    MaintainedBackend maintained;
+    bool rejected = false;
+    try {
+        CircuitExecutor<MaintainedBackend>(&maintained, 1).execute(circuit, {MaintainedCiphertext{{1, 2}, 2, 1}});
+    } catch (const logic_error&) {
+        rejected = true;
+    }
+    CHECK(rejected);
+}
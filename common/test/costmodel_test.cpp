@@ -0,0 +1,61 @@
+// costmodel_test.cpp : Tests of CostModel's estimates and of how observations rescale each cost family.
+//
+
+#include "costmodel.h"
+#include "testing.h"
+
+namespace {
+
+const CostShape RNSShape{8192, 218, 4, 1, 4};
+const CostShape PolyShape{8192, 218, 16, 0, 4, CostFamily::Poly};
+
+}
+
+TEST(estimatesGrowWithTheRingDimensionAndLimbs) {
+    CostModel costModel(1e-6, 1e-6);
+    CostShape wider = RNSShape;
+    wider.ringDimension *= 2;
+    CostShape deeper = RNSShape;
+    deeper.limbs *= 2;
+    double time = costModel.estimate(RNSShape).getWorkloadTime(4, 2, 5);
+    CHECK(costModel.estimate(wider).getWorkloadTime(4, 2, 5) > time);
+    CHECK(costModel.estimate(deeper).getWorkloadTime(4, 2, 5) > time);
+    CHECK(costModel.estimate(wider).memory == 2 * costModel.estimate(RNSShape).memory);
+}
+
+TEST(eachFamilyIsRescaledByItsOwnObservations) {
+    CostModel costModel(1e-6, 1e-6);
+    double rnsTime = costModel.estimate(RNSShape).getWorkloadTime(4, 2, 5);
+    double polyTime = costModel.estimate(PolyShape).getWorkloadTime(4, 2, 5);
+    costModel.addObservation(CostFamily::RNS, rnsTime, 10 * rnsTime);
+    // Until it has observations of its own, Poly is predicted with the factor of RNS
+    costModel.addObservation(CostFamily::Poly, costModel.estimate(PolyShape).getWorkloadTime(4, 2, 5), 2 * polyTime);
+    CHECK_NEAR(costModel.getCalibration(CostFamily::RNS), 10, 1e-9);
+    CHECK_NEAR(costModel.getCalibration(CostFamily::Poly), 2, 1e-9);
+    CHECK_NEAR(costModel.estimate(RNSShape).getWorkloadTime(4, 2, 5), 10 * rnsTime, 1e-9 * rnsTime);
+    CHECK_NEAR(costModel.estimate(PolyShape).getWorkloadTime(4, 2, 5), 2 * polyTime, 1e-9 * polyTime);
+}
+
+TEST(observationsAreAveragedGeometricallyAndAgainstTheUnscaledModel) {
+    CostModel costModel(1e-6, 1e-6);
+    costModel.addObservation(CostFamily::RNS, 1, 2);
+    // Predicted by the rescaled model, so it is 8 times the synthetic estimate of 0.5
+    costModel.addObservation(CostFamily::RNS, 1, 4);
+    CHECK_NEAR(costModel.getCalibration(CostFamily::RNS), 4, 1e-9);
+    // Both against the synthetic estimate of 1, so they are 8 and 32 times it
+    costModel.addObservations(CostFamily::RNS, {{4, 8}, {4, 32}});
+    CHECK_NEAR(costModel.getCalibration(CostFamily::RNS), 8, 1e-9);
+}
+
+TEST(aFamilyWithoutObservationsUsesAllOfThem) {
+    CostModel costModel(1e-6, 1e-6);
+    CHECK_NEAR(costModel.getCalibration(CostFamily::Poly), 1, 0);
+    costModel.addObservation(CostFamily::RNS, 1, 3);
+    CHECK_NEAR(costModel.getCalibration(CostFamily::Poly), 3, 1e-9);
+}
+
+TEST(minRingDimensionFollowsTheStandard) {
+    CHECK(CostModel::getMinRingDimension(54) == 2048);
+    CHECK(CostModel::getMinRingDimension(55) == 4096);
+    CHECK(CostModel::getMinRingDimension(900) == 65536);
+}
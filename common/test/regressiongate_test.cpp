@@ -0,0 +1,102 @@
+// regressiongate_test.cpp : Tests of RegressionGate on synthetic sweeps of the size of a recorded baseline.
+//
+
+#include <random>
+#include "regressiongate.h"
+#include "testing.h"
+
+namespace {
+
+const size_t Sets = 30;
+const size_t Phases = 9;
+const size_t Runs = 10;
+
+/** Returns `Runs` runs of each of `Sets` sets of `Phases` phases, with 5% noise; the set `slowSet` is `slowdown` times slower */
+vector<RunRecord> makeSweep(unsigned seed, size_t slowSet = Sets, double slowdown = 1) {
+    mt19937 generator(seed);
+    normal_distribution<double> noise(1, 0.05);
+    vector<RunRecord> records;
+    for (size_t set = 0; set < Sets; set++) {
+        for (size_t run = 0; run < Runs; run++) {
+            RunRecord record = RunRecord();
+            record.library = "PALISADE";
+            record.scheme = "BGVrns";
+            record.paramSet = to_string(set);
+            for (size_t phase = 0; phase < Phases; phase++) {
+                double time = 10.0 * (phase + 1) * (set + 1) * noise(generator);
+                record.phases.push_back({"phase " + to_string(phase), set == slowSet ? slowdown * time : time});
+            }
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+size_t countRegressed(const vector<RegressionResult>& results) {
+    size_t regressed = 0;
+    for (const RegressionResult& result : results) {
+        regressed += result.regressed ? 1 : 0;
+    }
+    return regressed;
+}
+
+}
+
+TEST(twoFoldSlowdownFailsTheGate) {
+    vector<RegressionResult> results = RegressionGate().compare(makeSweep(1), makeSweep(2, 7, 2));
+    CHECK(results.size() == Sets);
+    CHECK(RegressionGate::hasRegression(results));
+    CHECK(countRegressed(results) == 1);
+    for (const RegressionResult& result : results) {
+        CHECK(result.regressed == (result.name == "PALISADE BGVrns 7"));
+        CHECK(!result.missing);
+    }
+}
+
+TEST(unchangedSweepPassesTheGate) {
+    for (unsigned seed = 2; seed < 12; seed++) {
+        vector<RegressionResult> results = RegressionGate().compare(makeSweep(1), makeSweep(seed));
+        CHECK(!RegressionGate::hasRegression(results));
+    }
+}
+
+TEST(smallSlowdownIsNotARegression) {
+    // Significant with 10 runs, but under the 10% minimum slowdown
+    vector<RegressionResult> results = RegressionGate().compare(makeSweep(1), makeSweep(2, 7, 1.05));
+    CHECK(!RegressionGate::hasRegression(results));
+}
+
+TEST(missingSetOrPhaseFailsTheGate) {
+    vector<RunRecord> current = makeSweep(2);
+    current.erase(current.begin(), current.begin() + Runs); // set 0
+    for (RunRecord& record : current) {
+        if (record.paramSet == "1") {
+            record.phases.pop_back();
+        }
+    }
+    vector<RegressionResult> results = RegressionGate().compare(makeSweep(1), current);
+    CHECK(RegressionGate::hasRegression(results));
+    for (const RegressionResult& result : results) {
+        CHECK(result.missing == (result.name == "PALISADE BGVrns 0" || result.name == "PALISADE BGVrns 1"));
+    }
+}
+
+TEST(exactPValueMatchesTheNumberOfOrderings) {
+    CHECK_NEAR(RegressionGate::getMinPValue(10, 10), 1.0 / 184756, 1e-12);
+    CHECK_NEAR(RegressionGate::getMinPValue(5, 5), 1.0 / 252, 1e-12);
+
+    // Every sample of the fresh sweep is slower, so its p-value is the smallest possible
+    vector<RunRecord> baseline = makeSweep(1);
+    vector<RunRecord> current = makeSweep(2, 0, 10);
+    vector<RegressionResult> results = RegressionGate().compare(baseline, current);
+    CHECK_NEAR(results[0].pValue, RegressionGate::getMinPValue(Runs, Runs), 1e-12);
+}
+
+TEST(requiredRunsReachTheCorrectedSignificance) {
+    RegressionGate gate;
+    size_t runs = gate.getRequiredRuns(Sets);
+    CHECK(RegressionGate::getMinPValue(runs, runs) <= 0.01 / Sets);
+    CHECK(RegressionGate::getMinPValue(runs - 1, runs - 1) > 0.01 / Sets);
+    CHECK(gate.getRequiredRuns(270) >= runs);
+    CHECK(gate.getRequiredRuns(1) == 5); // never below minSamples
+}
@@ -0,0 +1,89 @@
+// resultswriter_test.cpp : Tests that the records ResultsWriter writes read back through ResultsReader unchanged.
+//
+
+#include <cstdio>
+#include "regressiongate.h"
+#include "resultswriter.h"
+#include "testing.h"
+
+namespace {
+
+/** Returns a record whose strings need quoting in both formats */
+RunRecord makeRecord(const string& paramSet, double scale) {
+    RunRecord record = RunRecord();
+    record.library = "PALISADE";
+    record.scheme = "CKKS";
+    record.paramSet = paramSet;
+    record.ringDimension = 8192;
+    record.scale = 1099511627776.0 * scale;
+    record.phases = {{"Key generation", 12.5}, {"Encryption, 2 inputs", 3.25}, {"Distance \"squared\"", 0.1 + 0.2}};
+    record.correct = true;
+    record.peakRSS = {{"Key generation", 1 << 20}};
+    record.counters = {{"Key generation", CounterSample()}};
+    return record;
+}
+
+void checkRoundTrip(const string& path) {
+    remove(path.c_str());
+    vector<RunRecord> written = {makeRecord("1", 1), makeRecord("2, larger", 2)};
+    written[1].correct = false;
+    {
+        ResultsWriter writer(path);
+        for (const RunRecord& record : written) {
+            writer.write(record);
+        }
+    }
+    vector<RunRecord> read = ResultsReader::read(path);
+    remove(path.c_str());
+
+    CHECK(read.size() == written.size());
+    for (size_t i = 0; i < read.size() && i < written.size(); i++) {
+        CHECK(read[i].library == written[i].library);
+        CHECK(read[i].scheme == written[i].scheme);
+        CHECK(read[i].paramSet == written[i].paramSet);
+        CHECK(read[i].correct == written[i].correct);
+        CHECK(read[i].phases.size() == written[i].phases.size());
+        for (size_t j = 0; j < read[i].phases.size() && j < written[i].phases.size(); j++) {
+            CHECK(read[i].phases[j].first == written[i].phases[j].first);
+            CHECK(read[i].phases[j].second == written[i].phases[j].second); // written with 17 digits, so exactly
+        }
+    }
+}
+
+}
+
+TEST(csvRoundTrip) {
+    checkRoundTrip("resultswriter_test.csv");
+}
+
+TEST(jsonLinesRoundTrip) {
+    checkRoundTrip("resultswriter_test.jsonl");
+}
+
+TEST(successiveWritersAppendToTheSameFile) {
+    for (const string path : {"resultswriter_test_append.csv", "resultswriter_test_append.jsonl"}) {
+        remove(path.c_str());
+        ResultsWriter(path).write(makeRecord("1", 1));
+        ResultsWriter(path).write(makeRecord("2", 1));
+        vector<RunRecord> read = ResultsReader::read(path);
+        remove(path.c_str());
+        CHECK(read.size() == 2);
+        CHECK(read.size() == 2 && read[0].paramSet == "1" && read[1].paramSet == "2");
+    }
+}
+
+TEST(fileOfAnotherSchemaIsRefused) {
+    string path = "resultswriter_test_old.csv";
+    {
+        ofstream file(path);
+        file << "schema_version,timestamp,run,library" << endl;
+    }
+    bool refused = false;
+    try {
+        ResultsWriter writer(path);
+    } catch (const runtime_error&) {
+        refused = true;
+    }
+    remove(path.c_str());
+    CHECK(refused);
+}
@@ -0,0 +1,60 @@
+// sweepscheduler_test.cpp : Tests of which sweep tasks SweepScheduler reruns in isolation.
+//
+
+#include "sweepscheduler.h"
+#include "testing.h"
+
+#ifndef _WIN32
+#include <cstdio>
+#include <unistd.h>
+
+namespace {
+
+/** A task that reports `parallelTime` ms the first time it runs and `isolatedTime` ms afterwards, at `mpki` */
+SweepTask makeTask(const string& name, double parallelTime, double isolatedTime, double mpki) {
+    string marker = "/tmp/sweepscheduler_test_" + to_string(getpid()) + "_" + name;
+    remove(marker.c_str());
+    ostringstream command;
+    command << "if [ -f " << marker << " ]; then echo SWEEP_RESULT " << isolatedTime << " " << isolatedTime << " " << mpki
+        << "; else touch " << marker << "; echo SWEEP_RESULT " << parallelTime << " " << parallelTime << " " << mpki << "; fi";
+    return {name, command.str(), 0};
+}
+
+void removeMarkers(const vector<SweepTask>& tasks) {
+    for (const SweepTask& task : tasks) {
+        remove(("/tmp/sweepscheduler_test_" + to_string(getpid()) + "_" + task.name).c_str());
+    }
+}
+
+}
+
+TEST(rerunsStopAtTheFirstTaskThatWasNotSlowedDown) {
+    vector<SweepTask> tasks = {makeTask("a", 10, 5, 20), makeTask("b", 10, 5, 10), makeTask("c", 10, 10, 5),
+                               makeTask("d", 10, 5, 2), makeTask("e", 10, 5, 0.5)};
+    SweepScheduler scheduler(2, false);
+    double memoryBoundMPKI = 0;
+    vector<SweepResult> results = scheduler.run(tasks, &memoryBoundMPKI);
+    removeMarkers(tasks);
+
+    CHECK_NEAR(memoryBoundMPKI, 10, 0);
+    CHECK(results[0].rerunInIsolation && results[1].rerunInIsolation && results[2].rerunInIsolation);
+    CHECK_NEAR(results[0].wallTime, 5, 0);
+    CHECK_NEAR(results[0].slowdown, 2, 1e-9);
+    CHECK_NEAR(results[2].slowdown, 1, 1e-9);
+    CHECK(!results[3].rerunInIsolation);
+    CHECK(!results[4].rerunInIsolation);
+    CHECK_NEAR(results[3].wallTime, 10, 0);
+}
+
+TEST(noSlowedTaskReportsNoBound) {
+    vector<SweepTask> tasks = {makeTask("f", 10, 10, 20), makeTask("g", 10, 5, 10)};
+    SweepScheduler scheduler(2, false);
+    double memoryBoundMPKI = 0;
+    vector<SweepResult> results = scheduler.run(tasks, &memoryBoundMPKI);
+    removeMarkers(tasks);
+
+    CHECK_NEAR(memoryBoundMPKI, -1, 0);
+    CHECK(results[0].rerunInIsolation);
+    CHECK(!results[1].rerunInIsolation);
+}
+#endif
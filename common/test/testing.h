@@ -0,0 +1,83 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using std::vector;
+
+/** @brief A minimal test runner, so that the tests do not depend on a framework the libraries' toolchains lack.
+ *
+ * TEST(name) defines a test that registers itself before main runs; CHECK and CHECK_NEAR record a failure and
+ * carry on, so that one run reports every failed check. runAllTests returns the exit code for ctest.
+ */
+class TestRegistry {
+
+    public:
+        static vector<pair<string, function<void()>>>& getTests() {
+            static vector<pair<string, function<void()>>> tests;
+            return tests;
+        }
+
+        static int& getFailures() {
+            static int failures = 0;
+            return failures;
+        }
+
+        static void fail(const char* file, int line, const string& message) {
+            cout << file << ":" << line << ": " << message << endl;
+            getFailures()++;
+        }
+
+        static int runAllTests() {
+            int failedTests = 0;
+            for (const auto& test : getTests()) {
+                int failures = getFailures();
+                try {
+                    test.second();
+                } catch (const exception& e) {
+                    fail(test.first.c_str(), 0, string("threw ") + e.what());
+                }
+                bool passed = getFailures() == failures;
+                failedTests += passed ? 0 : 1;
+                cout << (passed ? "[ PASSED ] " : "[ FAILED ] ") << test.first << endl;
+            }
+            cout << getTests().size() - failedTests << " of " << getTests().size() << " tests passed" << endl;
+            return failedTests == 0 ? 0 : 1;
+        }
+};
+
+struct TestRegistrar {
+    TestRegistrar(const string& name, function<void()> test) {
+        TestRegistry::getTests().push_back({name, test});
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            TestRegistry::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double checkActual = (actual); \
+        double checkExpected = (expected); \
+        if (!(std::abs(checkActual - checkExpected) <= (tolerance))) { \
+            TestRegistry::fail(__FILE__, __LINE__, "CHECK_NEAR(" #actual ", " #expected ") failed: " \
+                               + to_string(checkActual) + " vs " + to_string(checkExpected)); \
+        } \
+    } while (0)
+
+#endif // TESTING_H
@@ -0,0 +1,186 @@
+#ifndef DEPTHMEASURER_H
+#define DEPTHMEASURER_H
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <palisade.h>
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Measures how many levels of squaring a parameter set supports for the exact schemes (BGV and BGVrns).
+ *
+ *  x^{2^d} is computed by squaring, keeping the ciphertext of every level as a checkpoint, but only a few
+ *  of them are checked: the depth is found by doubling the probed level until a check fails and then
+ *  binary-searching between the last correct and the first incorrect level, so a depth of d costs
+ *  about 2 log2(d) decryptions instead of d. A check decrypts without re-encoding the expected value:
+ *  the first coefficient is compared with x^{2^d} mod p computed in the clear, and the noise budget,
+ *  log2(q / 2) - log2 |c0 + c1 s + ...|, is reported alongside. The search never goes past `maxDepth`,
+ *  so parameter sets on which x stays correct (e.g. x = 1) still terminate.
+ */
+template <class Element>
+class DepthMeasurer {
+
+    public:
+        DepthMeasurer(const CryptoContext<Element>& cc, const LPPrivateKey<Element>& secretKey, size_t maxDepth = 32)
+            : cc(cc), secretKey(secretKey), maxDepth(maxDepth), decryptions(0) {};
+        ~DepthMeasurer() {};
+
+        /** Returns the largest depth d, up to `maxDepth`, such that x^{2^d} decrypts correctly, where x encrypts `seed` */
+        size_t measure(const Ciphertext<Element>& x, int64_t seed) {
+            checkpoints.clear();
+            checkpoints[0] = x;
+            lastSquared = 0;
+            decryptions = 0;
+
+            size_t low = 0; // fresh ciphertexts are taken to be correct
+            size_t high = maxDepth + 1; // the first level known to be incorrect
+            for (size_t probe = 1; probe <= maxDepth; probe = min(2 * probe, maxDepth)) {
+                if (!check(probe, seed)) {
+                    high = probe;
+                    break;
+                }
+                low = probe;
+                if (probe == maxDepth) {
+                    break;
+                }
+                dropCheckpointsBelow(low);
+            }
+
+            while (high <= maxDepth && high - low > 1) {
+                size_t middle = (low + high) / 2;
+                if (check(middle, seed)) {
+                    low = middle;
+                    dropCheckpointsBelow(low);
+                } else {
+                    high = middle;
+                }
+            }
+            return low;
+        }
+
+        size_t getMaxDepth() const {
+            return maxDepth;
+        }
+
+        /** Returns the number of decryptions done by the last measurement */
+        size_t getDecryptions() const {
+            return decryptions;
+        }
+
+        /** Returns the noise budget of a ciphertext in bits; it is at most 0 once decryption fails */
+        static int getNoiseBudget(const Ciphertext<Element>& ciphertext, const LPPrivateKey<Element>& secretKey) {
+            const vector<Element>& elements = ciphertext->GetElements();
+            Element s = matchModulus(secretKey->GetPrivateElement(), elements[0]);
+            Element sPower = s;
+            Element sum = elements[0];
+            for (size_t i = 1; i < elements.size(); i++) {
+                sum += elements[i] * sPower;
+                sPower = sPower * s;
+            }
+            sum.SetFormat(COEFFICIENT);
+            Poly poly = toPoly(sum);
+
+            const BigInteger& q = poly.GetModulus();
+            BigInteger maxCoef(0);
+            for (usint i = 0; i < poly.GetLength(); i++) {
+                BigInteger coef = poly[i];
+                BigInteger centered = coef > (q >> 1) ? q - coef : coef;
+                maxCoef = max(maxCoef, centered);
+            }
+            return static_cast<int>(q.GetMSB()) - 1 - static_cast<int>(maxCoef.GetMSB());
+        }
+
+    private:
+        CryptoContext<Element> cc;
+        LPPrivateKey<Element> secretKey;
+        size_t maxDepth;
+        size_t decryptions;
+        map<size_t, Ciphertext<Element>> checkpoints;
+        size_t lastSquared;
+
+        /** Returns x^{2^depth}, or nullptr if the library could not compute it (e.g. the towers ran out) */
+        Ciphertext<Element> getCheckpoint(size_t depth) {
+            auto iter = checkpoints.find(depth);
+            if (iter != checkpoints.end()) {
+                return iter->second;
+            }
+            Ciphertext<Element> power = checkpoints.at(lastSquared);
+            while (lastSquared < depth) {
+                try {
+                    power = power ? cc->EvalMult(power, power) : nullptr;
+                } catch (const exception&) {
+                    power = nullptr;
+                }
+                checkpoints[++lastSquared] = power;
+            }
+            return power;
+        }
+
+        void dropCheckpointsBelow(size_t depth) {
+            checkpoints.erase(checkpoints.begin(), checkpoints.lower_bound(depth));
+        }
+
+        bool check(size_t depth, int64_t seed) {
+            Ciphertext<Element> power = getCheckpoint(depth);
+            if (!power) {
+                cout << "x^{2^" << depth << "}: could not be computed" << endl;
+                return false;
+            }
+
+            PlaintextModulus p = cc->GetCryptoParameters()->GetPlaintextModulus();
+            NativeInteger modulus(p);
+            NativeInteger expected(((seed % static_cast<int64_t>(p)) + p) % p);
+            for (size_t i = 0; i < depth; i++) {
+                expected = expected.ModMul(expected, modulus);
+            }
+
+            Plaintext decrypted;
+            decryptions++;
+            bool correct;
+            try {
+                cc->Decrypt(secretKey, power, &decrypted);
+                int64_t value = decrypted->GetCoefPackedValue()[0];
+                correct = static_cast<uint64_t>(((value % static_cast<int64_t>(p)) + p) % p) == expected.ConvertToInt();
+            } catch (const exception&) {
+                correct = false;
+            }
+            cout << "x^{2^" << depth << "}: noise budget " << getNoiseBudget(power, secretKey) << " bits, "
+                << (correct ? "Successful" : "Failed") << endl;
+            return correct;
+        }
+
+        static Element matchModulus(const Element& s, const Element& target);
+        static Poly toPoly(const Element& element);
+};
+
+template <>
+inline Poly DepthMeasurer<Poly>::matchModulus(const Poly& s, const Poly& /*target*/) {
+    return s;
+}
+
+template <>
+inline Poly DepthMeasurer<Poly>::toPoly(const Poly& element) {
+    return element;
+}
+
+/** The secret key keeps every tower, while ModReduce and LevelReduce drop the last towers of a ciphertext */
+template <>
+inline DCRTPoly DepthMeasurer<DCRTPoly>::matchModulus(const DCRTPoly& s, const DCRTPoly& target) {
+    DCRTPoly matched = s;
+    if (matched.GetNumOfElements() > target.GetNumOfElements()) {
+        matched.DropLastElements(matched.GetNumOfElements() - target.GetNumOfElements());
+    }
+    return matched;
+}
+
+template <>
+inline Poly DepthMeasurer<DCRTPoly>::toPoly(const DCRTPoly& element) {
+    return element.CRTInterpolate();
+}
+
+#endif // DEPTHMEASURER_H
@@ -1,8 +1,16 @@
 #ifndef DISTANCECOMPUTER_H
 #define DISTANCECOMPUTER_H
 
+#include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 #include <palisade.h>
+#include "circuitexecutor.h"
+#include "distancecircuit.h"
+#include "palisadebackend.h"
+#include "squareddifferencesum.h"
+#include "tracer.h"
 
 using namespace std;
 using namespace lbcrypto;
@@ -18,6 +26,11 @@ class DistanceComputer {
         DistanceComputer() {};
         virtual ~DistanceComputer() {};
 
+        /** Records a span for every stage of the homomorphic evaluations, and for every circuit node; nullptr disables it */
+        void setTracer(Tracer* tracer) {
+            this->tracer = tracer;
+        }
+
         vector<T> computeDistanceSquared(T x1, T y1, T x2, T y2) {
             cout << "Evaluating square of distance between (" << x1 << ", " << y1
                 << ") and (" << x2 << ", " << y1 << ")" <<  endl;
@@ -31,64 +44,147 @@ class DistanceComputer {
             return distanceSquaredVector;
         }
 
-        virtual Ciphertext<Element> computeDistanceSquared(Ciphertext<Element> x1, Ciphertext<Element> y1,
-                                                           Ciphertext<Element> x2, Ciphertext<Element> y2,
-                                                           CryptoContext<Element> cc, LPPrivateKey<Element> secretKey,
-                                                           bool supportsComposedMult);
+        /** Inputs are taken by reference and are never modified; intermediate results
+         *  are owned by this method, so they are evaluated with the mutable (in-place) operations
+         */
+        virtual Ciphertext<Element> computeDistanceSquared(const Ciphertext<Element>& x1, const Ciphertext<Element>& y1,
+                                                           const Ciphertext<Element>& x2, const Ciphertext<Element>& y2,
+                                                           const CryptoContext<Element>& cc, const LPPrivateKey<Element>& secretKey,
+                                                           bool supportsComposedMult, bool supportsDeferredRelin);
+
+        /** Evaluates the distance circuit after common-subexpression elimination and lazy
+         *  relinearization/rescale placement, running the xDiff and yDiff branches concurrently.
+         *  The circuit is compiled once per combination of flags, and the executor is only rebuilt for a new context.
+         */
+        Ciphertext<Element> computeDistanceSquaredCircuit(const Ciphertext<Element>& x1, const Ciphertext<Element>& y1,
+                                                          const Ciphertext<Element>& x2, const Ciphertext<Element>& y2,
+                                                          const CryptoContext<Element>& cc,
+                                                          bool supportsComposedMult, bool supportsDeferredRelin) {
+            cout << "Homomorphically evaluating square of distance with the optimized circuit..." << endl;
+            Tracer::Stages stages(tracer, "distance");
+            pair<bool, bool> flags(supportsComposedMult, supportsDeferredRelin);
+            if (executor == nullptr || cc != circuitContext || flags != circuitFlags) {
+                backend.reset(new PalisadeBackend<Element>(cc, supportsComposedMult, supportsDeferredRelin));
+                executor.reset(new CircuitExecutor<PalisadeBackend<Element>>(backend.get()));
+                circuitContext = cc;
+                circuitFlags = flags;
+            }
+            executor->setTracer(tracer);
+            if (compiledCircuits.find(flags) == compiledCircuits.end()) {
+                stages.begin("compile circuit");
+                compiledCircuits[flags] = executor->compile(buildDistanceSquaredCircuit());
+            }
+            stages.begin("execute circuit");
+            return executor->execute(compiledCircuits[flags], {x1, y1, x2, y2})[0];
+        }
+
+        /** Evaluates the distance with the fused squared-difference-sum kernel, relinearizing once */
+        Ciphertext<Element> computeDistanceSquaredFused(const Ciphertext<Element>& x1, const Ciphertext<Element>& y1,
+                                                        const Ciphertext<Element>& x2, const Ciphertext<Element>& y2,
+                                                        const CryptoContext<Element>& cc, bool supportsComposedMult) {
+            cout << "Homomorphically evaluating square of distance with the fused kernel..." << endl;
+            Tracer::Span span(tracer, "fused kernel", "distance");
+            auto sum = SquaredDifferenceSum<Element>::evaluate(cc, {x1, y1}, {x2, y2});
+            if (supportsComposedMult) {
+                sum = cc->ModReduce(sum); // the modulus reduction ComposedEvalMult would have performed
+            }
+            return sum;
+        }
 
     private:
+        Tracer* tracer = nullptr;
+        // State of computeDistanceSquaredCircuit
+        CryptoContext<Element> circuitContext;
+        pair<bool, bool> circuitFlags; // supportsComposedMult, supportsDeferredRelin
+        unique_ptr<PalisadeBackend<Element>> backend;
+        unique_ptr<CircuitExecutor<PalisadeBackend<Element>>> executor;
+        map<pair<bool, bool>, Circuit> compiledCircuits; // by circuitFlags
+
         // To check intermediate computation steps
-        Plaintext decrypt(Ciphertext<Element> ciphertext, CryptoContext<Element> cryptoContext, LPPrivateKey<Element> secretKey);
+        Plaintext decrypt(const Ciphertext<Element>& ciphertext, const CryptoContext<Element>& cryptoContext,
+                          const LPPrivateKey<Element>& secretKey);
 };
 
 #endif // DISTANCECOMPUTER_H
 
 template <class Element, typename T>
-Ciphertext<Element> DistanceComputer<Element, T>::computeDistanceSquared(Ciphertext<Element> x1, Ciphertext<Element> y1,
-                                                                         Ciphertext<Element> x2, Ciphertext<Element> y2,
-                                                                         CryptoContext<Element> cc, LPPrivateKey<Element> secretKey,
-                                                                         bool supportsComposedMult) {
+Ciphertext<Element> DistanceComputer<Element, T>::computeDistanceSquared(const Ciphertext<Element>& x1, const Ciphertext<Element>& y1,
+                                                                         const Ciphertext<Element>& x2, const Ciphertext<Element>& y2,
+                                                                         const CryptoContext<Element>& cc, const LPPrivateKey<Element>& secretKey,
+                                                                         bool supportsComposedMult, bool supportsDeferredRelin) {
     cout << "Homomorphically evaluating square of distance..." << endl;
+    // Every stage runs up to the next one; the decryptions that check intermediate results are stages of their own
+    Tracer::Stages stages(tracer, "distance");
 
+    stages.begin("xDiff");
     cout << "Computing xDiff..." << endl;
     auto xDiff = cc->EvalSub(x1, x2);
 
+    stages.begin("check xDiff");
     Plaintext xDiffDecrypt = decrypt(xDiff, cc, secretKey);
     cout << "Decrypted " << "xDiff: " << xDiffDecrypt << endl;
 
+    stages.begin("yDiff");
     cout << "Computing yDiff..." << endl;
     auto yDiff = cc->EvalSub(y1, y2);
 
+    stages.begin("check yDiff");
     Plaintext yDiffDecrypt = decrypt(yDiff, cc, secretKey);
     cout << "Decrypted " << "yDiff: " << yDiffDecrypt << endl;
 
     Ciphertext<Element> xDiffSq;
     Ciphertext<Element> yDiffSq;
-    if (supportsComposedMult) {
+    if (supportsDeferredRelin) {
+        // Both products stay unrelinearized so that only the sum needs a key switch
+        stages.begin("xDiffSq");
+        cout << "Computing xDiffSq without relinearization..." << endl;
+        xDiffSq = cc->EvalMultNoRelin(xDiff, xDiff);
+        stages.begin("yDiffSq");
+        cout << "Computing yDiffSq without relinearization..." << endl;
+        yDiffSq = cc->EvalMultNoRelin(yDiff, yDiff);
+    } else if (supportsComposedMult) {
+        stages.begin("xDiffSq");
         cout << "Computing xDiffSq..." << endl;
         xDiffSq = cc->ComposedEvalMult(xDiff, xDiff);
+        stages.begin("yDiffSq");
         cout << "Computing yDiffSq..." << endl;
         yDiffSq = cc->ComposedEvalMult(yDiff, yDiff);
     } else {
+        stages.begin("xDiffSq");
         cout << "Computing xDiffSq..." << endl;
-        xDiffSq = cc->EvalMult(xDiff, xDiff);
+        xDiffSq = cc->EvalMultMutable(xDiff, xDiff);
+        stages.begin("yDiffSq");
         cout << "Computing yDiffSq..." << endl;
-        yDiffSq = cc->EvalMult(yDiff, yDiff);
+        yDiffSq = cc->EvalMultMutable(yDiff, yDiff);
     }
 
+    stages.begin("check xDiffSq");
     Plaintext xDiffSqDecrypt = decrypt(xDiffSq, cc, secretKey);
     cout << "Decrypted " << "xDiffSq: " << xDiffSqDecrypt << endl;
 
+    stages.begin("check yDiffSq");
     Plaintext yDiffSqDecrypt = decrypt(yDiffSq, cc, secretKey);
     cout << "Decrypted " << "yDiffSq: " << yDiffSqDecrypt << endl;
 
+    stages.begin("sum");
     cout << "Computing total sum..." << endl;
-    auto sum = cc->EvalAdd(xDiffSq, yDiffSq);
+    auto sum = cc->EvalAddMutable(xDiffSq, yDiffSq);
+
+    if (supportsDeferredRelin) {
+        stages.begin("relinearize");
+        cout << "Relinearizing total sum..." << endl;
+        sum = cc->Relinearize(sum);
+        if (supportsComposedMult) {
+            stages.begin("rescale");
+            sum = cc->ModReduce(sum); // the modulus reduction ComposedEvalMult would have performed
+        }
+    }
     return sum;
 }
 
 template <class Element, typename T>
-Plaintext DistanceComputer<Element, T>::decrypt(Ciphertext<Element> ciphertext, CryptoContext<Element> cc, LPPrivateKey<Element> secretKey) {
+Plaintext DistanceComputer<Element, T>::decrypt(const Ciphertext<Element>& ciphertext, const CryptoContext<Element>& cc,
+                                                const LPPrivateKey<Element>& secretKey) {
     Plaintext decrypted;
     cc->Decrypt(secretKey, ciphertext, &decrypted);
     decrypted->SetLength(1);
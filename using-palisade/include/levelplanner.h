@@ -0,0 +1,60 @@
+#ifndef LEVELPLANNER_H
+#define LEVELPLANNER_H
+
+#include <palisade.h>
+#include "resultcompactor.h"
+
+using namespace std;
+using namespace lbcrypto;
+
+/** @brief Drops the towers of freshly encrypted inputs that a circuit of a given
+ * multiplicative depth will never use, so that every operation works on fewer RNS limbs.
+ *
+ * Every ModReduce of the circuit takes a tower, and the towers left at the end must still hold a
+ * result of the given magnitude, as ResultCompactor counts it, so the rest can be dropped up front.
+ * Only BGVrns supports LevelReduce: CKKS with EXACTRESCALE manages its own levels and
+ * BGV is not an RNS scheme, so for those the ciphertexts are returned unchanged. A set whose
+ * multiplicative depth is that of the circuit has nothing to drop; only sets provisioned for
+ * deeper circuits than the one they run are reduced (see test/levelplanner_test.cpp).
+ */
+template <class Element>
+class LevelPlanner {
+
+    public:
+        static size_t getLevelsToDrop(const CryptoContext<Element>& /*cc*/, const Ciphertext<Element>& /*ciphertext*/,
+                                      size_t /*depth*/, double /*maxMagnitude*/) {
+            return 0;
+        }
+
+        static Ciphertext<Element> reduceToPlannedLevel(const CryptoContext<Element>& /*cc*/, const Ciphertext<Element>& ciphertext,
+                                                        size_t /*depth*/, double /*maxMagnitude*/, bool /*supportsLevelReduce*/) {
+            return ciphertext;
+        }
+};
+
+template <>
+class LevelPlanner<DCRTPoly> {
+
+    public:
+        /** Returns the number of towers that can be dropped while keeping one tower per ModReduce plus the first
+         *  towers that hold a result of magnitude `maxMagnitude`, and at least one
+         */
+        static size_t getLevelsToDrop(const CryptoContext<DCRTPoly>& cc, const Ciphertext<DCRTPoly>& ciphertext, size_t depth,
+                                      double maxMagnitude) {
+            size_t towers = ciphertext->GetElements()[0].GetNumOfElements();
+            double resultBits = ResultCompactor<DCRTPoly>::getRequiredBits(cc, ciphertext, maxMagnitude);
+            size_t kept = depth + ResultCompactor<DCRTPoly>::getTowersLeft(ciphertext, resultBits);
+            return towers > kept ? towers - kept : 0;
+        }
+
+        static Ciphertext<DCRTPoly> reduceToPlannedLevel(const CryptoContext<DCRTPoly>& cc, const Ciphertext<DCRTPoly>& ciphertext,
+                                                         size_t depth, double maxMagnitude, bool supportsLevelReduce) {
+            size_t levels = supportsLevelReduce ? getLevelsToDrop(cc, ciphertext, depth, maxMagnitude) : 0;
+            if (levels == 0) {
+                return ciphertext;
+            }
+            return cc->LevelReduce(ciphertext, nullptr, levels);
+        }
+};
+
+#endif // LEVELPLANNER_H
@@ -0,0 +1,82 @@
+#ifndef MEMORYACCOUNTANT_H
+#define MEMORYACCOUNTANT_H
+
+#include <sstream>
+#include <vector>
+#include <palisade.h>
+#include "serialization.h"
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Sizes of keys and ciphertexts, both serialized and as held in memory.
+ *
+ *  The in-memory size only counts the coefficients of the polynomials (towers times ring dimension
+ *  times the size of a coefficient), not the parameters they share or the bookkeeping around them.
+ *  The relinearization keys are the ones EvalMultKeyGen stores in the library's global map under the key tag.
+ */
+template <class Element>
+class MemoryAccountant {
+
+    public:
+        template <class T>
+        static size_t getSerializedSize(const T& object) {
+            stringstream stream;
+            Serial::Serialize(object, stream, SerType::BINARY);
+            return stream.str().size();
+        }
+
+        static size_t getMemory(const vector<Element>& elements) {
+            size_t bytes = 0;
+            for (const Element& element : elements) {
+                bytes += getMemory(element);
+            }
+            return bytes;
+        }
+
+        static size_t getMemory(const Ciphertext<Element>& ciphertext) {
+            return getMemory(ciphertext->GetElements());
+        }
+
+        static size_t getMemory(const LPPublicKey<Element>& publicKey) {
+            return getMemory(publicKey->GetPublicElements());
+        }
+
+        static size_t getMemory(const LPPrivateKey<Element>& secretKey) {
+            return getMemory(secretKey->GetPrivateElement());
+        }
+
+        /** Returns the serialized size of the relinearization keys of `keyTag`, or 0 if there are none */
+        static size_t getEvalMultKeySize(const string& keyTag) {
+            if (CryptoContextImpl<Element>::GetAllEvalMultKeys().count(keyTag) == 0) {
+                return 0;
+            }
+            return getSerializedSize(CryptoContextImpl<Element>::GetEvalMultKeyVector(keyTag));
+        }
+
+        static size_t getEvalMultKeyMemory(const string& keyTag) {
+            if (CryptoContextImpl<Element>::GetAllEvalMultKeys().count(keyTag) == 0) {
+                return 0;
+            }
+            size_t bytes = 0;
+            for (const LPEvalKey<Element>& evalKey : CryptoContextImpl<Element>::GetEvalMultKeyVector(keyTag)) {
+                bytes += getMemory(evalKey->GetAVector()) + getMemory(evalKey->GetBVector());
+            }
+            return bytes;
+        }
+
+        static size_t getMemory(const Element& element);
+};
+
+template <>
+inline size_t MemoryAccountant<Poly>::getMemory(const Poly& element) {
+    return element.GetLength() * sizeof(BigInteger);
+}
+
+template <>
+inline size_t MemoryAccountant<DCRTPoly>::getMemory(const DCRTPoly& element) {
+    return element.GetNumOfElements() * element.GetRingDimension() * sizeof(NativeInteger);
+}
+
+#endif // MEMORYACCOUNTANT_H
@@ -0,0 +1,160 @@
+#ifndef PALISADEBACKEND_H
+#define PALISADEBACKEND_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <palisade.h>
+#include "levelplanner.h"
+#include "resultcompactor.h"
+#include "rotator.h"
+
+using namespace std;
+using namespace lbcrypto;
+
+/** @brief Runs circuits with a PALISADE CryptoContext, for use by CircuitExecutor and DistancePipeline.
+ *
+ * Mirrors the flags used by DistanceComputer: products are left unrelinearized only if
+ * the scheme implements Relinearize, and rescaling maps to ModReduce for schemes that
+ * support ComposedEvalMult (for CKKS with EXACTRESCALE the library rescales by itself).
+ * Values are packed into CKKS slots for CKKS and into coefficients otherwise, as in ParamsRunner.
+ */
+template <class Element>
+class PalisadeBackend {
+
+    public:
+        typedef Ciphertext<Element> CiphertextType;
+
+        PalisadeBackend(const CryptoContext<Element>& cc, bool supportsComposedMult, bool supportsDeferredRelin)
+            : cc(cc), supportsComposedMult(supportsComposedMult), supportsDeferredRelin(supportsDeferredRelin),
+              isCKKS(cc->getSchemeId() == "CKKS") {};
+        ~PalisadeBackend() {};
+
+        string getLibrary() const {
+            return "PALISADE";
+        }
+
+        size_t getRingDimension() const {
+            return cc->GetRingDimension();
+        }
+
+        bool isExact() const {
+            return !isCKKS;
+        }
+
+        /** Integer schemes encode coordinates in units of 10^{-3}, as in main.cpp */
+        double getFixedPointScale() const {
+            return isCKKS ? 1 : 1000;
+        }
+
+        void generateKeys() {
+            cc->Enable(ENCRYPTION);
+            cc->Enable(LEVELEDSHE);
+            cc->Enable(SHE);
+
+            keyPair = cc->KeyGen();
+            if (!keyPair.good()) {
+                throw runtime_error("Key generation failed");
+            }
+            cc->EvalMultKeyGen(keyPair.secretKey);
+        }
+
+        /** Generates the keys for rotations by 1 to count - 1 slots, as used by buildSlotSumCircuit(count) */
+        void generateRotationKeys(usint count) {
+            Rotator<Element>::generateRotationKeys(cc, keyPair.secretKey, count);
+        }
+
+        CiphertextType encrypt(double value) const {
+            Plaintext plaintext;
+            if (isCKKS) {
+                plaintext = cc->MakeCKKSPackedPlaintext(vector<complex<double>>{value});
+            } else {
+                plaintext = cc->MakeCoefPackedPlaintext(vector<int64_t>{llround(value)});
+            }
+            return cc->Encrypt(keyPair.publicKey, plaintext);
+        }
+
+        double decrypt(const CiphertextType& ciphertext) const {
+            Plaintext decrypted;
+            cc->Decrypt(keyPair.secretKey, ciphertext, &decrypted);
+            decrypted->SetLength(1);
+            if (isCKKS) {
+                return real(decrypted->GetCKKSPackedValue()[0]);
+            }
+            return decrypted->GetCoefPackedValue()[0];
+        }
+
+        /** Drops the towers that a circuit of the given depth will never use, keeping those that hold a result of the given magnitude */
+        void prepareInputs(vector<CiphertextType>& inputs, size_t depth, double maxMagnitude) const {
+            for (CiphertextType& input : inputs) {
+                input = LevelPlanner<Element>::reduceToPlannedLevel(cc, input, depth, maxMagnitude, supportsComposedMult);
+            }
+        }
+
+        /** Relinearizes the output and compresses it to the fewest towers that hold a result of the given magnitude */
+        void compactOutput(CiphertextType& output, double maxMagnitude) const {
+            output = ResultCompactor<Element>::compact(cc, output, maxMagnitude, true);
+        }
+
+        size_t getSerializedSize(const CiphertextType& ciphertext) const {
+            return ResultCompactor<Element>::getSerializedSize(ciphertext);
+        }
+
+        bool supportsLazyRelinearization() const {
+            return supportsDeferredRelin;
+        }
+
+        bool usesRescaling() const {
+            return supportsComposedMult;
+        }
+
+        CiphertextType sub(const CiphertextType& a, const CiphertextType& b) const {
+            return cc->EvalSub(a, b);
+        }
+
+        CiphertextType add(const CiphertextType& a, const CiphertextType& b) const {
+            return cc->EvalAdd(a, b);
+        }
+
+        CiphertextType mult(const CiphertextType& a, const CiphertextType& b) const {
+            return supportsDeferredRelin ? cc->EvalMultNoRelin(a, b) : cc->EvalMult(a, b);
+        }
+
+        CiphertextType square(const CiphertextType& a) const {
+            return mult(a, a);
+        }
+
+        CiphertextType rotate(const CiphertextType& a, int rotation) const {
+            return cc->EvalAtIndex(a, rotation);
+        }
+
+        /** Rotates to the left with hoisted automorphisms (see Rotator), which decompose `a` once for all of them */
+        vector<CiphertextType> rotateMany(const CiphertextType& a, const vector<int>& rotations) const {
+            bool allLeft = all_of(rotations.begin(), rotations.end(), [](int rotation) { return rotation >= 0; });
+            if (!allLeft) {
+                vector<CiphertextType> rotated;
+                for (int rotation : rotations) {
+                    rotated.push_back(rotate(a, rotation));
+                }
+                return rotated;
+            }
+            return Rotator<Element>(cc, a).rotate(vector<usint>(rotations.begin(), rotations.end()));
+        }
+
+        CiphertextType relinearize(const CiphertextType& a) const {
+            return cc->Relinearize(a);
+        }
+
+        CiphertextType rescale(const CiphertextType& a) const {
+            return cc->ModReduce(a);
+        }
+
+    private:
+        CryptoContext<Element> cc;
+        bool supportsComposedMult;
+        bool supportsDeferredRelin;
+        bool isCKKS;
+        LPKeyPair<Element> keyPair;
+};
+
+#endif // PALISADEBACKEND_H
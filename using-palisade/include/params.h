@@ -2,6 +2,7 @@
 #define PARAMS_H
 #include <palisade.h>
 #include <cryptocontextgen.h>
+#include "costmodel.h"
 
 using namespace lbcrypto;
 using namespace std;
@@ -18,6 +19,22 @@ class Param {
 
 #endif // PARAMS_H
 
+/** Returns the number of key switching digits PALISADE uses for HYBRID key switching when none is given */
+inline size_t getDefaultNumLargeDigits(int multDepth) {
+    return multDepth > 3 ? 3 : (multDepth > 0 ? 2 : 1);
+}
+
+/** Returns the cost shape of an RNS scheme with one 60-bit-or-smaller tower per level */
+inline CostShape getRNSCostShape(int64_t n, int multDepth, double logQ, KeySwitchTechnique ksTech) {
+    size_t limbs = multDepth + 1;
+    size_t ringDimension = n > 0 ? n : CostModel::getMinRingDimension(logQ);
+    if (ksTech == BV) {
+        return CostShape{ringDimension, logQ, limbs, 0, limbs}; // one digit per tower
+    }
+    size_t digits = min(getDefaultNumLargeDigits(multDepth), limbs);
+    return CostShape{ringDimension, logQ, limbs, (limbs + digits - 1) / digits, digits};
+}
+
 /** Represents parameters for BGVrns scheme */
 class BGVrnsParam: Param<DCRTPoly> {
 
@@ -35,6 +52,19 @@ class BGVrnsParam: Param<DCRTPoly> {
             return cc;
         }
 
+        int getMultDepth() const {
+            return multDepth;
+        }
+
+        int64_t getRingDimension() const {
+            return n;
+        }
+
+        /** Estimates the sizes that the cost model needs; the library picks towers of up to 60 bits */
+        CostShape getCostShape() const {
+            return getRNSCostShape(n, multDepth, 60.0 * (multDepth + 1), ksTech);
+        }
+
     private:
         PlaintextModulus p; // plaintext modulus
         int64_t n; // dimension
@@ -62,6 +92,16 @@ class BGVParam: Param<Poly> {
             return cc;
         }
 
+        /** Estimates the sizes that the cost model needs: the modulus is a single multiprecision integer, whose
+         *  products cost the square of its words, and relinearization uses one digit per `relinWindow` bits
+         */
+        CostShape getCostShape() const {
+            size_t words = (numOfBits + 63) / 64;
+            int64_t window = max<int64_t>(relinWindow, 1);
+            size_t digits = (numOfBits + window - 1) / window;
+            return CostShape{static_cast<size_t>(m / 2), static_cast<double>(numOfBits), words * words, 0, digits, CostFamily::Poly};
+        }
+
     private:
         PlaintextModulus p; // plaintext modulus
         int64_t m; // order; n = m / 2;
@@ -83,11 +123,39 @@ class CKKSParam: Param<DCRTPoly> {
         static map<int, CKKSParam> ParamSets;
 
         CKKSParam(int64_t multDepth, int64_t scaleFactorBits, int64_t n, SecurityLevel securityLevel = HEStd_128_classic, int batchSize = 8,
-                  RescalingTechnique rsTech = EXACTRESCALE)
-            :  multDepth(multDepth), scaleFactorBits(scaleFactorBits), n(n), securityLevel(securityLevel), batchSize(batchSize), rsTech(rsTech) {}
+                  RescalingTechnique rsTech = EXACTRESCALE, KeySwitchTechnique ksTech = HYBRID)
+            :  multDepth(multDepth), scaleFactorBits(scaleFactorBits), n(n), securityLevel(securityLevel), batchSize(batchSize), rsTech(rsTech),
+               ksTech(ksTech) {}
 
         CryptoContext<DCRTPoly> generateCryptoContext() const {
-            return CryptoContextFactory<DCRTPoly>::genCryptoContextCKKS(multDepth, scaleFactorBits, batchSize, securityLevel, n, rsTech);
+            return CryptoContextFactory<DCRTPoly>::genCryptoContextCKKS(multDepth, scaleFactorBits, batchSize, securityLevel, n, rsTech, ksTech);
+        }
+
+        int64_t getMultDepth() const {
+            return multDepth;
+        }
+
+        int64_t getScaleFactorBits() const {
+            return scaleFactorBits;
+        }
+
+        int64_t getRingDimension() const {
+            return n;
+        }
+
+        /** Returns the same set with `batchSize` slots per ciphertext, at most half the ring dimension */
+        CKKSParam withBatchSize(int64_t batchSize) const {
+            return CKKSParam(multDepth, scaleFactorBits, n, securityLevel, batchSize, rsTech, ksTech);
+        }
+
+        /** Returns the same set rescaling with `rsTech` */
+        CKKSParam withRescalingTechnique(RescalingTechnique rsTech) const {
+            return CKKSParam(multDepth, scaleFactorBits, n, securityLevel, batchSize, rsTech, ksTech);
+        }
+
+        /** Estimates the sizes that the cost model needs; the first modulus has 60 bits and the others `scaleFactorBits` */
+        CostShape getCostShape() const {
+            return getRNSCostShape(n, multDepth, 60.0 + multDepth * scaleFactorBits, ksTech);
         }
 
     private:
@@ -98,6 +166,7 @@ class CKKSParam: Param<DCRTPoly> {
         SecurityLevel securityLevel;
         int64_t batchSize;
         RescalingTechnique rsTech;
+        KeySwitchTechnique ksTech;
 
 };
 
@@ -2,9 +2,23 @@
 #define PARAMSRUNNER_H
 
 #include <palisade.h>
+#include "depthmeasurer.h"
 #include "distancecomputer.h"
+#include "levelplanner.h"
+#include "memoryaccountant.h"
+#include "memorystats.h"
+#include "ophistogram.h"
+#include "perfcounters.h"
+#include "polynomialevaluator.h"
+#include "precisionstats.h"
+#include "resultcompactor.h"
+#include "resultswriter.h"
+#include "timingguard.h"
+#include "tracer.h"
 #include "vector.h"
+#include <chrono>
 #include <cmath>
+#include <sstream>
 
 using namespace std;
 using namespace lbcrypto;
@@ -18,24 +32,76 @@ class ParamsRunner {
         ParamsRunner() {};
         ~ParamsRunner() {};
 
-        void runDistComp(T x1, T y1, T x2, T y2, CryptoContext<Element> cryptoContext, bool supportsComposedMult);
+        /** Evaluates the distance through the optimized circuit instead of the step-by-step computation */
+        void setUseCircuit(bool useCircuit) {
+            this->useCircuit = useCircuit;
+        }
+
+        /** Evaluates the distance with the fused squared-difference-sum kernel instead of the step-by-step computation */
+        void setUseFusedKernel(bool useFusedKernel) {
+            this->useFusedKernel = useFusedKernel;
+        }
+
+        /** Compresses the distance ciphertext to the fewest towers that hold it before it is checked */
+        void setCompressResult(bool compressResult) {
+            this->compressResult = compressResult;
+        }
+
+        /** Records the library's own timing of every operation of runDistComp (StartTiming) into `opProfile`; nullptr disables it */
+        void setOpProfile(OpProfile* opProfile) {
+            this->opProfile = opProfile;
+        }
+
+        /** Counts hardware events over every phase of runDistComp with `perfCounters`; nullptr disables it */
+        void setPerfCounters(PerfCounters* perfCounters) {
+            this->perfCounters = perfCounters;
+        }
+
+        /** Records a span for runDistComp, each of its phases and the stages of the distance computation; nullptr disables it */
+        void setTracer(Tracer* tracer) {
+            this->tracer = tracer;
+        }
+
+        void runDistComp(T x1, T y1, T x2, T y2, CryptoContext<Element> cryptoContext, bool supportsComposedMult,
+                         bool supportsDeferredRelin);
+
+        /** Returns the parameters, phase timings, sizes and correctness of the last runDistComp; the caller fills in
+         *  the scheme and parameter set
+         */
+        const RunRecord& getLastRun() const {
+            return lastRun;
+        }
+
         void runMultCheck(T x, CryptoContext<Element> cryptoContext);
+        void runDepthMeasurement(T x, CryptoContext<Element> cryptoContext, size_t maxDepth);
 
     protected:
-        virtual Plaintext encodePlaintext(vector<T> coord, CryptoContext<Element> cc, string plaintextName);
+        virtual Plaintext encodePlaintext(const vector<T>& coord, const CryptoContext<Element>& cc, const string& plaintextName);
         void printParameters(CryptoContext<Element> cryptoContext);
+        void printMemory(const RunRecord& run);
         virtual void printCoordinates(T x, T y, string xName, string yName);
         LPKeyPair<Element> generateKeys(CryptoContext<Element> cryptoContext);
-        bool decryptAndCheck(Ciphertext<Element> ct, Plaintext pt, LPPrivateKey<Element> secretKey, CryptoContext<Element> cryptoContext, string plaintextName);
-        virtual bool checkDecryption(Plaintext original, Plaintext decrypted);
+        bool decryptAndCheck(const Ciphertext<Element>& ct, const Plaintext& pt, const LPPrivateKey<Element>& secretKey,
+                             const CryptoContext<Element>& cryptoContext, const string& plaintextName);
+        virtual bool checkDecryption(const Plaintext& original, const Plaintext& decrypted);
+
+    private:
+        bool useCircuit = false;
+        bool useFusedKernel = false;
+        bool compressResult = true;
+        OpProfile* opProfile = nullptr;
+        PerfCounters* perfCounters = nullptr;
+        Tracer* tracer = nullptr;
+        RunRecord lastRun;
+        DistanceComputer<Element, T> distanceComputer; // kept across runs, so that it compiles the distance circuit once
 };
 
 #endif // PARAMSRUNNER_H
 
 template<class Element, typename T>
-Plaintext ParamsRunner<Element, T>::encodePlaintext(vector<T> coord, CryptoContext<Element> cc, string plaintextName) {
-    vector<int64_t>* typeCastedCoord;
-    typeCastedCoord = (vector<int64_t>*) &coord;
+Plaintext ParamsRunner<Element, T>::encodePlaintext(const vector<T>& coord, const CryptoContext<Element>& cc, const string& plaintextName) {
+    const vector<int64_t>* typeCastedCoord;
+    typeCastedCoord = (const vector<int64_t>*) &coord;
     Plaintext plaintext = cc->MakeCoefPackedPlaintext(*typeCastedCoord);
     cout << plaintextName << " Plaintext: " << plaintext << endl;
     return plaintext;
@@ -67,6 +133,20 @@ void ParamsRunner<Element, T>::printParameters(CryptoContext<Element> cryptoCont
         << endl;
 }
 
+/** Prints the serialized and in-memory sizes of the keys and of a fresh ciphertext, and the peak RSS of every phase */
+template<class Element, typename T>
+void ParamsRunner<Element, T>::printMemory(const RunRecord& run) {
+    cout << "Public key: " << run.publicKeySize << " bytes serialized, " << run.publicKeyMemory << " bytes in memory" << endl;
+    cout << "Secret key: " << run.secretKeySize << " bytes serialized, " << run.secretKeyMemory << " bytes in memory" << endl;
+    cout << "Relinearization keys: " << run.evalKeySize << " bytes serialized, " << run.evalKeyMemory << " bytes in memory" << endl;
+    cout << "Fresh ciphertext: " << run.ciphertextSize << " bytes serialized, " << run.ciphertextMemory << " bytes in memory" << endl;
+    cout << "Peak RSS per phase (MB):";
+    for (const auto& phase : run.peakRSS) {
+        cout << " " << phase.first << " " << phase.second / (1024.0 * 1024.0) << ";";
+    }
+    cout << endl;
+}
+
 template <class Element, typename T>
 LPKeyPair<Element> ParamsRunner<Element, T>::generateKeys(CryptoContext<Element> cryptoContext) {
 
@@ -82,8 +162,10 @@ LPKeyPair<Element> ParamsRunner<Element, T>::generateKeys(CryptoContext<Element>
 }
 
 template<class Element, typename T>
-void ParamsRunner<Element, T>::runDistComp(T x1, T y1, T x2, T y2, CryptoContext<Element> cryptoContext, bool supportsComposedMult) {
+void ParamsRunner<Element, T>::runDistComp(T x1, T y1, T x2, T y2, CryptoContext<Element> cryptoContext, bool supportsComposedMult,
+                                           bool supportsDeferredRelin) {
 
+    Tracer::Span span(tracer, "runDistComp", "runner");
     printParameters(cryptoContext);
 
     printCoordinates(x1, y1, "x1", "y1");
@@ -99,15 +181,48 @@ void ParamsRunner<Element, T>::runDistComp(T x1, T y1, T x2, T y2, CryptoContext
     cryptoContext->Enable(LEVELEDSHE);
     cryptoContext->Enable(SHE);
 
+    // Every phase is timed up to the next one, including its progress output, and its peak RSS is
+    // taken from a high-water mark reset at its start (see MemoryStats), as are its hardware counters
+    lastRun = RunRecord();
+    lastRun.library = "PALISADE";
+    MemoryStats::resetPeakRSS();
+    if (perfCounters != nullptr) {
+        perfCounters->start();
+    }
+    auto phaseStart = chrono::steady_clock::now();
+    auto endPhase = [this, &phaseStart](const string& phase) {
+        auto now = chrono::steady_clock::now();
+        lastRun.phases.push_back({phase, chrono::duration<double, milli>(now - phaseStart).count()});
+        if (tracer != nullptr) {
+            tracer->addSpan(phase, "phase", phaseStart, now);
+        }
+        if (perfCounters != nullptr) {
+            lastRun.counters.push_back({phase, perfCounters->stop()});
+        }
+        lastRun.peakRSS.push_back({phase, MemoryStats::getPeakRSS()});
+        MemoryStats::resetPeakRSS();
+        if (perfCounters != nullptr) {
+            perfCounters->start();
+        }
+        phaseStart = chrono::steady_clock::now();
+    };
+
+    // The context appends a sample per timed operation; key switching within EvalMult is only
+    // sampled separately (OpEvalRelin) when relinearization is deferred
+    vector<TimingInfo> timings;
+    TimingGuard<Element> timingGuard(cryptoContext, opProfile != nullptr ? &timings : nullptr);
+
     // Encode coordinates into plaintexts
     cout << "Encoding coordinates into plaintexts..." << endl;
     Plaintext x1Plaintext = encodePlaintext(x1Coord, cryptoContext, "x1");
     Plaintext y1Plaintext = encodePlaintext(y1Coord, cryptoContext, "y1");
     Plaintext x2Plaintext = encodePlaintext(x2Coord, cryptoContext, "x2");
     Plaintext y2Plaintext = encodePlaintext(y2Coord, cryptoContext, "y2");
+    endPhase("encode");
 
     cout << "Running key generation..." << endl;
     LPKeyPair<Element> keyPair = generateKeys(cryptoContext);
+    endPhase("key generation");
 
     cout << "Encrypting plaintexts..." << endl;
     LPPublicKey<Element> publicKey = keyPair.publicKey;
@@ -115,6 +230,8 @@ void ParamsRunner<Element, T>::runDistComp(T x1, T y1, T x2, T y2, CryptoContext
     Ciphertext<Element> y1Ciphertext = cryptoContext->Encrypt(publicKey, y1Plaintext);
     Ciphertext<Element> x2Ciphertext = cryptoContext->Encrypt(publicKey, x2Plaintext);
     Ciphertext<Element> y2Ciphertext = cryptoContext->Encrypt(publicKey, y2Plaintext);
+    endPhase("encrypt");
+    Ciphertext<Element> freshCiphertext = x1Ciphertext; // measured once the run is over
 
     cout << "Decrypting ciphertexts..." << endl;
     LPPrivateKey<Element> secretKey = keyPair.secretKey;
@@ -122,18 +239,98 @@ void ParamsRunner<Element, T>::runDistComp(T x1, T y1, T x2, T y2, CryptoContext
     decryptAndCheck(y1Ciphertext, y1Plaintext, secretKey, cryptoContext, "y1");
     decryptAndCheck(x2Ciphertext, x2Plaintext, secretKey, cryptoContext, "x2");
     decryptAndCheck(y2Ciphertext, y2Plaintext, secretKey, cryptoContext, "y2");
+    endPhase("input check");
+
+    // Drop the towers that the distance circuit will never use before any arithmetic;
+    // only BGVrns (the scheme supporting ComposedEvalMult) implements LevelReduce
+    size_t depth = DistanceSquaredExpression::depth();
+    double maxCoord = max(max(abs(x1), abs(y1)), max(abs(x2), abs(y2)));
+    double maxMagnitude = 8 * maxCoord * maxCoord; // (x1 - x2)^2 + (y1 - y2)^2 is at most 2 * (2 * max |coord|)^2
+    if (supportsComposedMult) {
+        cout << "Dropping " << LevelPlanner<Element>::getLevelsToDrop(cryptoContext, x1Ciphertext, depth, maxMagnitude)
+            << " unused tower(s) of the inputs..." << endl;
+    }
+    x1Ciphertext = LevelPlanner<Element>::reduceToPlannedLevel(cryptoContext, x1Ciphertext, depth, maxMagnitude, supportsComposedMult);
+    y1Ciphertext = LevelPlanner<Element>::reduceToPlannedLevel(cryptoContext, y1Ciphertext, depth, maxMagnitude, supportsComposedMult);
+    x2Ciphertext = LevelPlanner<Element>::reduceToPlannedLevel(cryptoContext, x2Ciphertext, depth, maxMagnitude, supportsComposedMult);
+    y2Ciphertext = LevelPlanner<Element>::reduceToPlannedLevel(cryptoContext, y2Ciphertext, depth, maxMagnitude, supportsComposedMult);
 
-    DistanceComputer<Element, T> distanceComputer;
+    distanceComputer.setTracer(tracer);
 
     // Compute square of distance
     vector<T> distSq = distanceComputer.computeDistanceSquared(x1, y1, x2, y2);
     Plaintext distSqPlaintext = encodePlaintext(distSq, cryptoContext, "Distance Squared");
+    endPhase("level reduction");
 
     // Homomorphically compute square of distance
-    cout << "EvalMultKeyGen(secretKey)..." << endl;
-    cryptoContext->EvalMultKeyGen(secretKey);
-    Ciphertext<Element> distanceCiphertext = distanceComputer.computeDistanceSquared(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext, cryptoContext, secretKey, supportsComposedMult);
-    decryptAndCheck(distanceCiphertext, distSqPlaintext, secretKey, cryptoContext, "Distance Squared");
+    // The key set follows from the distance expression: the relinearization key, generated once per context and
+    // shared by every multiplication, only if it multiplies, and rotation keys only for the rotations it uses
+    if (DistanceSquaredExpression::depth() > 0) {
+        cout << "EvalMultKeyGen(secretKey)..." << endl;
+        cryptoContext->EvalMultKeyGen(secretKey);
+    }
+    vector<int32_t> rotations = DistanceSquaredExpression::Rotations::toVector();
+    if (!rotations.empty()) {
+        cryptoContext->EvalAtIndexKeyGen(secretKey, rotations);
+    }
+    endPhase("eval key generation");
+    Ciphertext<Element> distanceCiphertext;
+    if (useCircuit) {
+        distanceCiphertext = distanceComputer.computeDistanceSquaredCircuit(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext,
+                                                                            cryptoContext, supportsComposedMult, supportsDeferredRelin);
+    } else if (useFusedKernel) {
+        distanceCiphertext = distanceComputer.computeDistanceSquaredFused(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext,
+                                                                          cryptoContext, supportsComposedMult);
+    } else {
+        distanceCiphertext = distanceComputer.computeDistanceSquared(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext,
+                                                                     cryptoContext, secretKey,
+                                                                     supportsComposedMult, supportsDeferredRelin);
+    }
+
+    endPhase("evaluate");
+
+    // Shrink the result before it would be sent back; (x1 - x2)^2 + (y1 - y2)^2 is at most 2 * (2 * max |coord|)^2
+    size_t fullSize = ResultCompactor<Element>::getSerializedSize(distanceCiphertext);
+    distanceCiphertext = ResultCompactor<Element>::compact(cryptoContext, distanceCiphertext, maxMagnitude, compressResult);
+    endPhase("compaction");
+    lastRun.resultSize = fullSize;
+    lastRun.compactedResultSize = ResultCompactor<Element>::getSerializedSize(distanceCiphertext);
+    cout << "Result ciphertext size: " << fullSize << " bytes, " << lastRun.compactedResultSize << " bytes after compaction" << endl;
+
+    lastRun.correct = decryptAndCheck(distanceCiphertext, distSqPlaintext, secretKey, cryptoContext, "Distance Squared");
+    endPhase("decrypt");
+
+    // CKKS keeps the bits of its scaling factor where the other schemes keep the plaintext modulus
+    PlaintextModulus p = cryptoContext->GetCryptoParameters()->GetPlaintextModulus();
+    bool approximate = is_same<T, complex<double>>::value;
+    lastRun.ringDimension = cryptoContext->GetRingDimension();
+    lastRun.logQ = log2(cryptoContext->GetCryptoParameters()->GetElementParams()->GetModulus().ConvertToDouble());
+    lastRun.plaintextModulus = approximate ? 0 : p;
+    lastRun.scale = approximate ? pow(2.0, p) : 0;
+
+    // Sizes are measured after the last phase, so that serializing the keys does not count towards any of them
+    lastRun.ciphertextSize = MemoryAccountant<Element>::getSerializedSize(freshCiphertext);
+    lastRun.ciphertextMemory = MemoryAccountant<Element>::getMemory(freshCiphertext);
+    lastRun.publicKeySize = MemoryAccountant<Element>::getSerializedSize(publicKey);
+    lastRun.publicKeyMemory = MemoryAccountant<Element>::getMemory(publicKey);
+    lastRun.secretKeySize = MemoryAccountant<Element>::getSerializedSize(secretKey);
+    lastRun.secretKeyMemory = MemoryAccountant<Element>::getMemory(secretKey);
+    lastRun.evalKeySize = MemoryAccountant<Element>::getEvalMultKeySize(secretKey->GetKeyTag());
+    lastRun.evalKeyMemory = MemoryAccountant<Element>::getEvalMultKeyMemory(secretKey->GetKeyTag());
+    printMemory(lastRun);
+    if (perfCounters != nullptr) {
+        perfCounters->stop();
+        PerfCounters::printReport(lastRun.counters);
+    }
+
+    timingGuard.stop();
+    if (opProfile != nullptr) {
+        for (const TimingInfo& timing : timings) {
+            ostringstream operation;
+            operation << timing.operation;
+            opProfile->add(operation.str(), timing.timeval);
+        }
+    }
 }
 
 template<class Element, typename T>
@@ -164,22 +361,62 @@ void ParamsRunner<Element, T>::runMultCheck(T seed, CryptoContext<Element> crypt
     LPPrivateKey<Element> secretKey = keyPair.secretKey;
     decryptAndCheck(xCiphertext, xPlaintext, secretKey, cryptoContext, "x");
 
-    Ciphertext<Element> resultCiphertext = xCiphertext;
     vector<T> actualResult = x;
     int counter = 0;
 
     cryptoContext->EvalMultKeyGen(secretKey);
 
+    // Each level of depth doubles the degree: x^{2^d} is computed with d levels instead of 2^d - 1,
+    // up to the depth the context can support at all so that the degree cannot overflow
+    PolynomialEvaluator<Element> polynomialEvaluator(cryptoContext, xCiphertext);
+    usint maxDepth = PolynomialEvaluator<Element>::getMaxDepth(cryptoContext);
+    usint degree = 1;
     bool correct = true;
-    while (correct) {
-        resultCiphertext = cryptoContext->EvalMult(resultCiphertext, xCiphertext);
-        actualResult = actualResult * x;
+    while (correct && static_cast<usint>(counter) < maxDepth) {
+        degree *= 2;
+        cout << "Computing x^" << degree << "..." << endl;
+        Ciphertext<Element> resultCiphertext = polynomialEvaluator.evalPower(degree);
+        actualResult = actualResult * actualResult;
         Plaintext actualResultPlaintext = encodePlaintext(actualResult, cryptoContext, "Actual Result");
         correct = decryptAndCheck(resultCiphertext, actualResultPlaintext, secretKey, cryptoContext, "Result");
-        counter = counter + 1;
+        if (correct) {
+            counter = counter + 1;
+        }
     }
 
-    cout << "CORRECT FOR " << counter << " MULTIPLICATION(S)" << endl;
+    cout << "CORRECT FOR " << (correct ? "AT LEAST " : "") << counter << " LEVEL(S) OF MULTIPLICATIVE DEPTH (UP TO x^"
+        << (correct ? degree : degree / 2) << ")" << endl;
+}
+
+/** Measures the multiplicative depth with a logarithmic number of decryptions (see DepthMeasurer); for BGV and BGVrns only */
+template<class Element, typename T>
+void ParamsRunner<Element, T>::runDepthMeasurement(T seed, CryptoContext<Element> cryptoContext, size_t maxDepth) {
+
+    printParameters(cryptoContext);
+
+    cout << "x = " << seed << endl;
+    vector<T> x{seed};
+
+    // Enable encryption and SHE
+    cryptoContext->Enable(ENCRYPTION);
+    cryptoContext->Enable(SHE);
+    cryptoContext->Enable(LEVELEDSHE);
+
+    Plaintext xPlaintext = encodePlaintext(x, cryptoContext, "x");
+
+    cout << "Running key generation..." << endl;
+    LPKeyPair<Element> keyPair = generateKeys(cryptoContext);
+    cryptoContext->EvalMultKeyGen(keyPair.secretKey);
+
+    cout << "Encrypting plaintext..." << endl;
+    Ciphertext<Element> xCiphertext = cryptoContext->Encrypt(keyPair.publicKey, xPlaintext);
+    cout << "Fresh noise budget: " << DepthMeasurer<Element>::getNoiseBudget(xCiphertext, keyPair.secretKey) << " bits" << endl;
+
+    DepthMeasurer<Element> depthMeasurer(cryptoContext, keyPair.secretKey, maxDepth);
+    size_t depth = depthMeasurer.measure(xCiphertext, static_cast<int64_t>(seed));
+
+    cout << "CORRECT FOR " << (depth == maxDepth ? "AT LEAST " : "") << depth << " LEVEL(S) OF MULTIPLICATIVE DEPTH ("
+        << depthMeasurer.getDecryptions() << " decryptions)" << endl;
 }
 
 template<class Element, typename T>
@@ -189,7 +426,7 @@ void ParamsRunner<Element, T>::printCoordinates(T x, T y, string xName, string y
 }
 
 template<class Element, typename T>
-bool ParamsRunner<Element, T>::checkDecryption(Plaintext original, Plaintext decrypted) {
+bool ParamsRunner<Element, T>::checkDecryption(const Plaintext& original, const Plaintext& decrypted) {
     if (*original != *decrypted) {
         cout << "Failed" << endl;
         return false;
@@ -200,7 +437,8 @@ bool ParamsRunner<Element, T>::checkDecryption(Plaintext original, Plaintext dec
 }
 
 template<class Element, typename T>
-bool ParamsRunner<Element, T>::decryptAndCheck(Ciphertext<Element> ct, Plaintext pt, LPPrivateKey<Element> sk, CryptoContext<Element> cc, string plaintextName) {
+bool ParamsRunner<Element, T>::decryptAndCheck(const Ciphertext<Element>& ct, const Plaintext& pt, const LPPrivateKey<Element>& sk,
+                                               const CryptoContext<Element>& cc, const string& plaintextName) {
 
     Plaintext decrypt;
     cc->Decrypt(sk, ct, &decrypt);
@@ -214,7 +452,7 @@ bool ParamsRunner<Element, T>::decryptAndCheck(Ciphertext<Element> ct, Plaintext
 template<class Element>
 class CKKSParamsRunner: public ParamsRunner<Element, complex<double>> {
 
-    virtual Plaintext encodePlaintext(vector<complex<double>> coord, CryptoContext<Element> cc, string plaintextName) {
+    virtual Plaintext encodePlaintext(const vector<complex<double>>& coord, const CryptoContext<Element>& cc, const string& plaintextName) {
         Plaintext plaintext;
         plaintext = cc->MakeCKKSPackedPlaintext(coord);
         cout << plaintextName << " Plaintext: " << plaintext << endl;
@@ -227,10 +465,75 @@ class CKKSParamsRunner: public ParamsRunner<Element, complex<double>> {
         printf("%f + %fi) \n", real(y), imag(y));
     }
 
-    virtual bool checkDecryption(Plaintext original, Plaintext decrypted) {
-        cout << "Please check correctness manually for CKKS" << endl;
-        return false;
+    /** Compares the first slot, with the tolerance of the SEAL driver */
+    virtual bool checkDecryption(const Plaintext& original, const Plaintext& decrypted) {
+        if (abs(original->GetCKKSPackedValue()[0] - decrypted->GetCKKSPackedValue()[0]) >= 0.000001) {
+            cout << "Failed" << endl;
+            return false;
+        } else {
+            cout << "Successful" << endl;
+            return true;
+        }
     }
 
+    public:
+        /** @brief Measures the precision of every slot after each level of squaring, from the fresh ciphertext
+         *  up to `maxDepth` levels or the levels of the modulus chain, whichever is fewer, stopping once it falls
+         *  under `minPrecisionBits`.
+         *
+         *  Every slot holds a point of the unit circle (see PrecisionStats), so the errors of all levels are comparable.
+         */
+        void runPrecisionCheck(CryptoContext<Element> cryptoContext, double minPrecisionBits, size_t maxDepth) {
+            this->printParameters(cryptoContext);
+
+            cryptoContext->Enable(ENCRYPTION);
+            cryptoContext->Enable(SHE);
+            cryptoContext->Enable(LEVELEDSHE);
+
+            size_t slots = cryptoContext->GetEncodingParams()->GetBatchSize();
+            if (slots == 0) {
+                slots = cryptoContext->GetRingDimension() / 2;
+            }
+            vector<complex<double>> expected = PrecisionStats::makeUnitCircleSlots(slots);
+
+            cout << "Running key generation..." << endl;
+            LPKeyPair<Element> keyPair = this->generateKeys(cryptoContext);
+            cryptoContext->EvalMultKeyGen(keyPair.secretKey);
+            Ciphertext<Element> ciphertext = cryptoContext->Encrypt(keyPair.publicKey, cryptoContext->MakeCKKSPackedPlaintext(expected));
+
+            // With APPROXRESCALE the library leaves rescaling to the caller
+            auto ckksParameters = dynamic_pointer_cast<LPCryptoParametersCKKS<Element>>(cryptoContext->GetCryptoParameters());
+            bool rescaleManually = ckksParameters != nullptr && ckksParameters->GetRescalingTechnique() == APPROXRESCALE;
+
+            maxDepth = min<size_t>(maxDepth, PolynomialEvaluator<Element>::getMaxDepth(cryptoContext));
+            for (size_t depth = 0; depth <= maxDepth; depth++) {
+                Plaintext decrypted;
+                try {
+                    if (depth > 0) {
+                        ciphertext = cryptoContext->EvalMult(ciphertext, ciphertext);
+                        if (rescaleManually) {
+                            ciphertext = cryptoContext->ModReduce(ciphertext);
+                        }
+                        for (complex<double>& value : expected) {
+                            value *= value;
+                        }
+                    }
+                    cryptoContext->Decrypt(keyPair.secretKey, ciphertext, &decrypted);
+                } catch (const exception& e) {
+                    cout << "Level " << depth << ": could not be computed (" << e.what() << ")" << endl;
+                    break;
+                }
+                decrypted->SetLength(slots);
+
+                PrecisionStats stats = PrecisionStats::compare(expected, decrypted->GetCKKSPackedValue());
+                cout << "Level " << depth << ": precision " << stats.getPrecisionBits() << " bits (max error " << stats.maxError
+                    << "), mean " << stats.getMeanPrecisionBits() << " bits (mean error " << stats.meanError << ")" << endl;
+                if (stats.getPrecisionBits() < minPrecisionBits) {
+                    cout << "Precision fell under " << minPrecisionBits << " bits" << endl;
+                    break;
+                }
+            }
+        }
+
 };
 
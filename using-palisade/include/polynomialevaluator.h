@@ -0,0 +1,148 @@
+#ifndef POLYNOMIALEVALUATOR_H
+#define POLYNOMIALEVALUATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <map>
+#include <vector>
+#include <palisade.h>
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Evaluates powers and polynomials of a single ciphertext x with the least multiplicative depth.
+ *
+ *  x^k is computed as x^{2^m} * x^{k - 2^m}, where 2^m is the largest power of two below k, so every
+ *  power uses ceil(log2 k) levels instead of the k - 1 of a linear chain of products. Powers are cached,
+ *  so the squarings behind x^{2^d} are shared by every larger power. Polynomials are evaluated with the
+ *  Paterson-Stockmeyer method, which needs about log2(degree) + 1 levels.
+ */
+template <class Element>
+class PolynomialEvaluator {
+
+    public:
+        PolynomialEvaluator(const CryptoContext<Element>& cc, const Ciphertext<Element>& x)
+            : cc(cc) {
+            powers[1] = x;
+        };
+        ~PolynomialEvaluator() {};
+
+        /** Returns the multiplicative depth of x^k */
+        static usint getPowerDepth(usint k) {
+            return k <= 1 ? 0 : static_cast<usint>(ceil(log2(k)));
+        }
+
+        /** Returns a bound on the multiplicative depth of the context, at most the largest d for which 2^d fits a usint:
+         *  every product takes at least a bit off the single modulus of BGV
+         */
+        static usint getMaxDepth(const CryptoContext<Element>& cc) {
+            usint modulusBits = cc->GetElementParams()->GetModulus().GetMSB();
+            return min<usint>(modulusBits, numeric_limits<usint>::digits - 1);
+        }
+
+        /** Multiplies the ciphertexts as a balanced binary tree (EvalMultMany), using ceil(log2 n) levels */
+        static Ciphertext<Element> evalProduct(const CryptoContext<Element>& cc, const vector<Ciphertext<Element>>& factors) {
+            if (factors.size() == 1) {
+                return factors[0];
+            }
+            return cc->EvalMultMany(factors);
+        }
+
+        Ciphertext<Element> evalPower(usint k) {
+            auto iter = powers.find(k);
+            if (iter != powers.end()) {
+                return iter->second;
+            }
+            usint high = 1;
+            while (2 * high < k) {
+                high *= 2;
+            }
+            Ciphertext<Element> power = cc->EvalMult(evalPower(high), evalPower(k - high));
+            powers[k] = power;
+            return power;
+        }
+
+        /** Returns x, x^2, ..., x^maxDegree */
+        vector<Ciphertext<Element>> evalPowers(usint maxDegree) {
+            vector<Ciphertext<Element>> result;
+            result.reserve(maxDegree);
+            for (usint k = 1; k <= maxDegree; k++) {
+                result.push_back(evalPower(k));
+            }
+            return result;
+        }
+
+        /** Evaluates coefficients[0] + coefficients[1] x + ... with the Paterson-Stockmeyer method:
+         *  the polynomial is split at the giant-step powers x^{b 2^i} into parts of degree below b,
+         *  where b is about sqrt(degree), and each part is a plaintext combination of x, ..., x^{b-1}
+         */
+        template <typename T>
+        Ciphertext<Element> evalPolynomial(const vector<T>& coefficients) {
+            usint babySteps = max<usint>(2, static_cast<usint>(ceil(sqrt(coefficients.size()))));
+            evalPowers(babySteps);
+            return evalPolynomial(coefficients, 0, coefficients.size(), babySteps);
+        }
+
+    private:
+        CryptoContext<Element> cc;
+        map<usint, Ciphertext<Element>> powers;
+
+        template <typename T>
+        Ciphertext<Element> evalPolynomial(const vector<T>& coefficients, size_t begin, size_t end, usint babySteps) {
+            if (end - begin <= babySteps) {
+                return evalLinearCombination(coefficients, begin, end);
+            }
+            usint giantStep = babySteps;
+            while (2 * giantStep < end - begin) {
+                giantStep *= 2;
+            }
+            Ciphertext<Element> low = evalPolynomial(coefficients, begin, begin + giantStep, babySteps);
+            Ciphertext<Element> high = evalPolynomial(coefficients, begin + giantStep, end, babySteps);
+            return cc->EvalAdd(low, cc->EvalMult(high, evalPower(giantStep)));
+        }
+
+        /** Returns the sum of coefficients[i] x^{i - begin} for i in [begin, end) */
+        template <typename T>
+        Ciphertext<Element> evalLinearCombination(const vector<T>& coefficients, size_t begin, size_t end) {
+            Ciphertext<Element> sum;
+            for (size_t i = begin + 1; i < end; i++) {
+                if (coefficients[i] == T(0)) {
+                    continue;
+                }
+                Ciphertext<Element> term = multiplyByConstant(evalPower(i - begin), coefficients[i]);
+                sum = sum ? cc->EvalAdd(sum, term) : term;
+            }
+            if (!sum) {
+                sum = cc->EvalSub(powers[1], powers[1]); // encryption of zero
+            }
+            return coefficients[begin] == T(0) ? sum : addConstant(sum, coefficients[begin]);
+        }
+
+        Ciphertext<Element> multiplyByConstant(const Ciphertext<Element>& ciphertext, int64_t constant) const {
+            return cc->EvalMult(ciphertext, cc->MakeCoefPackedPlaintext(vector<int64_t>{constant}));
+        }
+
+        Ciphertext<Element> multiplyByConstant(const Ciphertext<Element>& ciphertext, complex<double> constant) const {
+            return cc->EvalMult(ciphertext, real(constant));
+        }
+
+        Ciphertext<Element> addConstant(const Ciphertext<Element>& ciphertext, int64_t constant) const {
+            return cc->EvalAdd(ciphertext, cc->MakeCoefPackedPlaintext(vector<int64_t>{constant}));
+        }
+
+        Ciphertext<Element> addConstant(const Ciphertext<Element>& ciphertext, complex<double> constant) const {
+            return cc->EvalAdd(ciphertext, real(constant));
+        }
+};
+
+/** The RNS schemes (BGVrns and CKKS) consume a tower per level, and keep the first one for the result */
+template <>
+inline usint PolynomialEvaluator<DCRTPoly>::getMaxDepth(const CryptoContext<DCRTPoly>& cc) {
+    usint towers = cc->GetElementParams()->GetParams().size();
+    return min<usint>(max<usint>(towers, 1) - 1, numeric_limits<usint>::digits - 1);
+}
+
+#endif // POLYNOMIALEVALUATOR_H
@@ -0,0 +1,92 @@
+#ifndef RESULTCOMPACTOR_H
+#define RESULTCOMPACTOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <palisade.h>
+#include "serialization.h"
+
+using namespace std;
+using namespace lbcrypto;
+
+/** @brief Shrinks a result ciphertext before it is serialized and sent back:
+ * it is relinearized down to two polynomials and compressed to the fewest towers
+ * that still hold the result.
+ *
+ * Only the RNS schemes (BGVrns and CKKS) implement Relinearize and Compress; BGV
+ * ciphertexts have a single modulus and are already relinearized by EvalMult, so for
+ * those the ciphertexts are returned unchanged.
+ */
+template <class Element>
+class ResultCompactor {
+
+    public:
+        static Ciphertext<Element> compact(const CryptoContext<Element>& /*cc*/, const Ciphertext<Element>& ciphertext,
+                                           double /*maxMagnitude*/, bool /*compress*/) {
+            return ciphertext;
+        }
+
+        /** Returns the number of bytes the ciphertext takes up once serialized */
+        static size_t getSerializedSize(const Ciphertext<Element>& ciphertext) {
+            stringstream stream;
+            Serial::Serialize(ciphertext, stream, SerType::BINARY);
+            return stream.str().size();
+        }
+};
+
+template <>
+class ResultCompactor<DCRTPoly> {
+
+    public:
+        static Ciphertext<DCRTPoly> compact(const CryptoContext<DCRTPoly>& cc, const Ciphertext<DCRTPoly>& ciphertext,
+                                            double maxMagnitude, bool compress) {
+            Ciphertext<DCRTPoly> compacted = ciphertext;
+            if (compacted->GetElements().size() > 2) {
+                compacted = cc->Relinearize(compacted);
+            }
+
+            size_t towersLeft = getTowersLeft(compacted, getRequiredBits(cc, compacted, maxMagnitude));
+            if (compress && towersLeft < compacted->GetElements()[0].GetNumOfElements()) {
+                // Compress rescales (CKKS) or mod-switches (BGVrns) down to the remaining towers
+                compacted = cc->GetEncryptionAlgorithm()->Compress(compacted, towersLeft);
+            }
+            return compacted;
+        }
+
+        /** Returns the modulus bits the result needs: for CKKS the bits of its current scaling factor plus
+         *  those of its largest magnitude, or for BGVrns the plaintext modulus plus the rounding noise of the
+         *  modulus switch, which is at most about p * n. A CKKS product that was not rescaled is still at
+         *  its depth's power of the encoding scale, e.g. 2^(2p) after one multiplication.
+         */
+        static double getRequiredBits(const CryptoContext<DCRTPoly>& cc, const Ciphertext<DCRTPoly>& ciphertext, double maxMagnitude) {
+            double p = cc->GetCryptoParameters()->GetPlaintextModulus();
+            if (cc->getSchemeId() == "CKKS") {
+                // The encoding scale is stored as the plaintext modulus, in bits
+                double scaleBits = ciphertext->GetScalingFactor() > 1 ? log2(ciphertext->GetScalingFactor())
+                                                                     : p * max<size_t>(ciphertext->GetDepth(), 1);
+                return scaleBits + log2(maxMagnitude + 1) + 1;
+            }
+            return log2(p) + log2(cc->GetRingDimension()) + 1;
+        }
+
+        /** Returns the fewest towers, counted from the first one, whose moduli have more than `minBits` bits */
+        static size_t getTowersLeft(const Ciphertext<DCRTPoly>& ciphertext, double minBits) {
+            const auto& towerParams = ciphertext->GetElements()[0].GetParams()->GetParams();
+            size_t towersLeft = 0;
+            double bits = 0;
+            while (towersLeft < towerParams.size() && bits <= minBits) {
+                bits += towerParams[towersLeft]->GetModulus().GetMSB();
+                towersLeft++;
+            }
+            return towersLeft;
+        }
+
+        static size_t getSerializedSize(const Ciphertext<DCRTPoly>& ciphertext) {
+            stringstream stream;
+            Serial::Serialize(ciphertext, stream, SerType::BINARY);
+            return stream.str().size();
+        }
+};
+
+#endif // RESULTCOMPACTOR_H
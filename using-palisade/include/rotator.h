@@ -0,0 +1,71 @@
+#ifndef ROTATOR_H
+#define ROTATOR_H
+
+#include <vector>
+#include <palisade.h>
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Rotates a single source ciphertext by many indices using hoisted automorphisms.
+ *
+ *  The digit decomposition of the source (EvalFastRotationPrecompute) is computed once
+ *  on construction and shared by every rotation, so each rotation only pays for the
+ *  automorphism and key switch. Only supported by the DCRTPoly schemes (BGVrns and CKKS),
+ *  and the rotation keys must have been generated with `generateRotationKeys`.
+ */
+template <class Element>
+class Rotator {
+
+    public:
+        Rotator(const CryptoContext<Element>& cc, const Ciphertext<Element>& source)
+            : cc(cc), source(source), m(cc->GetCyclotomicOrder()), digits(cc->EvalFastRotationPrecompute(source)) {};
+        ~Rotator() {};
+
+        /** Generates the rotation keys needed by `sumRotations(count)` */
+        static void generateRotationKeys(const CryptoContext<Element>& cc, const LPPrivateKey<Element>& secretKey, usint count) {
+            cc->EvalAtIndexKeyGen(secretKey, rotationIndices(count));
+        }
+
+        /** Returns the source rotated to the left by `index` slots */
+        Ciphertext<Element> rotate(usint index) const {
+            return cc->EvalFastRotation(source, index, m, digits);
+        }
+
+        vector<Ciphertext<Element>> rotate(const vector<usint>& indices) const {
+            vector<Ciphertext<Element>> rotated;
+            rotated.reserve(indices.size());
+            for (usint index : indices) {
+                rotated.push_back(rotate(index));
+            }
+            return rotated;
+        }
+
+        /** Returns a ciphertext whose first slot holds the sum of the first `count` slots of the source */
+        Ciphertext<Element> sumRotations(usint count) const {
+            vector<Ciphertext<Element>> terms;
+            terms.reserve(count);
+            terms.push_back(source);
+            for (usint i = 1; i < count; i++) {
+                terms.push_back(rotate(i));
+            }
+            return cc->EvalAddManyInPlace(terms);
+        }
+
+    private:
+        CryptoContext<Element> cc;
+        Ciphertext<Element> source;
+        usint m; // cyclotomic order
+        shared_ptr<vector<Element>> digits; // digit decomposition of the source, shared by all rotations
+
+        static vector<int32_t> rotationIndices(usint count) {
+            vector<int32_t> indices;
+            for (usint i = 1; i < count; i++) {
+                indices.push_back(i);
+            }
+            return indices;
+        }
+};
+
+#endif // ROTATOR_H
@@ -0,0 +1,15 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+// Serializing a ciphertext or a key also serializes its crypto context, whose parameters and scheme
+// are polymorphic: cereal only knows the types registered by the schemes' "-ser.h" headers and throws
+// "unregistered polymorphic type" for any other, so every file that serializes includes this header.
+#include <palisade.h>
+#include <ciphertext-ser.h>
+#include <cryptocontext-ser.h>
+#include <pubkeylp-ser.h>
+#include <scheme/bgv/bgv-ser.h>
+#include <scheme/bgvrns/bgvrns-ser.h>
+#include <scheme/ckks/ckks-ser.h>
+
+#endif // SERIALIZATION_H
@@ -0,0 +1,117 @@
+#ifndef SQUAREDDIFFERENCESUM_H
+#define SQUAREDDIFFERENCESUM_H
+
+#include <vector>
+#include <palisade.h>
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Computes sum_i (a_i - b_i)^2 as a single operation.
+ *
+ *  For Poly (BGV) the sum is evaluated with the usual ciphertext operations.
+ */
+template <class Element>
+class SquaredDifferenceSum {
+
+    public:
+        static Ciphertext<Element> evaluate(const CryptoContext<Element>& cc, const vector<Ciphertext<Element>>& a,
+                                            const vector<Ciphertext<Element>>& b) {
+            Ciphertext<Element> sum;
+            for (size_t i = 0; i < a.size(); i++) {
+                auto diff = cc->EvalSub(a[i], b[i]);
+                auto square = cc->EvalMultMutable(diff, diff);
+                sum = sum ? cc->EvalAddMutable(sum, square) : square;
+            }
+            return sum;
+        }
+};
+
+/** For the RNS schemes (BGVrns and CKKS) the sum is fused on the DCRTPoly components: differences,
+ *  squares and the running sum are computed tower by tower in evaluation format, the tensor product
+ *  (d0^2, 2 d0 d1, d1^2) is accumulated in three polynomials and a single ciphertext is built and
+ *  relinearized at the end, without any intermediate ciphertext objects or format conversions.
+ *
+ *  Inputs that cannot be fused (different levels or depths, or already of size 3) fall back to
+ *  the library operations with a single deferred relinearization.
+ */
+template <>
+class SquaredDifferenceSum<DCRTPoly> {
+
+    public:
+        static Ciphertext<DCRTPoly> evaluate(const CryptoContext<DCRTPoly>& cc, const vector<Ciphertext<DCRTPoly>>& a,
+                                             const vector<Ciphertext<DCRTPoly>>& b) {
+            if (!canFuse(a, b)) {
+                return evaluateUnfused(cc, a, b);
+            }
+
+            // t0 + t1 s + t2 s^2 accumulates the tensor product of every squared difference
+            vector<DCRTPoly> tensor(3);
+            DCRTPoly d0, d1, cross;
+            for (size_t i = 0; i < a.size(); i++) {
+                const vector<DCRTPoly>& aElements = a[i]->GetElements();
+                const vector<DCRTPoly>& bElements = b[i]->GetElements();
+                // Copy-assigning into the buffers of the previous iteration keeps their storage
+                d0 = aElements[0];
+                d0 -= bElements[0];
+                d1 = aElements[1];
+                d1 -= bElements[1];
+                cross = d0;
+                cross *= d1;
+                d0 *= d0;
+                d1 *= d1;
+                if (i == 0) {
+                    tensor[0] = d0;
+                    tensor[1] = cross;
+                    tensor[2] = d1;
+                } else {
+                    tensor[0] += d0;
+                    tensor[1] += cross;
+                    tensor[2] += d1;
+                }
+                tensor[1] += cross;
+            }
+
+            Ciphertext<DCRTPoly> sum = a[0]->CloneEmpty();
+            sum->SetElements(move(tensor));
+            sum->SetDepth(2 * a[0]->GetDepth());
+            sum->SetLevel(a[0]->GetLevel());
+            sum->SetScalingFactor(a[0]->GetScalingFactor() * a[0]->GetScalingFactor());
+            return cc->Relinearize(sum);
+        }
+
+        /** Returns whether every input is a size-2 ciphertext in evaluation format at the same level and depth */
+        static bool canFuse(const vector<Ciphertext<DCRTPoly>>& a, const vector<Ciphertext<DCRTPoly>>& b) {
+            if (a.empty() || a.size() != b.size()) {
+                return false;
+            }
+            const Ciphertext<DCRTPoly>& first = a[0];
+            size_t towers = first->GetElements()[0].GetNumOfElements();
+            for (size_t i = 0; i < a.size(); i++) {
+                for (const Ciphertext<DCRTPoly>& ciphertext : {a[i], b[i]}) {
+                    const vector<DCRTPoly>& elements = ciphertext->GetElements();
+                    if (elements.size() != 2 || elements[0].GetNumOfElements() != towers
+                        || elements[0].GetFormat() != EVALUATION || elements[1].GetFormat() != EVALUATION
+                        || ciphertext->GetDepth() != first->GetDepth() || ciphertext->GetLevel() != first->GetLevel()) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        static Ciphertext<DCRTPoly> evaluateUnfused(const CryptoContext<DCRTPoly>& cc, const vector<Ciphertext<DCRTPoly>>& a,
+                                                    const vector<Ciphertext<DCRTPoly>>& b) {
+            Ciphertext<DCRTPoly> sum;
+            for (size_t i = 0; i < a.size(); i++) {
+                auto diff = cc->EvalSub(a[i], b[i]);
+                auto square = cc->EvalMultNoRelin(diff, diff);
+                sum = sum ? cc->EvalAddMutable(sum, square) : square;
+            }
+            return cc->Relinearize(sum);
+        }
+};
+
+#endif // SQUAREDDIFFERENCESUM_H
@@ -0,0 +1,46 @@
+#ifndef TIMINGGUARD_H
+#define TIMINGGUARD_H
+
+#include <vector>
+#include <palisade.h>
+
+using namespace std;
+using namespace lbcrypto;
+using std::vector;
+
+/** @brief Starts the library's timing of every operation of a context (StartTiming) and stops it
+ * (StopTiming) at the latest when it goes out of scope.
+ *
+ * The context keeps a pointer to the samples, so the guard must be declared after them: it is then
+ * destroyed first, and the context never appends to samples that no longer exist, even if the
+ * timed computation throws.
+ */
+template <class Element>
+class TimingGuard {
+
+    public:
+        /** Does nothing if `timings` is nullptr */
+        TimingGuard(const CryptoContext<Element>& cc, vector<TimingInfo>* timings) : cc(cc), running(timings != nullptr) {
+            if (running) {
+                cc->StartTiming(timings);
+            }
+        };
+        ~TimingGuard() {
+            stop();
+        };
+        TimingGuard(const TimingGuard&) = delete;
+        TimingGuard& operator=(const TimingGuard&) = delete;
+
+        void stop() {
+            if (running) {
+                cc->StopTiming();
+                running = false;
+            }
+        }
+
+    private:
+        CryptoContext<Element> cc;
+        bool running;
+};
+
+#endif // TIMINGGUARD_H
@@ -1,17 +1,24 @@
 #include "params.h"
 #include "paramsrunner.h"
+#include "benchmarkharness.h"
+#include "costmodel.h"
+#include "distancepipeline.h"
+#include "header.h"
+#include "ophistogram.h"
+#include "palisadebackend.h"
+#include "paramautotuner.h"
+#include "paramselector.h"
+#include "perfcounters.h"
+#include "regressiongate.h"
+#include "resultswriter.h"
+#include "scalabilitybenchmark.h"
+#include "squareddifferencesum.h"
+#include "sweepscheduler.h"
+#include "tracer.h"
 
 using namespace std;
 using namespace lbcrypto;
 
-void printHeader(string schemeName, string setNumber) {
-    string title = "| Running " + schemeName + " " + setNumber + " parameter set... |";
-    string border(title.length(), '-');
-    cout << border << endl;
-    cout << title << endl;
-    cout << border << "\n" << endl;
-}
-
 /** Runs distance computation on a single parameter set
  *  @param value is the parameter set
  */
@@ -29,10 +36,15 @@ double runDistComp(T x1, T y1, T x2, T y2, ParamType value,
         supportsComposedMult = true; // only BGVrns supports ComposedEvalMult
     }
 
+    bool supportsDeferredRelin = false;
+    if (is_same<Element, DCRTPoly>::value) {
+        supportsDeferredRelin = true; // Relinearize is only implemented by the RNS schemes (BGVrns and CKKS)
+    }
+
     if (ckksParamsRunner != nullptr) {
-        ckksParamsRunner->runDistComp(x1, y1, x2, y2, cryptoContext, supportsComposedMult);
+        ckksParamsRunner->runDistComp(x1, y1, x2, y2, cryptoContext, supportsComposedMult, supportsDeferredRelin);
     } else {
-        paramsRunner->runDistComp(x1, y1, x2, y2, cryptoContext, supportsComposedMult);
+        paramsRunner->runDistComp(x1, y1, x2, y2, cryptoContext, supportsComposedMult, supportsDeferredRelin);
     }
 
     double finish = currentDateTime();
@@ -60,33 +72,29 @@ double computeDistCompAvgTime(T x1, T y1, T x2, T y2, ParamType value,
     return avgTime;
 }
 
-/** @brief Runs distance computation for all given parameter sets multiple times
- *  and prints the average time taken for it to run.
- *
- *  @param sampleNum Number of times each parameter set is run
- */
-template<class ParamType, class Element, typename T>
-void runDistCompTimeCheck(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string schemeName,
-                    ParamsRunner<Element, T> *paramsRunner, int sampleNum) {
-    typename map<int, ParamType>::iterator iter;
-
-    cout << "Running each " << schemeName << " parameter set " << sampleNum << " times" << endl;
-
-    for (iter = paramSets.begin(); iter != paramSets.end(); iter++) {
-        auto key = iter->first;
-        auto value = iter->second;
+/** Predicts the time of one distance computation: key generation, four encryptions, two products and five decryptions */
+template<class ParamType>
+double predictDistCompTime(const ParamType& value, const CostModel& costModel) {
+    return costModel.estimate(value.getCostShape()).getWorkloadTime(4, 2, 5);
+}
 
-        printHeader(schemeName, to_string(key));
-        double avgTime = computeDistCompAvgTime<ParamType, Element, T>(x1, y1, x2, y2, value, paramsRunner, sampleNum);
-        cout << "Average Time Taken: " << avgTime << "ms \n" <<  endl;
+/** Appends the last run of `paramsRunner` to the results file, if there is one */
+template<class Element, typename T>
+void writeLastRun(ResultsWriter* resultsWriter, const ParamsRunner<Element, T>& paramsRunner, const string& schemeName, int key) {
+    if (resultsWriter == nullptr) {
+        return;
     }
+    RunRecord record = paramsRunner.getLastRun();
+    record.scheme = schemeName;
+    record.paramSet = to_string(key);
+    resultsWriter->write(record);
 }
 
 /** @brief Runs distance computation on all given parameter sets */
 
 template<class ParamType, class Element, typename T>
 void runDistComp(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string schemeName,
-         ParamsRunner<Element, T> *paramsRunner) {
+         ParamsRunner<Element, T> *paramsRunner, ResultsWriter* resultsWriter = nullptr) {
 
     typename map<int, ParamType>::iterator iter;
 
@@ -96,40 +104,206 @@ void runDistComp(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string s
 
         printHeader(schemeName, to_string(key));
         runDistComp(x1, y1, x2, y2, value, paramsRunner);
+        writeLastRun(resultsWriter, *paramsRunner, schemeName, key);
     }
 }
 
-void runDistCompBGVrns(int64_t x1, int64_t y1, int64_t x2, int64_t y2, bool isTimeCheck, int sampleNum = 0) {
+/** @brief Runs distance computation on the cheapest parameter set that supports the
+ *  multiplicative depth of the distance expression, which is known at compile time
+ */
+template<class ParamType, class Element, typename T>
+void runDistCompMinimal(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string schemeName,
+                        ParamsRunner<Element, T> *paramsRunner, const ParamSelector<ParamType>& selector,
+                        ResultsWriter* resultsWriter = nullptr) {
+    constexpr size_t depth = DistanceSquaredExpression::depth();
+    int key = selector.select(paramSets, depth);
+    cout << "Selected " << schemeName << " parameter set " << key << " for multiplicative depth " << depth << endl;
+
+    printHeader(schemeName, to_string(key));
+    runDistComp(x1, y1, x2, y2, paramSets.at(key), paramsRunner);
+    writeLastRun(resultsWriter, *paramsRunner, schemeName, key);
+}
+
+void runDistCompBGVrns(int64_t x1, int64_t y1, int64_t x2, int64_t y2, ResultsWriter* resultsWriter = nullptr) {
     string schemeName = "BGVrns";
     ParamsRunner<DCRTPoly, int64_t> paramsRunner;
-    if (isTimeCheck) {
-        runDistCompTimeCheck<BGVrnsParam, DCRTPoly, int64_t>(x1, y1, x2, y2, BGVrnsParam::ParamSets,
-                                                             schemeName, &paramsRunner, sampleNum);
-    } else {
-        runDistComp<BGVrnsParam, DCRTPoly, int64_t>(x1, y1, x2, y2, BGVrnsParam::ParamSets, schemeName, &paramsRunner);
-    }
+    runDistComp<BGVrnsParam, DCRTPoly, int64_t>(x1, y1, x2, y2, BGVrnsParam::ParamSets, schemeName, &paramsRunner, resultsWriter);
 }
 
-void runDistCompBGV(int64_t x1, int64_t y1, int64_t x2, int64_t y2, bool isTimeCheck, int sampleNum = 0) {
+void runDistCompBGV(int64_t x1, int64_t y1, int64_t x2, int64_t y2, ResultsWriter* resultsWriter = nullptr) {
     string schemeName = "BGV";
     ParamsRunner<Poly, int64_t> paramsRunner;
-    if (isTimeCheck) {
-        runDistCompTimeCheck<BGVParam, Poly, int64_t>(x1, y1, x2, y2, BGVParam::ParamSets,
-                                                      schemeName, &paramsRunner, sampleNum);
-    } else {
-        runDistComp<BGVParam, Poly, int64_t>(x1, y1, x2, y2, BGVParam::ParamSets, schemeName, &paramsRunner);
-    }
+    runDistComp<BGVParam, Poly, int64_t>(x1, y1, x2, y2, BGVParam::ParamSets, schemeName, &paramsRunner, resultsWriter);
 }
 
-void runDistCompCKKS(complex<double> x1, complex<double> y1, complex<double> x2, complex<double> y2, bool isTimeCheck, int sampleNum = 0) {
+void runDistCompCKKS(complex<double> x1, complex<double> y1, complex<double> x2, complex<double> y2, ResultsWriter* resultsWriter = nullptr) {
     string schemeName = "CKKS";
     CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
-    if (isTimeCheck) {
-        runDistCompTimeCheck<CKKSParam, DCRTPoly, complex<double>>(x1, y1, x2, y2, CKKSParam::ParamSets,
-                                                                   schemeName, &ckksParamsRunner, sampleNum);
+    runDistComp<CKKSParam, DCRTPoly, complex<double>>(x1, y1, x2, y2, CKKSParam::ParamSets, schemeName, &ckksParamsRunner, resultsWriter);
+}
+
+/** Runs the distance computation once on the set of `paramSets` that `costModel` predicts to be the cheapest
+ *  and rescales the model by the time it took; a set that fails leaves the model as it is
+ */
+template<class ParamType, class Element, typename T>
+void observeCheapestSet(const vector<T>& coords, const map<int, ParamType>& paramSets, ParamsRunner<Element, T>* paramsRunner,
+                        CostModel& costModel) {
+    auto cheapest = min_element(paramSets.begin(), paramSets.end(), [&](const pair<const int, ParamType>& a,
+                                                                       const pair<const int, ParamType>& b) {
+        return predictDistCompTime(a.second, costModel) < predictDistCompTime(b.second, costModel);
+    });
+    if (cheapest == paramSets.end()) {
+        return;
+    }
+    double predicted = predictDistCompTime(cheapest->second, costModel);
+    try {
+        double measured = computeDistCompAvgTime<ParamType, Element, T>(coords[0], coords[1], coords[2], coords[3], cheapest->second,
+                                                                        paramsRunner, 1);
+        costModel.addObservation(cheapest->second.getCostShape().family, predicted, measured);
+    } catch (const exception& e) {
+        cout << "Could not calibrate the cost model on set " << cheapest->first << ": " << e.what() << endl;
+    }
+}
+
+/** Prints the factor by which the library's times differ from the synthetic estimates, for each cost family */
+void printCalibration(const CostModel& costModel, const string& verb) {
+    cout << "Cost model " << verb << ": the library takes " << costModel.getCalibration(CostFamily::RNS)
+        << " times the synthetic estimates for BGVrns and CKKS, and " << costModel.getCalibration(CostFamily::Poly)
+        << " times for BGV\n" << endl;
+}
+
+/** @brief Returns the cost model of this host, for comparing predictions with time limits.
+ *
+ *  The synthetic benchmark of CostModel::calibrate only ranks the sets, so the model is then rescaled by
+ *  one real distance computation on the cheapest set of every scheme: BGV rescales the multiprecision
+ *  (Poly) family, and BGVrns and CKKS the RNS one.
+ */
+CostModel calibrateCostModel(const vector<int64_t>& intCoords, const vector<complex<double>>& doubleCoords) {
+    CostModel costModel = CostModel::calibrate();
+    ParamsRunner<DCRTPoly, int64_t> bgvrnsParamsRunner;
+    ParamsRunner<Poly, int64_t> bgvParamsRunner;
+    CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+    observeCheapestSet<BGVrnsParam, DCRTPoly, int64_t>(intCoords, BGVrnsParam::ParamSets, &bgvrnsParamsRunner, costModel);
+    observeCheapestSet<BGVParam, Poly, int64_t>(intCoords, BGVParam::ParamSets, &bgvParamsRunner, costModel);
+    observeCheapestSet<CKKSParam, DCRTPoly, complex<double>>(doubleCoords, CKKSParam::ParamSets, &ckksParamsRunner, costModel);
+    printCalibration(costModel, "calibrated");
+    return costModel;
+}
+
+/** Makes one sweep task per parameter set, each running this executable with `--sweep-task` on `threads` threads,
+ *  leaving out the sets predicted to take longer than `timeLimit` ms per run
+ *  @param coords are the four coordinates, separated by spaces
+ */
+template<class ParamType>
+vector<SweepTask> makeSweepTasks(const string& executable, const map<int, ParamType>& paramSets, const string& schemeName,
+                                 const string& coords, int sampleNum, int threads, const CostModel& costModel, double timeLimit) {
+    vector<SweepTask> tasks;
+    for (const auto& entry : paramSets) {
+        string key = to_string(entry.first);
+        double predicted = predictDistCompTime(entry.second, costModel);
+        if (timeLimit > 0 && predicted > timeLimit) {
+            cout << "Skipping " << schemeName << " " << key << ", as it is predicted to take " << predicted << "ms" << endl;
+            continue;
+        }
+        tasks.push_back({schemeName + " " + key,
+                         "\"" + executable + "\" --sweep-task " + schemeName + " " + key + " " + to_string(sampleNum) + " " + coords
+                             + " --threads " + to_string(threads),
+                         predicted});
+    }
+    return tasks;
+}
+
+/** @brief Runs the distance computation time checks of every scheme as one parallel sweep
+ *  and prints the average time taken by each parameter set; the times measured rescale `costModel`.
+ *
+ *  @param threads the threads PALISADE uses within each set; keep 1 when the scheduler pins every set to a core
+ */
+void runDistCompTimeCheckParallel(const string& executable, const string& intCoords, const string& doubleCoords, int sampleNum,
+                                  int threads, const SweepScheduler& scheduler, CostModel& costModel, double timeLimit) {
+    vector<SweepTask> tasks = makeSweepTasks(executable, BGVrnsParam::ParamSets, "BGVrns", intCoords, sampleNum, threads, costModel,
+                                             timeLimit);
+    vector<SweepTask> bgvTasks = makeSweepTasks(executable, BGVParam::ParamSets, "BGV", intCoords, sampleNum, threads, costModel, timeLimit);
+    vector<SweepTask> ckksTasks = makeSweepTasks(executable, CKKSParam::ParamSets, "CKKS", doubleCoords, sampleNum, threads, costModel,
+                                                 timeLimit);
+    tasks.insert(tasks.end(), bgvTasks.begin(), bgvTasks.end());
+    tasks.insert(tasks.end(), ckksTasks.begin(), ckksTasks.end());
+
+    cout << "Running each parameter set " << sampleNum << " times on " << threads << (threads == 1 ? " thread" : " threads")
+        << ", several sets at a time" << endl;
+    double memoryBoundMPKI;
+    vector<SweepResult> results = scheduler.run(tasks, &memoryBoundMPKI);
+    map<CostFamily, vector<pair<double, double>>> observations;
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& result = results[i];
+        size_t split = result.name.rfind(' ');
+        printHeader(result.name.substr(0, split), result.name.substr(split + 1));
+        cout << "Predicted Time: " << tasks[i].predictedTime << "ms" << endl;
+        if (!result.succeeded) {
+            cout << "Failed to run \n" << endl;
+            continue;
+        }
+        cout << "Average Time Taken: " << result.wallTime << "ms (CPU time: " << result.cpuTime << "ms"
+            << (result.cacheMPKI >= 0 ? ", LLC MPKI: " + to_string(result.cacheMPKI) : "")
+            << (result.rerunInIsolation ? ", rerun in isolation, " + to_string(result.slowdown) + "x as long in parallel" : "")
+            << ") \n" << endl;
+        CostFamily family = result.name.substr(0, split) == "BGV" ? CostFamily::Poly : CostFamily::RNS;
+        observations[family].push_back({tasks[i].predictedTime, result.wallTime});
+    }
+    SweepScheduler::printMemoryBound(memoryBoundMPKI);
+    for (const auto& entry : observations) {
+        costModel.addObservations(entry.first, entry.second);
+    }
+    printCalibration(costModel, "recalibrated");
+}
+
+/** @brief Runs the time check of a single parameter set; this is what every sweep task runs.
+ *
+ *  Arguments: --sweep-task <scheme> <set> <sampleNum> <x1> <y1> <x2> <y2> [--threads <threads>] [--cpu <core>]
+ *  PALISADE runs on a single thread unless `--threads` says otherwise, so that a task pinned to a core stays on it.
+ */
+int runSweepTask(int argc, char* argv[]) {
+    if (argc < 9) {
+        cout << "Usage: --sweep-task <scheme> <set> <sampleNum> <x1> <y1> <x2> <y2> [--threads <threads>] [--cpu <core>]" << endl;
+        return 1;
+    }
+    string schemeName = argv[2];
+    int key = stoi(argv[3]);
+    int sampleNum = stoi(argv[4]);
+    int threads = 1;
+    for (int i = 9; i + 1 < argc; i += 2) {
+        if (string(argv[i]) == "--threads") {
+            threads = stoi(argv[i + 1]);
+        } else if (string(argv[i]) == "--cpu") {
+            SweepWorker::pinToCore(stoul(argv[i + 1]));
+        }
+    }
+    PalisadeParallelControls.SetNumThreads(threads);
+
+    // Counted in this process, so that the scheduler can tell memory-bound sets, which other tasks slow down
+    PerfCounters perfCounters;
+    perfCounters.start();
+    double cpuStart = SweepWorker::getProcessCpuTime();
+    double avgTime;
+    if (schemeName == "BGVrns") {
+        ParamsRunner<DCRTPoly, int64_t> paramsRunner;
+        avgTime = computeDistCompAvgTime<BGVrnsParam, DCRTPoly, int64_t>(stoll(argv[5]), stoll(argv[6]), stoll(argv[7]), stoll(argv[8]),
+                                                                         BGVrnsParam::ParamSets.at(key), &paramsRunner, sampleNum);
+    } else if (schemeName == "BGV") {
+        ParamsRunner<Poly, int64_t> paramsRunner;
+        avgTime = computeDistCompAvgTime<BGVParam, Poly, int64_t>(stoll(argv[5]), stoll(argv[6]), stoll(argv[7]), stoll(argv[8]),
+                                                                  BGVParam::ParamSets.at(key), &paramsRunner, sampleNum);
+    } else if (schemeName == "CKKS") {
+        CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+        avgTime = computeDistCompAvgTime<CKKSParam, DCRTPoly, complex<double>>(stod(argv[5]), stod(argv[6]), stod(argv[7]), stod(argv[8]),
+                                                                               CKKSParam::ParamSets.at(key), &ckksParamsRunner, sampleNum);
     } else {
-        runDistComp<CKKSParam, DCRTPoly, complex<double>>(x1, y1, x2, y2, CKKSParam::ParamSets, schemeName, &ckksParamsRunner);
+        cout << "Unknown scheme " << schemeName << endl;
+        return 1;
     }
+    CounterSample counts = perfCounters.stop();
+    SweepWorker::reportResult(avgTime, (SweepWorker::getProcessCpuTime() - cpuStart) / sampleNum,
+                              perfCounters.isAvailable() ? counts.getCacheMPKI() : -1);
+    return 0;
 }
 
 /** Runs check on number of multiplications that can be performed for a single parameter set
@@ -184,13 +358,660 @@ void runMultCheckBGV(int64_t seed) {
     runMultCheck<BGVParam, Poly, int64_t>(seed, BGVParam::ParamSets, schemeName, &paramsRunner);
 }
 
-void runMultCheckCKKS(complex<double> seed) {
-    string schemeName = "CKKS";
-    ParamsRunner<DCRTPoly, complex<double>> paramsRunner;
-    runMultCheck<CKKSParam, DCRTPoly, complex<double>>(seed, CKKSParam::ParamSets, schemeName, &paramsRunner);
+/** Measures the multiplicative depth supported by every given parameter set, stopping at `maxDepth` levels */
+template<class ParamType, class Element>
+void runDepthMeasurement(int64_t seed, map<int, ParamType> paramSets, string schemeName, size_t maxDepth) {
+    ParamsRunner<Element, int64_t> paramsRunner;
+    for (const auto& entry : paramSets) {
+        printHeader(schemeName, to_string(entry.first));
+
+        double start = currentDateTime();
+        paramsRunner.runDepthMeasurement(seed, entry.second.generateCryptoContext(), maxDepth);
+        cout << "Total time taken: " << currentDateTime() - start << "ms \n" << endl;
+    }
+}
+
+/** Measures the precision of every given CKKS parameter set after each level of multiplication, stopping at
+ *  `maxDepth` levels or the levels of its modulus chain, whichever is fewer, or once the precision falls
+ *  under `minPrecisionBits`
+ */
+void runPrecisionCheckCKKS(const map<int, CKKSParam>& paramSets, double minPrecisionBits, size_t maxDepth) {
+    CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+    for (const auto& entry : paramSets) {
+        printHeader("CKKS", to_string(entry.first));
+        ckksParamsRunner.runPrecisionCheck(entry.second.generateCryptoContext(), minPrecisionBits, maxDepth);
+        cout << endl;
+    }
+}
+
+template<class Element>
+Plaintext makePlaintext(const CryptoContext<Element>& cc, complex<double> value) {
+    return cc->MakeCKKSPackedPlaintext(vector<complex<double>>{value});
+}
+
+template<class Element>
+Plaintext makePlaintext(const CryptoContext<Element>& cc, int64_t value) {
+    return cc->MakeCoefPackedPlaintext(vector<int64_t>{value});
+}
+
+/** @brief Benchmarks the distance computation on one parameter set phase by phase, without any printing
+ *  in the timed code, and prints the median, p90 and p99 of every phase.
+ *
+ *  PALISADE decodes as part of Decrypt, so the decrypt phase includes decoding. The evaluation is the
+ *  fused squared-difference sum, followed by ModReduce for the schemes supporting ComposedEvalMult.
+ */
+template<class ParamType, class Element, typename T>
+void benchmarkDistComp(T x1, T y1, T x2, T y2, ParamType value, bool supportsComposedMult, const BenchmarkHarness& harness) {
+    vector<T> coords = {x1, y1, x2, y2};
+    vector<PhaseStats> stats = harness.run([&](PhaseTimer& timer) {
+        CryptoContext<Element> cc;
+        timer.time("context generation", [&]() {
+            cc = value.generateCryptoContext();
+            cc->Enable(ENCRYPTION);
+            cc->Enable(SHE);
+            cc->Enable(LEVELEDSHE);
+        });
+
+        LPKeyPair<Element> keyPair;
+        timer.time("key generation", [&]() {
+            keyPair = cc->KeyGen();
+        });
+        timer.time("eval key generation", [&]() {
+            cc->EvalMultKeyGen(keyPair.secretKey);
+        });
+
+        vector<Ciphertext<Element>> ciphertexts(coords.size());
+        for (size_t i = 0; i < coords.size(); i++) {
+            Plaintext plaintext;
+            timer.time("encode", [&]() {
+                plaintext = makePlaintext<Element>(cc, coords[i]);
+            });
+            timer.time("encrypt", [&]() {
+                ciphertexts[i] = cc->Encrypt(keyPair.publicKey, plaintext);
+            });
+        }
+
+        Ciphertext<Element> distance;
+        timer.time("evaluate", [&]() {
+            distance = SquaredDifferenceSum<Element>::evaluate(cc, {ciphertexts[0], ciphertexts[1]}, {ciphertexts[2], ciphertexts[3]});
+            if (supportsComposedMult) {
+                distance = cc->ModReduce(distance);
+            }
+        });
+
+        Plaintext decrypted;
+        timer.time("decrypt", [&]() {
+            cc->Decrypt(keyPair.secretKey, distance, &decrypted);
+        });
+
+        // The library keeps evaluation keys in a global map until they are cleared
+        CryptoContextImpl<Element>::ClearEvalMultKeys(cc);
+    });
+    BenchmarkHarness::printReport(stats);
+}
+
+/** Runs the distance computation `sampleNum` times on one parameter set with the library's operation timing
+ *  enabled and prints the latency histogram of every operation, e.g. EvalMult against Relinearize
+ */
+template<class ParamType, class Element, typename T>
+void profileDistComp(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<Element, T> *paramsRunner, int sampleNum) {
+    OpProfile opProfile;
+    paramsRunner->setOpProfile(&opProfile);
+    for (int i = 0; i < sampleNum; i++) {
+        runDistComp(x1, y1, x2, y2, value, paramsRunner);
+        CryptoContextImpl<Element>::ClearEvalMultKeys();
+    }
+    paramsRunner->setOpProfile(nullptr);
+    opProfile.print();
+}
+
+/** Registers every parameter set of a scheme that the cost model predicts to take at most `timeLimit` ms per run
+ *  with the unified distance pipeline
+ */
+template<class ParamType, class Element>
+void registerParamSets(BackendRegistry& registry, map<int, ParamType> paramSets, string schemeName, bool supportsComposedMult,
+                       const CostModel& costModel, double timeLimit) {
+    bool supportsDeferredRelin = is_same<Element, DCRTPoly>::value;
+    typename map<int, ParamType>::iterator iter;
+
+    for (iter = paramSets.begin(); iter != paramSets.end(); iter++) {
+        ParamType value = iter->second;
+        if (predictDistCompTime(value, costModel) > timeLimit) {
+            continue;
+        }
+        registry.add("PALISADE " + schemeName + " " + to_string(iter->first), [value, supportsComposedMult, supportsDeferredRelin]() {
+            unique_ptr<PalisadeBackend<Element>> backend(new PalisadeBackend<Element>(value.generateCryptoContext(),
+                                                                                      supportsComposedMult, supportsDeferredRelin));
+            return unique_ptr<DistanceRunner>(new DistancePipeline<PalisadeBackend<Element>>(move(backend)));
+        });
+    }
+}
+
+/** Registers the parameter sets of every scheme; by default, all of them */
+void registerBackends(BackendRegistry& registry, const CostModel& costModel = CostModel(),
+                      double timeLimit = numeric_limits<double>::infinity()) {
+    registerParamSets<BGVrnsParam, DCRTPoly>(registry, BGVrnsParam::ParamSets, "BGVrns", true, costModel, timeLimit);
+    registerParamSets<BGVParam, Poly>(registry, BGVParam::ParamSets, "BGV", false, costModel, timeLimit);
+    registerParamSets<CKKSParam, DCRTPoly>(registry, CKKSParam::ParamSets, "CKKS", false, costModel, timeLimit);
+}
+
+/** Runs the library-independent distance pipeline on the given registered parameter sets.
+ *  Coordinates are given in degrees; integer schemes encode them in units of 10^{-3}.
+ */
+void runDistCompUnified(double x1, double y1, double x2, double y2, const BackendRegistry& registry, vector<string> paramSetNames) {
+    for (string paramSetName : paramSetNames) {
+        printHeader("unified", paramSetName);
+
+        DistanceResult result = registry.create(paramSetName)->run(x1, y1, x2, y2);
+        cout << "Library: " << result.library << ", n (dimension) = " << result.ringDimension << endl;
+        cout << "Distance Squared: " << result.expected << ", Decrypted: " << result.actual << endl;
+        cout << (result.correct ? "Successful" : "Failed") << endl;
+        cout << "Result size: " << result.resultSize << " bytes" << endl;
+        cout << "Evaluation time: " << result.evaluationTime << "ms \n" << endl;
+    }
+}
+
+/** @brief Runs one registered parameter set for the binary of the other library and prints its result (see RemoteDistanceRunner).
+ *
+ *  Arguments: --unified-task <name> <x1> <y1> <x2> <y2>
+ */
+int runUnifiedTask(int argc, char* argv[]) {
+    if (argc < 7) {
+        cout << "Usage: --unified-task <name> <x1> <y1> <x2> <y2>" << endl;
+        return 1;
+    }
+    BackendRegistry registry;
+    registerBackends(registry);
+    DistanceResult result = registry.create(argv[2])->run(stod(argv[3]), stod(argv[4]), stod(argv[5]), stod(argv[6]));
+    RemoteDistanceRunner::reportResult(result);
+    return 0;
+}
+
+/** Lists the parameter sets that the cost model predicts to take at most `timeLimit` ms per run, for the binary of the other library */
+int listBackends(double timeLimit, const vector<int64_t>& intCoords, const vector<complex<double>>& doubleCoords) {
+    BackendRegistry registry;
+    registerBackends(registry, calibrateCostModel(intCoords, doubleCoords), timeLimit);
+    for (const string& name : registry.getParamSetNames()) {
+        RemoteDistanceRunner::reportParamSetName(name);
+    }
+    return 0;
+}
+
+/** @brief Routes the distance workload of every ring dimension to the fastest parameter set of either library, then runs it there.
+ *
+ *  The sets of this binary that the cost model predicts to take at most `timeLimit` ms per run are measured in process,
+ *  and those that the binary of the other library, `peer`, affords by its own cost model, in that binary.
+ */
+int runRouted(const string& peer, size_t trials, double timeLimit, const vector<int64_t>& intCoords,
+              const vector<complex<double>>& doubleCoords) {
+    BackendRegistry registry;
+    registerBackends(registry, calibrateCostModel(intCoords, doubleCoords), timeLimit);
+    vector<string> names = registry.getParamSetNames();
+    vector<string> remoteNames = registerRemoteBackends(registry, peer);
+    if (remoteNames.empty()) {
+        cout << peer << " listed no parameter sets; routing among those of PALISADE only" << endl;
+    }
+    names.insert(names.end(), remoteNames.begin(), remoteNames.end());
+
+    cout << "Measuring " << names.size() << " parameter sets " << trials << " times each..." << endl;
+    BackendRouter router(trials);
+    router.measure(registry, names, 1.304, 103.874, 1.290, 103.789);
+    cout << "ROUTES BY RING DIMENSION" << endl;
+    router.printRoutes();
+
+    vector<string> routedNames;
+    for (const auto& entry : router.getRoutes()) {
+        routedNames.push_back(entry.second.paramSetName);
+    }
+    runDistCompUnified(1.304, 103.874, 1.290, 103.789, registry, routedNames);
+    return 0;
+}
+
+/** Ring dimensions searched by the autotuner; 0 lets the library pick the smallest one that is secure at the given level */
+const vector<int64_t> AutotuneRingDimensions = {0, 8192, 16384, 32768};
+
+/** Makes the BGVrns search space over ring dimension, plaintext modulus and key switching technique,
+ *  listing the smallest ring dimensions first; the modulus chain follows from the depth and the plaintext modulus
+ */
+vector<AutotuneCandidate<BGVrnsParam>> makeBGVrnsCandidates(int multDepth, SecurityLevel securityLevel) {
+    vector<AutotuneCandidate<BGVrnsParam>> candidates;
+    for (int64_t n : AutotuneRingDimensions) {
+        for (PlaintextModulus p : {65537, 786433, 536903681}) {
+            for (KeySwitchTechnique ksTech : {BV, HYBRID}) {
+                ostringstream name;
+                name << "BGVrnsParam(PlaintextModulus(" << p << "), " << n << ", " << multDepth << ", " << securityLevel
+                    << ", 3.19, 1, OPTIMIZED, " << (ksTech == BV ? "BV" : "HYBRID") << ")";
+                candidates.push_back({name.str(), BGVrnsParam(p, n, multDepth, securityLevel, 3.19, 1, OPTIMIZED, ksTech)});
+            }
+        }
+    }
+    return candidates;
 }
 
-int main() {
+/** Makes the CKKS search space over ring dimension, scaling factor (and with it the size of every
+ *  modulus in the chain), rescaling technique and key switching technique, listing the smallest ring dimensions first
+ */
+vector<AutotuneCandidate<CKKSParam>> makeCKKSCandidates(int multDepth, SecurityLevel securityLevel) {
+    vector<AutotuneCandidate<CKKSParam>> candidates;
+    for (int64_t n : AutotuneRingDimensions) {
+        for (int64_t scaleFactorBits : {20, 30, 40, 50}) {
+            for (RescalingTechnique rsTech : {APPROXRESCALE, EXACTRESCALE}) {
+                for (KeySwitchTechnique ksTech : {BV, HYBRID}) {
+                    ostringstream name;
+                    name << "CKKSParam(" << multDepth << ", " << scaleFactorBits << ", " << n << ", " << securityLevel << ", 8, "
+                        << (rsTech == APPROXRESCALE ? "APPROXRESCALE" : "EXACTRESCALE") << ", " << (ksTech == BV ? "BV" : "HYBRID") << ")";
+                    candidates.push_back({name.str(), CKKSParam(multDepth, scaleFactorBits, n, securityLevel, 8, rsTech, ksTech)});
+                }
+            }
+        }
+    }
+    return candidates;
+}
+
+/** @brief Searches the given candidates for the fastest parameter set that runs the distance workload through
+ *  the unified pipeline within `precision` (in degrees squared), and prints it in the form used by params.cpp
+ */
+template<class ParamType, class Element>
+void runAutotune(double x1, double y1, double x2, double y2, const vector<AutotuneCandidate<ParamType>>& candidates, string schemeName,
+                 bool supportsComposedMult, double precision, int sampleNum) {
+    bool supportsDeferredRelin = is_same<Element, DCRTPoly>::value;
+    ParamAutotuner<ParamType> autotuner([supportsComposedMult, supportsDeferredRelin](const ParamType& value) {
+        unique_ptr<PalisadeBackend<Element>> backend(new PalisadeBackend<Element>(value.generateCryptoContext(),
+                                                                                  supportsComposedMult, supportsDeferredRelin));
+        return unique_ptr<DistanceRunner>(new DistancePipeline<PalisadeBackend<Element>>(move(backend)));
+    }, precision, sampleNum);
+
+    cout << "Searching " << candidates.size() << " " << schemeName << " candidates..." << endl;
+    try {
+        size_t best = autotuner.tune(candidates, x1, y1, x2, y2);
+        autotuner.printResults();
+        const AutotuneResult& result = autotuner.getResults()[best];
+        cout << "Fastest correct " << schemeName << " configuration (n = " << result.ringDimension << ", "
+            << result.avgTime << "ms):" << endl;
+        cout << candidates[best].name << "\n" << endl;
+    } catch (const runtime_error& e) {
+        autotuner.printResults();
+        cout << e.what() << "\n" << endl;
+    }
+}
+
+/** Runs the distance computation `runs` times on one parameter set, without printing, and collects the runs */
+template<class ParamType, class Element, typename T>
+void collectRuns(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<Element, T> *paramsRunner, const string& schemeName, int key,
+                 int runs, vector<RunRecord>& records, ResultsWriter* resultsWriter) {
+    for (int i = 0; i < runs; i++) {
+        streambuf* old = cout.rdbuf(0);
+        runDistComp(x1, y1, x2, y2, value, paramsRunner);
+        CryptoContextImpl<Element>::ClearEvalMultKeys();
+        cout.rdbuf(old);
+
+        RunRecord record = paramsRunner->getLastRun();
+        record.scheme = schemeName;
+        record.paramSet = to_string(key);
+        records.push_back(record);
+        if (resultsWriter != nullptr) {
+            resultsWriter->write(record);
+        }
+    }
+}
+
+/** Collects `runs` runs of a parameter set given by name; returns false if there is no such set */
+bool collectRuns(const string& schemeName, int key, int runs, const vector<int64_t>& intCoords, const vector<complex<double>>& doubleCoords,
+                 vector<RunRecord>& records, ResultsWriter* resultsWriter) {
+    if (schemeName == "BGVrns" && BGVrnsParam::ParamSets.count(key) > 0) {
+        ParamsRunner<DCRTPoly, int64_t> paramsRunner;
+        collectRuns<BGVrnsParam, DCRTPoly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVrnsParam::ParamSets.at(key),
+                                                    &paramsRunner, schemeName, key, runs, records, resultsWriter);
+    } else if (schemeName == "BGV" && BGVParam::ParamSets.count(key) > 0) {
+        ParamsRunner<Poly, int64_t> paramsRunner;
+        collectRuns<BGVParam, Poly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVParam::ParamSets.at(key),
+                                             &paramsRunner, schemeName, key, runs, records, resultsWriter);
+    } else if (schemeName == "CKKS" && CKKSParam::ParamSets.count(key) > 0) {
+        CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+        collectRuns<CKKSParam, DCRTPoly, complex<double>>(doubleCoords[0], doubleCoords[1], doubleCoords[2], doubleCoords[3],
+                                                          CKKSParam::ParamSets.at(key), &ckksParamsRunner, schemeName, key, runs,
+                                                          records, resultsWriter);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** Returns the keys of every set */
+template<class ParamType>
+vector<int> getAllSets(const map<int, ParamType>& paramSets) {
+    vector<int> keys;
+    for (const auto& entry : paramSets) {
+        keys.push_back(entry.first);
+    }
+    return keys;
+}
+
+/** Returns the keys of the sets predicted by `costModel` to take at most `timeLimit` ms per run */
+template<class ParamType>
+vector<int> getAffordableSets(const map<int, ParamType>& paramSets, const CostModel& costModel, double timeLimit) {
+    vector<int> keys;
+    for (const auto& entry : paramSets) {
+        if (predictDistCompTime(entry.second, costModel) <= timeLimit) {
+            keys.push_back(entry.first);
+        }
+    }
+    return keys;
+}
+
+/** Returns the sets of `paramSets` with the given keys */
+template<class ParamType>
+map<int, ParamType> selectSets(const map<int, ParamType>& paramSets, const vector<int>& keys) {
+    map<int, ParamType> selected;
+    for (int key : keys) {
+        selected.insert({key, paramSets.at(key)});
+    }
+    return selected;
+}
+
+/** Returns the candidates predicted by `costModel` to take at most `timeLimit` ms per run */
+template<class ParamType>
+vector<AutotuneCandidate<ParamType>> getAffordableCandidates(const vector<AutotuneCandidate<ParamType>>& candidates,
+                                                             const CostModel& costModel, double timeLimit) {
+    vector<AutotuneCandidate<ParamType>> affordable;
+    for (const AutotuneCandidate<ParamType>& candidate : candidates) {
+        if (predictDistCompTime(candidate.param, costModel) <= timeLimit) {
+            affordable.push_back(candidate);
+        }
+    }
+    return affordable;
+}
+
+/** @brief Records a baseline for the regression gate: runs every parameter set that the cost model predicts
+ *  to take at most `timeLimit` ms per run `runs` times and writes the runs to `path`.
+ *
+ *  @param runs if 0, as many as the gate needs to detect a single regressed set among them, and at least 10
+ */
+int recordBaseline(const string& path, int runs, double timeLimit, const vector<int64_t>& intCoords,
+                   const vector<complex<double>>& doubleCoords) {
+    ResultsWriter resultsWriter(path);
+    CostModel costModel = calibrateCostModel(intCoords, doubleCoords);
+    vector<RunRecord> records;
+    map<string, vector<int>> sets = {{"BGVrns", getAffordableSets(BGVrnsParam::ParamSets, costModel, timeLimit)},
+                                     {"BGV", getAffordableSets(BGVParam::ParamSets, costModel, timeLimit)},
+                                     {"CKKS", getAffordableSets(CKKSParam::ParamSets, costModel, timeLimit)}};
+    size_t setCount = sets["BGVrns"].size() + sets["BGV"].size() + sets["CKKS"].size();
+    int requiredRuns = static_cast<int>(RegressionGate().getRequiredRuns(setCount));
+    if (runs <= 0) {
+        runs = max(10, requiredRuns);
+    } else if (runs < requiredRuns) {
+        cout << "With " << runs << " runs the gate cannot detect a single regressed set among " << setCount
+             << "; record at least " << requiredRuns << endl;
+    }
+    for (const auto& entry : sets) {
+        for (int key : entry.second) {
+            cout << "Recording " << entry.first << " " << key << " (" << runs << " runs)..." << endl;
+            collectRuns(entry.first, key, runs, intCoords, doubleCoords, records, &resultsWriter);
+        }
+    }
+    cout << "Recorded " << records.size() << " runs in " << path << endl;
+    return 0;
+}
+
+/** @brief Runs every PALISADE parameter set of the baseline as many times as the baseline did and compares
+ *  the total times of every set; returns 1 if any of them regressed or is missing (see RegressionGate), or if the
+ *  baseline cannot be read, 0 otherwise.
+ *
+ *  @param resultsPath if not empty, the fresh runs are also written there, e.g. to become the next baseline
+ */
+int runRegressionGate(const string& baselinePath, const string& resultsPath, const vector<int64_t>& intCoords,
+                      const vector<complex<double>>& doubleCoords) {
+    // Only the PALISADE runs of the baseline are compared; a file that cannot be read fails the gate
+    vector<RunRecord> baseline;
+    map<pair<string, int>, int> runsPerSet;
+    try {
+        for (const RunRecord& record : ResultsReader::read(baselinePath)) {
+            if (record.library == "PALISADE") {
+                baseline.push_back(record);
+                runsPerSet[{record.scheme, stoi(record.paramSet)}]++;
+            }
+        }
+    } catch (const exception& e) {
+        cout << "Could not read the baseline " << baselinePath << ": " << e.what() << endl;
+        return 1;
+    }
+    if (runsPerSet.empty()) {
+        cout << "The baseline " << baselinePath << " has no PALISADE runs" << endl;
+        return 1;
+    }
+
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (!resultsPath.empty()) {
+        resultsWriter.reset(new ResultsWriter(resultsPath));
+    }
+    vector<RunRecord> current;
+    for (const auto& entry : runsPerSet) {
+        cout << "Running " << entry.first.first << " " << entry.first.second << " (" << entry.second << " runs)..." << endl;
+        if (!collectRuns(entry.first.first, entry.first.second, entry.second, intCoords, doubleCoords, current, resultsWriter.get())) {
+            cout << "No such parameter set, so its phases are missing" << endl;
+        }
+    }
+
+    vector<RegressionResult> results = RegressionGate().compare(baseline, current);
+    RegressionGate::printReport(results);
+    bool regressed = RegressionGate::hasRegression(results);
+    cout << (regressed ? "REGRESSION DETECTED" : "NO REGRESSION") << endl;
+    return regressed ? 1 : 0;
+}
+
+/** Runs the distance computation once on each of `keys` with hardware counters enabled; the runner prints the counts
+ *  of every phase after each run
+ */
+template<class ParamType, class Element, typename T>
+void countDistComp(T x1, T y1, T x2, T y2, const map<int, ParamType>& paramSets, const vector<int>& keys, const string& schemeName,
+                   ParamsRunner<Element, T> *paramsRunner, PerfCounters& perfCounters, ResultsWriter* resultsWriter) {
+    paramsRunner->setPerfCounters(&perfCounters);
+    for (int key : keys) {
+        printHeader(schemeName, to_string(key));
+        runDistComp(x1, y1, x2, y2, paramSets.at(key), paramsRunner);
+        CryptoContextImpl<Element>::ClearEvalMultKeys();
+        writeLastRun(resultsWriter, *paramsRunner, schemeName, key);
+    }
+    paramsRunner->setPerfCounters(nullptr);
+}
+
+/** @brief Counts cycles, instructions, cache misses and branch misses over every phase of the distance computation on
+ *  every parameter set, however long it takes, as the largest ring dimensions are the ones that show a memory bound;
+ *  returns 1 if no counter is available.
+ *
+ *  A phase whose IPC drops and whose cache MPKI rises with the ring dimension is bound by memory bandwidth rather than compute.
+ *  @param resultsPath if not empty, the runs are also written there, with their counts
+ */
+int runPerfCounters(const string& resultsPath, const vector<int64_t>& intCoords, const vector<complex<double>>& doubleCoords) {
+    PerfCounters perfCounters;
+    if (!perfCounters.isAvailable()) {
+        cout << "No hardware counter is available; perf_event_open needs Linux and perf_event_paranoid at most 2" << endl;
+        return 1;
+    }
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (!resultsPath.empty()) {
+        resultsWriter.reset(new ResultsWriter(resultsPath));
+    }
+    ParamsRunner<DCRTPoly, int64_t> bgvrnsParamsRunner;
+    countDistComp<BGVrnsParam, DCRTPoly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVrnsParam::ParamSets,
+                                                  getAllSets(BGVrnsParam::ParamSets), "BGVrns",
+                                                  &bgvrnsParamsRunner, perfCounters, resultsWriter.get());
+    ParamsRunner<Poly, int64_t> bgvParamsRunner;
+    countDistComp<BGVParam, Poly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVParam::ParamSets,
+                                           getAllSets(BGVParam::ParamSets), "BGV",
+                                           &bgvParamsRunner, perfCounters, resultsWriter.get());
+    CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+    countDistComp<CKKSParam, DCRTPoly, complex<double>>(doubleCoords[0], doubleCoords[1], doubleCoords[2], doubleCoords[3],
+                                                        CKKSParam::ParamSets, getAllSets(CKKSParam::ParamSets),
+                                                        "CKKS", &ckksParamsRunner, perfCounters, resultsWriter.get());
+    return 0;
+}
+
+/** Runs the distance computation once on each of `keys` with tracing enabled, each run within a span of its parameter set;
+ *  with `useCircuit`, through the optimized circuit, whose concurrent branches are traced on their own threads
+ */
+template<class ParamType, class Element, typename T>
+void traceDistComp(T x1, T y1, T x2, T y2, const map<int, ParamType>& paramSets, const vector<int>& keys, const string& schemeName,
+                   ParamsRunner<Element, T> *paramsRunner, bool useCircuit, Tracer& tracer) {
+    paramsRunner->setTracer(&tracer);
+    paramsRunner->setUseCircuit(useCircuit);
+    for (int key : keys) {
+        printHeader(schemeName, to_string(key));
+        {
+            Tracer::Span span(&tracer, schemeName + " " + to_string(key) + (useCircuit ? " circuit" : ""), "parameter set");
+            runDistComp(x1, y1, x2, y2, paramSets.at(key), paramsRunner);
+        }
+        CryptoContextImpl<Element>::ClearEvalMultKeys();
+    }
+    paramsRunner->setUseCircuit(false);
+    paramsRunner->setTracer(nullptr);
+}
+
+/** @brief Traces the distance computation on every parameter set that the cost model predicts to take at most a minute
+ *  per run, step by step and then through the optimized circuit, and writes the spans to `path` as Chrome trace events.
+ *
+ *  Context generation is the part of a parameter set's span before its runDistComp span. The library's own
+ *  OpenMP threads are not traced, so their work shows up within the spans of the calling thread.
+ */
+int runTrace(const string& path, const vector<int64_t>& intCoords, const vector<complex<double>>& doubleCoords) {
+    Tracer tracer;
+    CostModel costModel = calibrateCostModel(intCoords, doubleCoords);
+    double timeLimit = 60000; // in ms
+    vector<int> bgvrnsKeys = getAffordableSets(BGVrnsParam::ParamSets, costModel, timeLimit);
+    vector<int> bgvKeys = getAffordableSets(BGVParam::ParamSets, costModel, timeLimit);
+    vector<int> ckksKeys = getAffordableSets(CKKSParam::ParamSets, costModel, timeLimit);
+
+    ParamsRunner<DCRTPoly, int64_t> bgvrnsParamsRunner;
+    ParamsRunner<Poly, int64_t> bgvParamsRunner;
+    CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+    for (bool useCircuit : {false, true}) {
+        traceDistComp<BGVrnsParam, DCRTPoly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVrnsParam::ParamSets,
+                                                      bgvrnsKeys, "BGVrns", &bgvrnsParamsRunner, useCircuit, tracer);
+        traceDistComp<BGVParam, Poly, int64_t>(intCoords[0], intCoords[1], intCoords[2], intCoords[3], BGVParam::ParamSets,
+                                               bgvKeys, "BGV", &bgvParamsRunner, useCircuit, tracer);
+        traceDistComp<CKKSParam, DCRTPoly, complex<double>>(doubleCoords[0], doubleCoords[1], doubleCoords[2], doubleCoords[3],
+                                                            CKKSParam::ParamSets, ckksKeys, "CKKS", &ckksParamsRunner, useCircuit, tracer);
+    }
+
+    if (!tracer.write(path)) {
+        cout << "Could not write the trace to " << path << endl;
+        return 1;
+    }
+    cout << "Wrote " << tracer.getSpanCount() << " spans to " << path << endl;
+    return 0;
+}
+
+/** Encodes a batch, one value per slot for CKKS; BGVrns coefficient packing encodes a single value per plaintext */
+template<class Element>
+Plaintext makeBatchPlaintext(const CryptoContext<Element>& cc, const vector<complex<double>>& values) {
+    return cc->MakeCKKSPackedPlaintext(values);
+}
+
+template<class Element>
+Plaintext makeBatchPlaintext(const CryptoContext<Element>& cc, const vector<int64_t>& values) {
+    return cc->MakeCoefPackedPlaintext(values);
+}
+
+/** Returns the time in ms to encode, encrypt, evaluate and decrypt a batch of `batchSize` distances, all between
+ *  the same two points, with the library's OpenMP parallelism limited to `threads` threads
+ */
+template<class Element, typename T>
+double timeDistCompBatch(const CryptoContext<Element>& cc, const LPKeyPair<Element>& keyPair, const vector<T>& coords,
+                         size_t threads, size_t batchSize, bool supportsComposedMult) {
+    PalisadeParallelControls.SetNumThreads(threads);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Ciphertext<Element>> ciphertexts;
+    for (const T& coord : coords) {
+        ciphertexts.push_back(cc->Encrypt(keyPair.publicKey, makeBatchPlaintext<Element>(cc, vector<T>(batchSize, coord))));
+    }
+    auto distance = SquaredDifferenceSum<Element>::evaluate(cc, {ciphertexts[0], ciphertexts[1]}, {ciphertexts[2], ciphertexts[3]});
+    if (supportsComposedMult) {
+        distance = cc->ModReduce(distance);
+    }
+    Plaintext decrypted;
+    cc->Decrypt(keyPair.secretKey, distance, &decrypted);
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/** Sweeps the thread count and the batch size, from 1 to `slots` distances, on the context of one parameter set,
+ *  prints the throughput and efficiency curves and writes them to `csv` unless it is nullptr
+ */
+template<class Element, typename T>
+void measureScalability(const vector<T>& coords, const CryptoContext<Element>& cc, size_t slots, const string& schemeName, int key,
+                        bool supportsComposedMult, const ScalabilityBenchmark& benchmark, const vector<size_t>& threadCounts,
+                        ostream* csv) {
+    printHeader(schemeName, to_string(key));
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    cc->Enable(LEVELEDSHE);
+    LPKeyPair<Element> keyPair = cc->KeyGen();
+    cc->EvalMultKeyGen(keyPair.secretKey);
+
+    vector<ScalabilityPoint> points = benchmark.run(threadCounts, ScalabilityBenchmark::getBatchSizes(slots),
+                                                    [&](size_t threads, size_t batchSize) {
+        return timeDistCompBatch(cc, keyPair, coords, threads, batchSize, supportsComposedMult);
+    });
+    PalisadeParallelControls.SetNumThreads(PalisadeParallelControls.GetMachineThreads());
+    CryptoContextImpl<Element>::ClearEvalMultKeys(cc);
+
+    ScalabilityBenchmark::printCurves(points);
+    if (csv != nullptr) {
+        ScalabilityBenchmark::writeCSV(*csv, "PALISADE", schemeName, to_string(key), cc->GetRingDimension(), points);
+    }
+}
+
+/** @brief Measures the distance throughput on every BGVrns and CKKS parameter set that the cost model predicts to take
+ *  at most `timeLimit` ms per run, sweeping the library's OpenMP threads from 1 to the number of physical cores and the
+ *  batch size from 1 distance to a full CKKS ciphertext of n / 2 slots, and prints the throughput and efficiency curves.
+ *
+ *  BGVrns is swept at a batch size of 1 only, as its sets use coefficient packing. BGV is left out: its single-modulus
+ *  Poly operations barely use the library's threads.
+ *  @param csvPath if not empty, the points are also written there as CSV
+ */
+int runScalability(const string& csvPath, double timeLimit, const vector<int64_t>& intCoords,
+                   const vector<complex<double>>& doubleCoords) {
+    unique_ptr<ofstream> csv;
+    if (!csvPath.empty()) {
+        csv.reset(new ofstream(csvPath));
+        if (!*csv) {
+            cout << "Could not open " << csvPath << endl;
+            return 1;
+        }
+        *csv << ScalabilityBenchmark::getCSVHeader() << "\n";
+    }
+    ScalabilityBenchmark benchmark;
+    vector<size_t> threadCounts = ScalabilityBenchmark::getThreadCounts();
+    CostModel costModel = calibrateCostModel(intCoords, doubleCoords);
+
+    for (int key : getAffordableSets(BGVrnsParam::ParamSets, costModel, timeLimit)) {
+        measureScalability<DCRTPoly, int64_t>(intCoords, BGVrnsParam::ParamSets.at(key).generateCryptoContext(), 1, "BGVrns", key,
+                                              true, benchmark, threadCounts, csv.get());
+    }
+    for (int key : getAffordableSets(CKKSParam::ParamSets, costModel, timeLimit)) {
+        const CKKSParam& value = CKKSParam::ParamSets.at(key);
+        // The ring dimension may be left to the library, so the full batch is known once a context is generated
+        size_t slots = value.generateCryptoContext()->GetRingDimension() / 2;
+        measureScalability<DCRTPoly, complex<double>>(doubleCoords, value.withBatchSize(slots).generateCryptoContext(), slots, "CKKS", key,
+                                                      false, benchmark, threadCounts, csv.get());
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--sweep-task") {
+        return runSweepTask(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--unified-task") {
+        return runUnifiedTask(argc, argv);
+    }
+
+    // With --results <file>, every run of the distance computation is also appended to the file,
+    // as CSV if its name ends in ".csv" and as JSON lines otherwise
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (argc > 2 && string(argv[1]) == "--results") {
+        resultsWriter.reset(new ResultsWriter(argv[2]));
+    }
+
     // The coordinates of the national stadium are
     // Latitude: 1.3044172525405884 or 1304.4172525405884 x 10^{-3}
     // Longitude: 103.87432861328125 or 103874.32861328125 x 10^{-3}
@@ -209,22 +1030,126 @@ int main() {
     complex<double> dsoXCoordDouble = 1.290;
     complex<double> dsoYCoordDouble = 103.789;
 
+    // --record-baseline <file> [runs] and --regression-gate <baseline> [<results>] compare sweeps of the same coordinates
+    vector<int64_t> intCoordValues = {stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord};
+    vector<complex<double>> doubleCoordValues = {stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble};
+    if (argc > 2 && string(argv[1]) == "--record-baseline") {
+        double timeLimit = 10000; // in ms per run, so that a baseline of 10 runs per set stays affordable
+        return recordBaseline(argv[2], argc > 3 ? stoi(argv[3]) : 0, timeLimit, intCoordValues, doubleCoordValues);
+    }
+    if (argc > 2 && string(argv[1]) == "--regression-gate") {
+        return runRegressionGate(argv[2], argc > 3 ? argv[3] : "", intCoordValues, doubleCoordValues);
+    }
+    // --perf-counters [<results>] reports hardware counters per phase and parameter set instead of the usual runs
+    if (argc > 1 && string(argv[1]) == "--perf-counters") {
+        return runPerfCounters(argc > 2 ? argv[2] : "", intCoordValues, doubleCoordValues);
+    }
+    // --trace <file> writes the spans of every stage of the distance computation, to be opened in chrome://tracing
+    if (argc > 2 && string(argv[1]) == "--trace") {
+        return runTrace(argv[2], intCoordValues, doubleCoordValues);
+    }
+    // --list-backends and --route <peer> [trials] route every ring dimension to the faster library, with the SEAL binary as peer
+    if (argc > 1 && string(argv[1]) == "--list-backends") {
+        double timeLimit = 10000; // in ms per run, as every listed set is measured a few times
+        return listBackends(timeLimit, intCoordValues, doubleCoordValues);
+    }
+    if (argc > 2 && string(argv[1]) == "--route") {
+        double timeLimit = 10000; // in ms per run, as for --list-backends
+        return runRouted(argv[2], argc > 3 ? stoul(argv[3]) : 3, timeLimit, intCoordValues, doubleCoordValues);
+    }
+    // --mult-check counts the multiplications every BGVrns and BGV set supports before its results are wrong; CKKS is
+    // left out, as its results are approximate (see the precision check instead)
+    if (argc > 1 && string(argv[1]) == "--mult-check") {
+        cout << "RUNNING MULTIPLY CHECK FOR BGVrns and BGV..." << endl;
+        runMultCheckBGVrns(1); // use 1 so that the result will always be less than the plaintext modulus
+        runMultCheckBGV(1);
+        return 0;
+    }
+    // --scalability [<csv>] sweeps the library's threads and the batch size to size machines, instead of the usual runs
+    if (argc > 1 && string(argv[1]) == "--scalability") {
+        double timeLimit = 10000; // in ms per run, as every set is run a few times per thread count and batch size
+        return runScalability(argc > 2 ? argv[2] : "", timeLimit, intCoordValues, doubleCoordValues);
+    }
+
     cout << "RUNNING DISTANCE COMPUTATION FOR ALL SCHEMES..." << endl;
-    runDistCompBGVrns(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, false);
-    runDistCompBGV(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, false);
-    runDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, false);
+    runDistCompBGVrns(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, resultsWriter.get());
+    runDistCompBGV(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, resultsWriter.get());
+    runDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, resultsWriter.get());
+
+    cout << "RUNNING DISTANCE COMPUTATION ON THE MINIMAL PARAMETER SETS..." << endl;
+    ParamsRunner<DCRTPoly, int64_t> bgvrnsParamsRunner;
+    ParamSelector<BGVrnsParam> bgvrnsSelector([](const BGVrnsParam& param) { return param.getMultDepth(); },
+                                              [](const BGVrnsParam& param) { return param.getRingDimension(); });
+    runDistCompMinimal(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, BGVrnsParam::ParamSets, "BGVrns",
+                       &bgvrnsParamsRunner, bgvrnsSelector, resultsWriter.get());
+    CKKSParamsRunner<DCRTPoly> ckksParamsRunner;
+    ParamSelector<CKKSParam> ckksSelector([](const CKKSParam& param) { return param.getMultDepth(); },
+                                          [](const CKKSParam& param) { return param.getRingDimension(); },
+                                          [](const CKKSParam& param) { return param.getScaleFactorBits(); });
+    runDistCompMinimal<CKKSParam, DCRTPoly, complex<double>>(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble,
+                                                             CKKSParam::ParamSets, "CKKS", &ckksParamsRunner, ckksSelector,
+                                                             resultsWriter.get());
 
     cout << "RUNNING DISTANCE COMPUTATION TIME CHECKS..." << endl;
     int sampleNum = 5; // number of times to run each parameter set
-    runDistCompBGVrns(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, true, sampleNum);
-    runDistCompBGV(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, true, sampleNum);
-    runDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, true, sampleNum);
-
-    cout << "RUNNING MULTIPLY CHECK FOR BGVrns and BGV..." << endl;
-    runMultCheckBGVrns(1); // use 1 so that the result will always be less than the plaintext modulus
-    runMultCheckBGV(1);
-    // there is currently no support for CKKS as there are approximation errors for this scheme
-    // and there is no function to compare plaintext values
+    // Parameter sets are independent, so they run concurrently, one process per core
+    SweepScheduler scheduler;
+    string intCoords = to_string(stadiumXCoord) + " " + to_string(stadiumYCoord) + " " + to_string(dsoXCoord) + " " + to_string(dsoYCoord);
+    string doubleCoords = to_string(real(stadiumXCoordDouble)) + " " + to_string(real(stadiumYCoordDouble)) + " "
+        + to_string(real(dsoXCoordDouble)) + " " + to_string(real(dsoYCoordDouble));
+    // Sets predicted by the cost model, calibrated on this host, to take over a minute per run are skipped
+    CostModel costModel = calibrateCostModel(intCoordValues, doubleCoordValues);
+    double timeLimit = 60000; // in ms
+    // One thread per set, as every set runs pinned to a physical core of its own
+    runDistCompTimeCheckParallel(argv[0], intCoords, doubleCoords, sampleNum, 1, scheduler, costModel, timeLimit);
+
+    cout << "RUNNING UNIFIED DISTANCE PIPELINE FOR ALL SCHEMES..." << endl;
+    BackendRegistry registry;
+    registerBackends(registry, costModel, timeLimit);
+    runDistCompUnified(1.304, 103.874, 1.290, 103.789, registry, registry.getParamSetNames());
+
+    // The remaining steps skip the same sets, and candidates, as the time checks
+    cout << "AUTOTUNING PARAMETERS FOR THE DISTANCE WORKLOAD..." << endl;
+    int depth = DistanceSquaredExpression::depth();
+    double precision = 0.000001; // in degrees squared, as for the unified pipeline
+    runAutotune<BGVrnsParam, DCRTPoly>(1.304, 103.874, 1.290, 103.789,
+                                       getAffordableCandidates(makeBGVrnsCandidates(depth, HEStd_128_classic), costModel, timeLimit),
+                                       "BGVrns", true, precision, 3);
+    runAutotune<CKKSParam, DCRTPoly>(1.304, 103.874, 1.290, 103.789,
+                                     getAffordableCandidates(makeCKKSCandidates(depth, HEStd_128_classic), costModel, timeLimit),
+                                     "CKKS", false, precision, 3);
+
+    cout << "MEASURING MULTIPLICATIVE DEPTH FOR BGVrns and BGV..." << endl;
+    // use 1 so that the result will always be less than the plaintext modulus; the noise budget still runs out,
+    // and the search stops at maxDepth levels for the sets on which it does not
+    size_t maxDepth = 32;
+    map<int, BGVrnsParam> bgvrnsSets = selectSets(BGVrnsParam::ParamSets, getAffordableSets(BGVrnsParam::ParamSets, costModel, timeLimit));
+    map<int, BGVParam> bgvSets = selectSets(BGVParam::ParamSets, getAffordableSets(BGVParam::ParamSets, costModel, timeLimit));
+    map<int, CKKSParam> ckksSets = selectSets(CKKSParam::ParamSets, getAffordableSets(CKKSParam::ParamSets, costModel, timeLimit));
+    runDepthMeasurement<BGVrnsParam, DCRTPoly>(1, bgvrnsSets, "BGVrns", maxDepth);
+    runDepthMeasurement<BGVParam, Poly>(1, bgvSets, "BGV", maxDepth);
+    // CKKS results are approximate, so its sets are characterized by their precision at every level instead
+    cout << "RUNNING PRECISION CHECK FOR CKKS..." << endl;
+    double minPrecisionBits = 10;
+    runPrecisionCheckCKKS(ckksSets, minPrecisionBits, maxDepth);
+
+    cout << "RUNNING PHASE-RESOLVED BENCHMARKS ON THE MINIMAL PARAMETER SETS..." << endl;
+    BenchmarkHarness harness(2, 20); // 2 warmup iterations, 20 recorded ones
+    int bgvrnsKey = bgvrnsSelector.select(BGVrnsParam::ParamSets, DistanceSquaredExpression::depth());
+    printHeader("BGVrns", to_string(bgvrnsKey));
+    benchmarkDistComp<BGVrnsParam, DCRTPoly, int64_t>(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord,
+                                                      BGVrnsParam::ParamSets.at(bgvrnsKey), true, harness);
+    int ckksKey = ckksSelector.select(CKKSParam::ParamSets, DistanceSquaredExpression::depth());
+    printHeader("CKKS", to_string(ckksKey));
+    benchmarkDistComp<CKKSParam, DCRTPoly, complex<double>>(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble,
+                                                            CKKSParam::ParamSets.at(ckksKey), false, harness);
+
+    cout << "PROFILING LIBRARY OPERATIONS ON THE MINIMAL PARAMETER SETS..." << endl;
+    printHeader("BGVrns", to_string(bgvrnsKey));
+    profileDistComp(stadiumXCoord, stadiumYCoord, dsoXCoord, dsoYCoord, BGVrnsParam::ParamSets.at(bgvrnsKey), &bgvrnsParamsRunner, sampleNum);
+    printHeader("CKKS", to_string(ckksKey));
+    profileDistComp<CKKSParam, DCRTPoly, complex<double>>(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble,
+                                                          CKKSParam::ParamSets.at(ckksKey), &ckksParamsRunner, sampleNum);
 
     return 0;
 }
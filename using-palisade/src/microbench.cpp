@@ -0,0 +1,274 @@
+#include "params.h"
+#include "benchmarkharness.h"
+#include "serialization.h"
+#include "circuitexecutor.h"
+#include "distancecircuit.h"
+#include "header.h"
+#include "palisadebackend.h"
+#include <sstream>
+
+using namespace std;
+using namespace lbcrypto;
+
+/** Benchmarks every primitive the distance computation uses on every parameter set, one primitive at a time,
+ *  so that a slowdown of runDistComp can be traced to the primitive responsible for it.
+ *
+ *  Every iteration times each primitive once on the same inputs: two fresh ciphertexts, and their product for
+ *  relinearize and rescale. Key generation is done once per parameter set and is not benchmarked here.
+ */
+
+template<class Element>
+Plaintext encode(const CryptoContext<Element>& cc, complex<double> value) {
+    return cc->MakeCKKSPackedPlaintext(vector<complex<double>>{value});
+}
+
+template<class Element>
+Plaintext encode(const CryptoContext<Element>& cc, int64_t value) {
+    return cc->MakeCoefPackedPlaintext(vector<int64_t>{value});
+}
+
+/** Decodes a decrypted plaintext again; CKKS needs the depth and scaling factor of the ciphertext it came from */
+template<class Element>
+void decode(const CryptoContext<Element>& cc, const Ciphertext<Element>& ciphertext, const Plaintext& plaintext, complex<double>) {
+    auto cryptoParams = static_pointer_cast<LPCryptoParametersCKKS<Element>>(cc->GetCryptoParameters());
+    static_pointer_cast<CKKSPackedEncoding>(plaintext)->Decode(ciphertext->GetDepth(), ciphertext->GetScalingFactor(),
+                                                               cryptoParams->GetRescalingTechnique());
+}
+
+template<class Element>
+void decode(const CryptoContext<Element>& /*cc*/, const Ciphertext<Element>& /*ciphertext*/, const Plaintext& plaintext, int64_t) {
+    plaintext->Decode();
+}
+
+/** Returns the context that rescale is timed on: the context of the set itself, except for CKKS.
+ *  The CKKS sets use EXACTRESCALE, under which EvalMult rescales by itself and ModReduce does nothing,
+ *  so they time ModReduce on the same set with APPROXRESCALE instead.
+ */
+template<class ParamType, class Element>
+CryptoContext<Element> getRescalingContext(const ParamType&, const CryptoContext<Element>& cc) {
+    return cc;
+}
+
+CryptoContext<DCRTPoly> getRescalingContext(const CKKSParam& value, const CryptoContext<DCRTPoly>&) {
+    return value.withRescalingTechnique(APPROXRESCALE).generateCryptoContext();
+}
+
+/** Times `operation` as `primitive` unless it has failed before; a failure is kept in `failures`
+ *  instead of being thrown, so that the other primitives of the set are still timed
+ */
+void timePrimitive(PhaseTimer& timer, const string& primitive, map<string, string>& failures, const function<void()>& operation) {
+    if (failures.find(primitive) != failures.end()) {
+        return;
+    }
+    try {
+        timer.time(primitive, operation);
+    } catch (const exception& e) {
+        failures[primitive] = e.what();
+    }
+}
+
+/** @brief Benchmarks each primitive on one parameter set and prints the median, p90 and p99 of every primitive, in µs.
+ *
+ *  PALISADE decodes as part of Decrypt, so decrypt includes decoding, and decode times decoding the result again.
+ *  PALISADE has no squaring of its own, so square is EvalMult of a ciphertext by itself; multiply and square are
+ *  not relinearized. Relinearize, rescale (ModReduce) and rotate (EvalAtIndex) are only implemented by the DCRTPoly
+ *  schemes (BGVrns and CKKS), so they are left out for BGV. CKKS rescales a product on a context that rescales
+ *  explicitly (see getRescalingContext).
+ */
+template<class ParamType, class Element, typename T>
+void benchmarkPrimitives(T x, T y, ParamType value, const BenchmarkHarness& harness) {
+    bool isRNS = is_same<Element, DCRTPoly>::value;
+    CryptoContext<Element> cc = value.generateCryptoContext();
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    cc->Enable(LEVELEDSHE);
+    LPKeyPair<Element> keyPair = cc->KeyGen();
+    cc->EvalMultKeyGen(keyPair.secretKey);
+    if (isRNS) {
+        cc->EvalAtIndexKeyGen(keyPair.secretKey, {1});
+    }
+
+    Ciphertext<Element> xCiphertext = cc->Encrypt(keyPair.publicKey, encode(cc, x));
+    Ciphertext<Element> yCiphertext = cc->Encrypt(keyPair.publicKey, encode(cc, y));
+    Ciphertext<Element> product = cc->EvalMultNoRelin(xCiphertext, yCiphertext);
+    Ciphertext<Element> relinearized = isRNS ? cc->Relinearize(product) : cc->EvalMult(xCiphertext, yCiphertext);
+
+    CryptoContext<Element> rescalingCC = cc;
+    Ciphertext<Element> unrescaled = relinearized;
+    if (isRNS) {
+        rescalingCC = getRescalingContext(value, cc);
+    }
+    if (rescalingCC != cc) {
+        rescalingCC->Enable(ENCRYPTION);
+        rescalingCC->Enable(SHE);
+        rescalingCC->Enable(LEVELEDSHE);
+        LPKeyPair<Element> rescalingKeyPair = rescalingCC->KeyGen();
+        rescalingCC->EvalMultKeyGen(rescalingKeyPair.secretKey);
+        unrescaled = rescalingCC->EvalMult(rescalingCC->Encrypt(rescalingKeyPair.publicKey, encode(rescalingCC, x)),
+                                           rescalingCC->Encrypt(rescalingKeyPair.publicKey, encode(rescalingCC, y)));
+    }
+
+    map<string, string> failures;
+    vector<PhaseStats> stats = harness.run([&](PhaseTimer& timer) {
+        Plaintext plaintext;
+        timePrimitive(timer, "encode", failures, [&]() {
+            plaintext = encode(cc, x);
+        });
+        Ciphertext<Element> result;
+        timePrimitive(timer, "encrypt", failures, [&]() {
+            result = cc->Encrypt(keyPair.publicKey, plaintext);
+        });
+        timePrimitive(timer, "add", failures, [&]() {
+            result = cc->EvalAdd(xCiphertext, yCiphertext);
+        });
+        timePrimitive(timer, "sub", failures, [&]() {
+            result = cc->EvalSub(xCiphertext, yCiphertext);
+        });
+        timePrimitive(timer, "multiply", failures, [&]() {
+            result = cc->EvalMultNoRelin(xCiphertext, yCiphertext);
+        });
+        timePrimitive(timer, "square", failures, [&]() {
+            result = cc->EvalMultNoRelin(xCiphertext, xCiphertext);
+        });
+        if (isRNS) {
+            timePrimitive(timer, "relinearize", failures, [&]() {
+                result = cc->Relinearize(product);
+            });
+            timePrimitive(timer, "rescale", failures, [&]() {
+                result = rescalingCC->ModReduce(unrescaled);
+            });
+            timePrimitive(timer, "rotate", failures, [&]() {
+                result = cc->EvalAtIndex(xCiphertext, 1);
+            });
+        }
+        Plaintext decrypted;
+        timePrimitive(timer, "decrypt", failures, [&]() {
+            cc->Decrypt(keyPair.secretKey, xCiphertext, &decrypted);
+        });
+        timePrimitive(timer, "decode", failures, [&]() {
+            decode(cc, xCiphertext, decrypted, x);
+        });
+        timePrimitive(timer, "serialize", failures, [&]() {
+            stringstream stream;
+            Serial::Serialize(xCiphertext, stream, SerType::BINARY);
+        });
+    });
+    BenchmarkHarness::printReport(stats, 1e3, "us");
+    for (const auto& failure : failures) {
+        cout << failure.first << " failed: " << failure.second << endl;
+    }
+
+    // The library keeps evaluation keys in global maps until they are cleared
+    CryptoContextImpl<Element>::ClearEvalMultKeys();
+    CryptoContextImpl<Element>::ClearEvalAutomorphismKeys();
+}
+
+/** Benchmarks the primitives on every parameter set of a scheme; a set that fails is reported and skipped */
+template<class ParamType, class Element, typename T>
+void benchmarkPrimitives(T x, T y, const map<int, ParamType>& paramSets, const string& schemeName, const BenchmarkHarness& harness) {
+    for (const auto& entry : paramSets) {
+        printHeader(schemeName, to_string(entry.first), "Benchmarking");
+        try {
+            benchmarkPrimitives<ParamType, Element, T>(x, y, entry.second, harness);
+        } catch (const exception& e) {
+            cout << "Failed: " << e.what() << "\n" << endl;
+        }
+    }
+}
+
+/** @brief Times summing the first `count` slots of a ciphertext, with independent EvalAtIndex rotations and with the
+ *  slot-sum circuit, whose rotations CircuitExecutor passes together to PalisadeBackend::rotateMany to be hoisted
+ *  (see Rotator), and prints how much faster the hoisted path is.
+ *
+ *  The executor runs on a single thread, so that the difference comes from hoisting alone. Only the DCRTPoly
+ *  schemes (BGVrns and CKKS) implement rotations.
+ */
+template<class ParamType>
+void benchmarkSlotSum(double x, ParamType value, int count, const BenchmarkHarness& harness) {
+    CryptoContext<DCRTPoly> cc = value.generateCryptoContext();
+    // The slot sum has no products, so neither relinearization nor rescaling is involved
+    PalisadeBackend<DCRTPoly> backend(cc, false, false);
+    backend.generateKeys();
+    backend.generateRotationKeys(count);
+    CircuitExecutor<PalisadeBackend<DCRTPoly>> executor(&backend, 1);
+    Circuit circuit = executor.compile(buildSlotSumCircuit(count));
+    Ciphertext<DCRTPoly> xCiphertext = backend.encrypt(x);
+    vector<int> indices;
+    for (int i = 1; i < count; i++) {
+        indices.push_back(i);
+    }
+
+    map<string, string> failures;
+    vector<PhaseStats> stats = harness.run([&](PhaseTimer& timer) {
+        vector<Ciphertext<DCRTPoly>> rotated;
+        timePrimitive(timer, "rotations", failures, [&]() {
+            rotated.clear();
+            for (int index : indices) {
+                rotated.push_back(cc->EvalAtIndex(xCiphertext, index));
+            }
+        });
+        timePrimitive(timer, "rotations (hoisted)", failures, [&]() {
+            rotated = backend.rotateMany(xCiphertext, indices);
+        });
+        Ciphertext<DCRTPoly> sum;
+        timePrimitive(timer, "slot sum", failures, [&]() {
+            vector<Ciphertext<DCRTPoly>> terms{xCiphertext};
+            for (int index : indices) {
+                terms.push_back(cc->EvalAtIndex(xCiphertext, index));
+            }
+            sum = cc->EvalAddManyInPlace(terms);
+        });
+        timePrimitive(timer, "slot sum (hoisted)", failures, [&]() {
+            sum = executor.execute(circuit, {xCiphertext})[0];
+        });
+    });
+    cout << "Summing " << count << " slots (" << indices.size() << " rotations)" << endl;
+    BenchmarkHarness::printReport(stats, 1e3, "us");
+    for (const auto& failure : failures) {
+        cout << failure.first << " failed: " << failure.second << endl;
+    }
+    if (failures.empty()) {
+        cout << "Hoisting speedup: " << stats[0].median / stats[1].median << "x for the rotations, "
+             << stats[2].median / stats[3].median << "x for the slot sum\n" << endl;
+    }
+
+    CryptoContextImpl<DCRTPoly>::ClearEvalMultKeys();
+    CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys();
+}
+
+/** Benchmarks the slot sum on every parameter set of a DCRTPoly scheme; a set that fails is reported and skipped */
+template<class ParamType>
+void benchmarkSlotSum(double x, const map<int, ParamType>& paramSets, const string& schemeName, int count, const BenchmarkHarness& harness) {
+    for (const auto& entry : paramSets) {
+        printHeader(schemeName, to_string(entry.first), "Benchmarking");
+        try {
+            benchmarkSlotSum<ParamType>(x, entry.second, count, harness);
+        } catch (const exception& e) {
+            cout << "Failed: " << e.what() << "\n" << endl;
+        }
+    }
+}
+
+/** Runs with [iterations] [warmup iterations], 50 and 5 by default, so that runs are comparable */
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? stoi(argv[1]) : 50;
+    int warmupIterations = argc > 2 ? stoi(argv[2]) : 5;
+    BenchmarkHarness harness(warmupIterations, iterations);
+    cout << "Benchmarking every primitive " << iterations << " times after " << warmupIterations << " warmup iterations\n" << endl;
+
+    // The coordinates of the national stadium, as in the distance computation
+    int64_t xCoord = 1304;
+    int64_t yCoord = 103874;
+    complex<double> xCoordDouble = 1.304;
+    complex<double> yCoordDouble = 103.874;
+
+    benchmarkPrimitives<BGVrnsParam, DCRTPoly, int64_t>(xCoord, yCoord, BGVrnsParam::ParamSets, "BGVrns", harness);
+    benchmarkPrimitives<BGVParam, Poly, int64_t>(xCoord, yCoord, BGVParam::ParamSets, "BGV", harness);
+    benchmarkPrimitives<CKKSParam, DCRTPoly, complex<double>>(xCoordDouble, yCoordDouble, CKKSParam::ParamSets, "CKKS", harness);
+
+    // Rotate-and-sum over 8 slots, with and without hoisting
+    benchmarkSlotSum<BGVrnsParam>(xCoord, BGVrnsParam::ParamSets, "BGVrns", 8, harness);
+    benchmarkSlotSum<CKKSParam>(real(xCoordDouble), CKKSParam::ParamSets, "CKKS", 8, harness);
+
+    return 0;
+}
@@ -61,7 +61,7 @@ map<int, BGVParam> BGVParam::ParamSets = {
 
 map<int, CKKSParam> CKKSParam::ParamSets = {
 
-    // CKKSParam(multDepth, scaleFactorBits, n, [securityLevel], [batchSize], [rsTech])
+    // CKKSParam(multDepth, scaleFactorBits, n, [securityLevel], [batchSize], [rsTech], [ksTech])
     {1, CKKSParam(1, 10, 8192)},
     {2, CKKSParam(1, 20, 8192)},
     {3, CKKSParam(1, 30, 8192)},
@@ -0,0 +1,64 @@
+// levelplanner_test.cpp : Tests of LevelPlanner on a BGVrns context provisioned for deeper circuits than the distance.
+//
+
+#include "levelplanner.h"
+#include "params.h"
+#include "testing.h"
+
+namespace {
+
+size_t getTowers(const Ciphertext<DCRTPoly>& ciphertext) {
+    return ciphertext->GetElements()[0].GetNumOfElements();
+}
+
+}
+
+TEST(deepSetDropsTheTowersTheCircuitDoesNotUse) {
+    CryptoContext<DCRTPoly> cc = BGVrnsParam(PlaintextModulus(65537), 0, 4).generateCryptoContext();
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    cc->Enable(LEVELEDSHE);
+    LPKeyPair<DCRTPoly> keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+
+    int64_t x = 12;
+    Ciphertext<DCRTPoly> xCiphertext = cc->Encrypt(keys.publicKey, cc->MakePackedPlaintext(vector<int64_t>{x}));
+    CHECK(getTowers(xCiphertext) == 5);
+    // The result is reduced modulo the plaintext modulus, which the first tower holds whatever its magnitude
+    double maxMagnitude = 8.0 * x * x;
+    CHECK(LevelPlanner<DCRTPoly>::getLevelsToDrop(cc, xCiphertext, 1, maxMagnitude) == 3);
+    CHECK(LevelPlanner<DCRTPoly>::getLevelsToDrop(cc, xCiphertext, 4, maxMagnitude) == 0);
+
+    // A circuit of depth 1, such as the distance, keeps one tower to rescale into and the first one
+    Ciphertext<DCRTPoly> reduced = LevelPlanner<DCRTPoly>::reduceToPlannedLevel(cc, xCiphertext, 1, maxMagnitude, true);
+    CHECK(getTowers(reduced) == 2);
+    Ciphertext<DCRTPoly> square = cc->ComposedEvalMult(reduced, reduced);
+    CHECK(getTowers(square) == 1);
+
+    Plaintext plaintext;
+    cc->Decrypt(keys.secretKey, square, &plaintext);
+    plaintext->SetLength(1);
+    CHECK(plaintext->GetPackedValue()[0] == x * x);
+}
+
+TEST(largeResultsKeepTheTowersThatHoldThem) {
+    // CKKS fresh inputs are at the scale of 2^40: a result of 2^30 needs 71 bits after the rescale,
+    // more than the first tower of 60 bits, so a second tower stays
+    CryptoContext<DCRTPoly> cc = CKKSParam(4, 40, 0).generateCryptoContext();
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    LPKeyPair<DCRTPoly> keys = cc->KeyGen();
+    Ciphertext<DCRTPoly> xCiphertext = cc->Encrypt(keys.publicKey, cc->MakeCKKSPackedPlaintext(vector<complex<double>>{1.5}));
+    CHECK(LevelPlanner<DCRTPoly>::getLevelsToDrop(cc, xCiphertext, 1, 1) == 3);
+    CHECK(LevelPlanner<DCRTPoly>::getLevelsToDrop(cc, xCiphertext, 1, pow(2.0, 30)) == 2);
+}
+
+TEST(schemesWithoutLevelReduceKeepTheirTowers) {
+    CryptoContext<DCRTPoly> cc = CKKSParam(4, 40, 0).generateCryptoContext();
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    LPKeyPair<DCRTPoly> keys = cc->KeyGen();
+    Ciphertext<DCRTPoly> xCiphertext = cc->Encrypt(keys.publicKey, cc->MakeCKKSPackedPlaintext(vector<complex<double>>{1.5}));
+    Ciphertext<DCRTPoly> reduced = LevelPlanner<DCRTPoly>::reduceToPlannedLevel(cc, xCiphertext, 1, 1.5, false);
+    CHECK(getTowers(reduced) == getTowers(xCiphertext));
+}
@@ -0,0 +1,8 @@
+// main.cpp : Runs every test linked into the PALISADE test executable.
+//
+
+#include "testing.h"
+
+int main() {
+    return TestRegistry::runAllTests();
+}
@@ -0,0 +1,115 @@
+// polynomialevaluator_test.cpp : Tests of PolynomialEvaluator against plaintext evaluation, and of the depth it uses.
+//
+
+#include "params.h"
+#include "polynomialevaluator.h"
+#include "testing.h"
+
+namespace {
+
+/** A CKKS context of `multDepth` levels with keys for multiplication, whose ciphertexts record the levels they used */
+struct CKKSFixture {
+    CryptoContext<DCRTPoly> cc;
+    LPKeyPair<DCRTPoly> keys;
+
+    explicit CKKSFixture(int64_t multDepth) : cc(CKKSParam(multDepth, 40, 0).generateCryptoContext()) {
+        cc->Enable(ENCRYPTION);
+        cc->Enable(SHE);
+        cc->Enable(LEVELEDSHE);
+        keys = cc->KeyGen();
+        cc->EvalMultKeyGen(keys.secretKey);
+    }
+
+    Ciphertext<DCRTPoly> encrypt(double value) const {
+        return cc->Encrypt(keys.publicKey, cc->MakeCKKSPackedPlaintext(vector<complex<double>>{value}));
+    }
+
+    double decrypt(const Ciphertext<DCRTPoly>& ciphertext) const {
+        Plaintext plaintext;
+        cc->Decrypt(keys.secretKey, ciphertext, &plaintext);
+        plaintext->SetLength(1);
+        return real(plaintext->GetCKKSPackedValue()[0]);
+    }
+};
+
+/** Returns the levels a CKKS ciphertext has used: the towers rescaled away, plus one while a product awaits its rescale */
+usint getUsedDepth(const Ciphertext<DCRTPoly>& ciphertext) {
+    return static_cast<usint>(ciphertext->GetLevel() + ciphertext->GetDepth() - 1);
+}
+
+double evalPlaintextPolynomial(const vector<complex<double>>& coefficients, double x) {
+    double result = 0;
+    for (size_t i = coefficients.size(); i-- > 0;) {
+        result = result * x + real(coefficients[i]);
+    }
+    return result;
+}
+
+}
+
+TEST(powersMatchPlaintextAndUseLogarithmicDepth) {
+    CKKSFixture fixture(5);
+    double x = 1.05;
+    PolynomialEvaluator<DCRTPoly> evaluator(fixture.cc, fixture.encrypt(x));
+    vector<Ciphertext<DCRTPoly>> powers = evaluator.evalPowers(16);
+    CHECK(powers.size() == 16);
+    for (usint k = 1; k <= powers.size(); k++) {
+        CHECK_NEAR(fixture.decrypt(powers[k - 1]), pow(x, k), 1e-3);
+        CHECK(getUsedDepth(powers[k - 1]) <= PolynomialEvaluator<DCRTPoly>::getPowerDepth(k));
+    }
+    CHECK(PolynomialEvaluator<DCRTPoly>::getPowerDepth(16) == 4);
+    CHECK(PolynomialEvaluator<DCRTPoly>::getPowerDepth(17) == 5);
+}
+
+TEST(productIsABalancedTree) {
+    CKKSFixture fixture(4);
+    vector<Ciphertext<DCRTPoly>> factors;
+    double expected = 1;
+    for (size_t i = 0; i < 8; i++) {
+        double factor = 1 + 0.1 * i;
+        factors.push_back(fixture.encrypt(factor));
+        expected *= factor;
+    }
+    Ciphertext<DCRTPoly> product = PolynomialEvaluator<DCRTPoly>::evalProduct(fixture.cc, factors);
+    CHECK_NEAR(fixture.decrypt(product), expected, 1e-3);
+    CHECK(getUsedDepth(product) <= 3); // a chain of products would use 7 levels
+}
+
+TEST(polynomialMatchesPlaintextEvaluation) {
+    CKKSFixture fixture(6);
+    vector<complex<double>> coefficients = {0.5, -1.0, 0.25, 2.0, 0.0, -0.75, 0.125, 1.5, 0.0, 0.5, -0.25, 1.0, 0.75, 0.0, -0.5, 0.25};
+    double x = 0.9;
+    PolynomialEvaluator<DCRTPoly> evaluator(fixture.cc, fixture.encrypt(x));
+    Ciphertext<DCRTPoly> result = evaluator.evalPolynomial(coefficients);
+    CHECK_NEAR(fixture.decrypt(result), evalPlaintextPolynomial(coefficients, x), 1e-2);
+    // Degree 15: the powers and giant steps use log2(16) = 4 levels, and the plaintext coefficients one more
+    CHECK(getUsedDepth(result) <= PolynomialEvaluator<DCRTPoly>::getPowerDepth(coefficients.size()) + 1);
+}
+
+TEST(integerPolynomialMatchesPlaintextEvaluation) {
+    // BGV, whose single modulus the products wear down without levels, so only the value can be checked
+    PlaintextModulus p = 65537;
+    CryptoContext<Poly> cc = BGVParam(p, 2048, 400).generateCryptoContext();
+    cc->Enable(ENCRYPTION);
+    cc->Enable(SHE);
+    LPKeyPair<Poly> keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+
+    vector<int64_t> coefficients = {3, -2, 0, 5, 1, 0, 0, 2};
+    int64_t x = 3;
+    int64_t expected = 0;
+    for (size_t i = coefficients.size(); i-- > 0;) {
+        expected = expected * x + coefficients[i];
+    }
+    Ciphertext<Poly> xCiphertext = cc->Encrypt(keys.publicKey, cc->MakePackedPlaintext(vector<int64_t>{x}));
+    PolynomialEvaluator<Poly> evaluator(cc, xCiphertext);
+    Plaintext plaintext;
+    cc->Decrypt(keys.secretKey, evaluator.evalPolynomial(coefficients), &plaintext);
+    plaintext->SetLength(1);
+    CHECK(plaintext->GetPackedValue()[0] == expected);
+}
+
+TEST(maxDepthOfRNSContextsIsTheirTowersButOne) {
+    CKKSFixture fixture(3);
+    CHECK(PolynomialEvaluator<DCRTPoly>::getMaxDepth(fixture.cc) == 3);
+}
@@ -0,0 +1,64 @@
+// rotator_test.cpp : Tests of Rotator's hoisted rotations against EvalAtIndex and plaintext sums.
+//
+
+#include "params.h"
+#include "rotator.h"
+#include "testing.h"
+
+namespace {
+
+/** A single-level CKKS context holding 1..8 in its first slots, with the keys for rotations by 1 to 7 */
+struct RotationFixture {
+    CryptoContext<DCRTPoly> cc;
+    LPKeyPair<DCRTPoly> keys;
+    Ciphertext<DCRTPoly> source;
+
+    RotationFixture() : cc(CKKSParam(1, 40, 0).generateCryptoContext()) {
+        cc->Enable(ENCRYPTION);
+        cc->Enable(SHE);
+        cc->Enable(LEVELEDSHE);
+        keys = cc->KeyGen();
+        Rotator<DCRTPoly>::generateRotationKeys(cc, keys.secretKey, 8);
+        source = cc->Encrypt(keys.publicKey, cc->MakeCKKSPackedPlaintext(vector<complex<double>>{1, 2, 3, 4, 5, 6, 7, 8}));
+    }
+
+    ~RotationFixture() {
+        CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys();
+    }
+
+    vector<double> decrypt(const Ciphertext<DCRTPoly>& ciphertext, size_t slots) const {
+        Plaintext plaintext;
+        cc->Decrypt(keys.secretKey, ciphertext, &plaintext);
+        plaintext->SetLength(slots);
+        vector<double> values;
+        for (const complex<double>& value : plaintext->GetCKKSPackedValue()) {
+            values.push_back(real(value));
+        }
+        return values;
+    }
+};
+
+}
+
+TEST(hoistedRotationsMatchEvalAtIndex) {
+    RotationFixture fixture;
+    Rotator<DCRTPoly> rotator(fixture.cc, fixture.source);
+    vector<usint> indices{1, 3, 7};
+    vector<Ciphertext<DCRTPoly>> rotated = rotator.rotate(indices);
+    CHECK(rotated.size() == indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        vector<double> hoisted = fixture.decrypt(rotated[i], 4);
+        vector<double> expected = fixture.decrypt(fixture.cc->EvalAtIndex(fixture.source, indices[i]), 4);
+        for (size_t slot = 0; slot < hoisted.size(); slot++) {
+            CHECK_NEAR(hoisted[slot], expected[slot], 1e-3);
+        }
+        CHECK_NEAR(hoisted[0], indices[i] + 1, 1e-3);
+    }
+}
+
+TEST(sumRotationsAddsTheFirstSlots) {
+    RotationFixture fixture;
+    Rotator<DCRTPoly> rotator(fixture.cc, fixture.source);
+    CHECK_NEAR(fixture.decrypt(rotator.sumRotations(8), 1)[0], 36, 1e-3);
+    CHECK_NEAR(fixture.decrypt(rotator.sumRotations(3), 1)[0], 6, 1e-3);
+}
@@ -0,0 +1,111 @@
+// squareddifferencesum_test.cpp : Tests of the fused SquaredDifferenceSum against the library operations it replaces.
+//
+
+#include "params.h"
+#include "squareddifferencesum.h"
+#include "testing.h"
+
+namespace {
+
+/** A context with keys for multiplication, holding the coordinates of the distance workload */
+struct DistanceFixture {
+    CryptoContext<DCRTPoly> cc;
+    LPKeyPair<DCRTPoly> keys;
+    vector<Ciphertext<DCRTPoly>> a; // x1, y1
+    vector<Ciphertext<DCRTPoly>> b; // x2, y2
+
+    DistanceFixture(const CryptoContext<DCRTPoly>& context, bool approximate) : cc(context) {
+        cc->Enable(ENCRYPTION);
+        cc->Enable(SHE);
+        cc->Enable(LEVELEDSHE);
+        keys = cc->KeyGen();
+        cc->EvalMultKeyGen(keys.secretKey);
+        vector<vector<int64_t>> coordinates{{1, -2, 30, 4}, {5, 6, -7, 80}, {9, 10, 11, -12}, {-13, 14, 15, 16}};
+        for (size_t i = 0; i < coordinates.size(); i++) {
+            Plaintext plaintext = approximate ? cc->MakeCKKSPackedPlaintext(toComplex(coordinates[i]))
+                : cc->MakePackedPlaintext(coordinates[i]);
+            (i < 2 ? a : b).push_back(cc->Encrypt(keys.publicKey, plaintext));
+        }
+    }
+
+    /** Returns sum_i (a_i - b_i)^2 evaluated with one library operation at a time, relinearizing every product */
+    Ciphertext<DCRTPoly> evaluateUnfused() const {
+        Ciphertext<DCRTPoly> sum;
+        for (size_t i = 0; i < a.size(); i++) {
+            auto diff = cc->EvalSub(a[i], b[i]);
+            auto square = cc->EvalMult(diff, diff);
+            sum = sum ? cc->EvalAdd(sum, square) : square;
+        }
+        return sum;
+    }
+
+    vector<double> decrypt(const Ciphertext<DCRTPoly>& ciphertext, bool approximate) const {
+        Plaintext plaintext;
+        cc->Decrypt(keys.secretKey, ciphertext, &plaintext);
+        plaintext->SetLength(4);
+        vector<double> values;
+        if (approximate) {
+            for (const complex<double>& value : plaintext->GetCKKSPackedValue()) {
+                values.push_back(real(value));
+            }
+        } else {
+            for (int64_t value : plaintext->GetPackedValue()) {
+                values.push_back(static_cast<double>(value));
+            }
+        }
+        return values;
+    }
+
+    static vector<complex<double>> toComplex(const vector<int64_t>& values) {
+        return vector<complex<double>>(values.begin(), values.end());
+    }
+};
+
+/** Checks that the inputs are fused into one relinearized ciphertext that decrypts to what the library operations give */
+void checkFusedMatchesUnfused(const CryptoContext<DCRTPoly>& cc, bool approximate, double tolerance) {
+    DistanceFixture fixture(cc, approximate);
+    CHECK(SquaredDifferenceSum<DCRTPoly>::canFuse(fixture.a, fixture.b));
+    Ciphertext<DCRTPoly> fused = SquaredDifferenceSum<DCRTPoly>::evaluate(fixture.cc, fixture.a, fixture.b);
+    CHECK(fused->GetElements().size() == 2);
+
+    vector<double> actual = fixture.decrypt(fused, approximate);
+    vector<double> expected = fixture.decrypt(fixture.evaluateUnfused(), approximate);
+    vector<double> plain{(1 - 9) * (1 - 9) + (5 + 13) * (5 + 13), 12 * 12 + 8 * 8, 19 * 19 + 22 * 22, 16 * 16 + 64 * 64};
+    CHECK(actual.size() == plain.size());
+    for (size_t i = 0; i < actual.size() && i < plain.size(); i++) {
+        CHECK_NEAR(actual[i], expected[i], tolerance);
+        CHECK_NEAR(actual[i], plain[i], tolerance);
+    }
+}
+
+}
+
+TEST(fusedSumMatchesUnfusedBGVrns) {
+    checkFusedMatchesUnfused(BGVrnsParam(PlaintextModulus(65537), 0, 1).generateCryptoContext(), false, 0);
+}
+
+TEST(fusedSumMatchesUnfusedCKKS) {
+    checkFusedMatchesUnfused(CKKSParam(1, 40, 0).generateCryptoContext(), true, 1e-3);
+}
+
+TEST(inputsAtDifferentDepthsFallBackToTheLibrary) {
+    DistanceFixture fixture(CKKSParam(2, 40, 0).generateCryptoContext(), true);
+    // A product awaits its rescale at depth 2, while the fresh inputs are at depth 1
+    Ciphertext<DCRTPoly> one = fixture.cc->Encrypt(fixture.keys.publicKey, fixture.cc->MakeCKKSPackedPlaintext(vector<complex<double>>(4, 1)));
+    fixture.a[0] = fixture.cc->EvalMult(fixture.a[0], one);
+    fixture.b[0] = fixture.cc->EvalMult(fixture.b[0], one);
+    CHECK(!SquaredDifferenceSum<DCRTPoly>::canFuse(fixture.a, fixture.b));
+
+    Ciphertext<DCRTPoly> sum = SquaredDifferenceSum<DCRTPoly>::evaluate(fixture.cc, fixture.a, fixture.b);
+    vector<double> actual = fixture.decrypt(sum, true);
+    vector<double> expected = fixture.decrypt(fixture.evaluateUnfused(), true);
+    for (size_t i = 0; i < actual.size(); i++) {
+        CHECK_NEAR(actual[i], expected[i], 1e-2);
+    }
+}
+
+TEST(mismatchedInputsCannotBeFused) {
+    DistanceFixture fixture(CKKSParam(1, 40, 0).generateCryptoContext(), true);
+    CHECK(!SquaredDifferenceSum<DCRTPoly>::canFuse({}, {}));
+    CHECK(!SquaredDifferenceSum<DCRTPoly>::canFuse(fixture.a, {fixture.b[0]}));
+}
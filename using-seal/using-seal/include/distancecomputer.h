@@ -4,21 +4,38 @@
 #include <vector>
 #include <seal/seal.h>
 #include <examples.h>
+#include "circuitexecutor.h"
+#include "distancecircuit.h"
+#include "scalemanager.h"
+#include "sealbackend.h"
+#include "tracer.h"
 
 using namespace std;
 using namespace seal;
 
 /** @brief Represents a distance computer that
  * supports both homomorphic and non-homomorphic computations
+ *
+ * The step-by-step computation reuses scratch buffers of the computer across calls, so a computer
+ * must not be shared between threads: give every thread a computer of its own.
  */
 template <typename T, class EncoderType>
 class DistanceComputer {
 
 public:
-    DistanceComputer(Evaluator* evaluator, Decryptor* decryptor, EncoderType* encoder) 
-        : evaluator(evaluator), decryptor(decryptor), encoder(encoder) {};
+    /** Scales and levels of the step-by-step computation are kept in step by `scaleManager`.
+     *  If `relinKeys` is given, the sum of squares is relinearized once before it is returned
+     */
+    DistanceComputer(TimedEvaluator* evaluator, Decryptor* decryptor, EncoderType* encoder, ScaleManager* scaleManager,
+        RelinKeys* relinKeys = nullptr)
+        : evaluator(evaluator), decryptor(decryptor), encoder(encoder), scaleManager(scaleManager), relinKeys(relinKeys) {};
     virtual ~DistanceComputer() {};
 
+    /** Records a span for every stage of the homomorphic evaluations, and for every circuit node; nullptr disables it */
+    void setTracer(Tracer* tracer) {
+        this->tracer = tracer;
+    }
+
     vector<T> computeDistanceSquared(T x1, T y1, T x2, T y2) {
         cout << "Evaluating square of distance between (" << x1 << ", " << y1
             << ") and (" << x2 << ", " << y1 << ")" << endl;
@@ -32,77 +49,124 @@ public:
         return distanceSquaredVector;
     }
 
-    virtual Ciphertext computeDistanceSquared(Ciphertext x1, Ciphertext y1,
-        Ciphertext x2, Ciphertext y2);
+    virtual Ciphertext computeDistanceSquared(const Ciphertext& x1, const Ciphertext& y1,
+        const Ciphertext& x2, const Ciphertext& y2);
+
+    /** Writes the result into `destination` so that its buffer can be reused across calls */
+    virtual void computeDistanceSquared(const Ciphertext& x1, const Ciphertext& y1,
+        const Ciphertext& x2, const Ciphertext& y2, Ciphertext& destination);
+
+    /** Evaluates the distance circuit after common-subexpression elimination and lazy
+     *  relinearization/rescale placement, running the xDiff and yDiff branches concurrently
+     */
+    Ciphertext computeDistanceSquaredCircuit(const Ciphertext& x1, const Ciphertext& y1,
+        const Ciphertext& x2, const Ciphertext& y2, shared_ptr<SEALContext> context) {
+        cout << "Homomorphically evaluating square of distance with the optimized circuit..." << endl;
+        Tracer::Stages stages(tracer, "distance");
+        stages.begin("compile circuit");
+        SealBackend backend(context, evaluator, relinKeys);
+        CircuitExecutor<SealBackend> executor(&backend);
+        executor.setTracer(tracer);
+        Circuit circuit = executor.compile(buildDistanceSquaredCircuit());
+        stages.begin("execute circuit");
+        return executor.execute(circuit, { x1, y1, x2, y2 })[0];
+    }
 
 private:
-    Evaluator* evaluator;
+    TimedEvaluator* evaluator;
     Decryptor* decryptor;
     EncoderType* encoder;
+    ScaleManager* scaleManager;
+    RelinKeys* relinKeys;
+    Tracer* tracer = nullptr;
+
+    // Scratch buffers reused by every homomorphic evaluation of this computer
+    Ciphertext yDiff;
+    Plaintext decrypted;
 
     // To check intermediate computation steps
-    vector<T> decrypt(Ciphertext ciphertext);
+    vector<T> decrypt(const Ciphertext& ciphertext);
 };
 
 #endif // DISTANCECOMPUTER_H
 
 template <typename T, class EncoderType>
-Ciphertext DistanceComputer<T, EncoderType>::computeDistanceSquared(Ciphertext x1, Ciphertext y1, Ciphertext x2,
-    Ciphertext y2) {
+Ciphertext DistanceComputer<T, EncoderType>::computeDistanceSquared(const Ciphertext& x1, const Ciphertext& y1, const Ciphertext& x2,
+    const Ciphertext& y2) {
+    Ciphertext distSq;
+    computeDistanceSquared(x1, y1, x2, y2, distSq);
+    return distSq;
+}
+
+template <typename T, class EncoderType>
+void DistanceComputer<T, EncoderType>::computeDistanceSquared(const Ciphertext& x1, const Ciphertext& y1, const Ciphertext& x2,
+    const Ciphertext& y2, Ciphertext& destination) {
 
     cout << "Homomorphically evaluating square of distance..." << endl;
+    // Every stage runs up to the next one; the decryptions that check intermediate results are stages of their own
+    Tracer::Stages stages(tracer, "distance");
 
+    // xDiff and xDiffSq live in `destination`, yDiff and yDiffSq in the `yDiff` scratch buffer
+    stages.begin("xDiff");
     cout << "Computing xDiff..." << endl;
-    Ciphertext xDiff;
-    evaluator->sub(x1, x2, xDiff);
+    scaleManager->sub(x1, x2, destination);
 
-    cout << "Scale: " << log2(xDiff.scale()) << " bits" << endl;
+    cout << "Scale: " << log2(destination.scale()) << " bits" << endl;
     
-    vector<double> xDiffVector = decrypt(xDiff);
+    stages.begin("check xDiff");
+    vector<double> xDiffVector = decrypt(destination);
     cout << "Decrypted xDiff:";
     print_vector(xDiffVector, 1, 9);
 
+    stages.begin("yDiff");
     cout << "Computing yDiff..." << endl;
-    Ciphertext yDiff;
-    evaluator->sub(y1, y2, yDiff);
+    scaleManager->sub(y1, y2, yDiff);
 
     cout << "Scale: " << log2(yDiff.scale()) << " bits" << endl;
 
+    stages.begin("check yDiff");
     vector<double> yDiffVector = decrypt(yDiff);
     cout << "Decrypted yDiff: ";
     print_vector(yDiffVector, 1, 9);
 
+    // Each square is rescaled back to about the encoding scale as soon as it is computed
+    stages.begin("xDiffSq");
     cout << "Computing xDiffSq..." << endl;
-    Ciphertext xDiffSq;
-    evaluator->square(xDiff, xDiffSq);
+    scaleManager->square_inplace(destination);
 
-    cout << "Scale: " << log2(xDiffSq.scale()) << " bits" << endl;
+    cout << "Scale: " << log2(destination.scale()) << " bits" << endl;
 
-    vector<double> xDiffSqVector = decrypt(xDiffSq);
+    stages.begin("check xDiffSq");
+    vector<double> xDiffSqVector = decrypt(destination);
     cout << "xDiffSq: ";
     print_vector(xDiffSqVector, 1, 9);
 
+    stages.begin("yDiffSq");
     cout << "Computing yDiffSq..." << endl;
-    Ciphertext yDiffSq;
-    evaluator->square(yDiff, yDiffSq);
+    scaleManager->square_inplace(yDiff);
 
-    cout << "Scale: " << log2(yDiffSq.scale()) << " bits" << endl;
+    cout << "Scale: " << log2(yDiff.scale()) << " bits" << endl;
 
-    vector<double> yDiffSqVector = decrypt(yDiffSq);
+    stages.begin("check yDiffSq");
+    vector<double> yDiffSqVector = decrypt(yDiff);
     cout << "yDiffSq: ";
     print_vector(yDiffSqVector, 1, 9);
 
-    Ciphertext distSq;
-    evaluator->add(xDiffSq, yDiffSq, distSq);
+    // Both squares are still of size 3, so a single key switch on the sum replaces one per square
+    stages.begin("sum");
+    scaleManager->add_inplace(destination, yDiff);
 
-    cout << "Scale: " << log2(distSq.scale()) << " bits" << endl;
+    if (relinKeys != nullptr) {
+        stages.begin("relinearize");
+        cout << "Relinearizing distSq..." << endl;
+        evaluator->relinearize_inplace(destination, *relinKeys);
+    }
 
-    return distSq;
+    cout << "Scale: " << log2(destination.scale()) << " bits" << endl;
 }
 
 template <typename T, class EncoderType>
-vector<T> DistanceComputer<T, EncoderType>::decrypt(Ciphertext ciphertext) {
-    Plaintext decrypted;
+vector<T> DistanceComputer<T, EncoderType>::decrypt(const Ciphertext& ciphertext) {
     decryptor->decrypt(ciphertext, decrypted);
 
     vector<T> decryptedVector;
@@ -110,5 +174,3 @@ vector<T> DistanceComputer<T, EncoderType>::decrypt(Ciphertext ciphertext) {
 
     return decryptedVector;
 }
-
-
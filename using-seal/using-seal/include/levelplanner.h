@@ -0,0 +1,74 @@
+#ifndef LEVELPLANNER_H
+#define LEVELPLANNER_H
+
+#include <cmath>
+#include <seal/seal.h>
+#include "timedevaluator.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief Chooses the lowest level of the modulus chain that is still sufficient for a circuit,
+ * so that freshly encrypted inputs can be mod-switched down before any arithmetic and every
+ * operation works on fewer RNS limbs.
+ */
+class LevelPlanner {
+
+public:
+    /** Returns the parms_id of the lowest level that leaves `rescales` levels to rescale into, still has more than
+     *  `minBits` bits of modulus once those rescales are done, and more than `productBits` bits at the level itself,
+     *  where the first product is computed before it is rescaled (see getProductBits)
+     */
+    static parms_id_type planInputLevel(shared_ptr<SEALContext> context, size_t rescales, int minBits, int productBits) {
+        auto planned = context->first_context_data();
+        auto candidate = planned->next_context_data();
+        while (candidate && candidate->chain_index() >= rescales && getFinalBitCount(candidate, rescales) > minBits
+            && candidate->total_coeff_modulus_bit_count() > productBits) {
+            planned = candidate;
+            candidate = candidate->next_context_data();
+        }
+        return planned->parms_id();
+    }
+
+    /** Returns the parms_id of the lowest level, starting from `parmsId`, that still has more than `minBits` bits of modulus */
+    static parms_id_type planLowestLevel(shared_ptr<SEALContext> context, parms_id_type parmsId, int minBits) {
+        auto planned = context->get_context_data(parmsId);
+        auto candidate = planned->next_context_data();
+        while (candidate && candidate->total_coeff_modulus_bit_count() > minBits) {
+            planned = candidate;
+            candidate = candidate->next_context_data();
+        }
+        return planned->parms_id();
+    }
+
+    /** Returns the modulus bits a result needs: its scale, which is squared for every
+     *  multiplication that is not rescaled, and the bits of its largest magnitude
+     */
+    static int getRequiredBits(double scale, size_t depth, size_t rescales, double maxMagnitude) {
+        double scaleBits = log2(scale) * pow(2.0, static_cast<double>(depth - rescales));
+        return static_cast<int>(ceil(scaleBits + log2(maxMagnitude + 1))) + 1;
+    }
+
+    /** Returns the modulus bits the first product of a circuit needs at the input level: until it is rescaled,
+     *  it has the square of the scale, times its largest magnitude
+     */
+    static int getProductBits(double scale, size_t depth, double maxMagnitude) {
+        return depth > 0 ? getRequiredBits(scale, 1, 0, maxMagnitude) : 0;
+    }
+
+    static void modSwitchInputs(TimedEvaluator* evaluator, vector<Ciphertext*> inputs, parms_id_type parmsId) {
+        for (Ciphertext* input : inputs) {
+            evaluator->mod_switch_to_inplace(*input, parmsId);
+        }
+    }
+
+private:
+    static int getFinalBitCount(shared_ptr<const SEALContext::ContextData> contextData, size_t rescales) {
+        for (size_t i = 0; i < rescales; i++) {
+            contextData = contextData->next_context_data();
+        }
+        return contextData->total_coeff_modulus_bit_count();
+    }
+};
+
+#endif // LEVELPLANNER_H
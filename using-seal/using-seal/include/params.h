@@ -1,7 +1,9 @@
 #ifndef PARAMS_H
 #define PARAMS_H
 
+#include <numeric>
 #include <seal/seal.h>
+#include "costmodel.h"
 
 using namespace std;
 using namespace seal;
@@ -42,6 +44,23 @@ public:
         return scale;
     }
 
+    size_t getPolyModulusDegree() const {
+        return poly_modulus_degree;
+    }
+
+    /** Returns the number of rescales the chain supports: one per data prime after the first, the last prime being the special prime */
+    size_t getMaxDepth() const {
+        return coeff_modulus_size_chain.size() > 2 ? coeff_modulus_size_chain.size() - 2 : 0;
+    }
+
+    /** Returns the sizes that the cost model needs: the last prime of a longer chain is the special prime, and SEAL switches keys one prime at a time */
+    CostShape getCostShape() const {
+        size_t specialLimbs = coeff_modulus_size_chain.size() > 1 ? 1 : 0;
+        size_t limbs = coeff_modulus_size_chain.size() - specialLimbs;
+        double logQ = accumulate(coeff_modulus_size_chain.begin(), coeff_modulus_size_chain.end() - specialLimbs, 0.0);
+        return CostShape{ poly_modulus_degree, logQ, limbs, specialLimbs, specialLimbs > 0 ? limbs : 0 };
+    }
+
 private:
     size_t poly_modulus_degree; // order
     vector<int> coeff_modulus_size_chain; // chain of integers representing the sizes of prime numbers, whose products give the ciphertext modulus
@@ -2,6 +2,16 @@
 #define PARAMSRUNNER_H
 
 #include "distancecomputer.h"
+#include "levelplanner.h"
+#include "memorystats.h"
+#include "perfcounters.h"
+#include "precisionstats.h"
+#include "resultcompactor.h"
+#include "resultswriter.h"
+#include "scalemanager.h"
+#include "timedevaluator.h"
+#include "tracer.h"
+#include <chrono>
 #include <cmath>
 
 using namespace std;
@@ -16,14 +26,52 @@ public:
     ParamsRunner() {};
     ~ParamsRunner() {};
 
+    /** Evaluates the distance through the optimized circuit instead of the step-by-step computation */
+    void setUseCircuit(bool useCircuit) {
+        this->useCircuit = useCircuit;
+    }
+
+    /** Records the latency of every evaluator call of runDistComp into `opProfile` (see TimedEvaluator); nullptr disables it */
+    void setOpProfile(OpProfile* opProfile) {
+        this->opProfile = opProfile;
+    }
+
+    /** Counts hardware events over every phase of runDistComp with `perfCounters`; nullptr disables it */
+    void setPerfCounters(PerfCounters* perfCounters) {
+        this->perfCounters = perfCounters;
+    }
+
+    /** Records a span for runDistComp, each of its phases and the stages of the distance computation; nullptr disables it */
+    void setTracer(Tracer* tracer) {
+        this->tracer = tracer;
+    }
+
     void runDistComp(T x1, T y1, T x2, T y2, shared_ptr<SEALContext> context, T scale);
+    void runPrecisionCheck(shared_ptr<SEALContext> context, double scale, double minPrecisionBits, size_t maxDepth);
+
+    /** Returns the parameters, phase timings, sizes and correctness of the last runDistComp; the caller fills in
+     *  the scheme and parameter set
+     */
+    const RunRecord& getLastRun() const {
+        return lastRun;
+    }
 
 protected:
     void print_all_parameters(shared_ptr<SEALContext> context);
-    Plaintext encodePlaintext(vector<T> data, T scale, EncoderType* encoder);
-    Ciphertext encryptPlaintext(Plaintext plaintext, Encryptor* encryptor);
-    vector<T> decrypt(Ciphertext ciphertext, Decryptor* decryptor, EncoderType* encoder, string varName);
-    bool checkDecryption(vector<T> original, vector<T> decrypted, T epsilon = 0.000001);
+    void printMemory(const RunRecord& run);
+    Plaintext encodePlaintext(const vector<T>& data, T scale, EncoderType* encoder);
+    void encodePlaintext(const vector<T>& data, T scale, EncoderType* encoder, Plaintext& destination);
+    Ciphertext encryptPlaintext(const Plaintext& plaintext, Encryptor* encryptor);
+    void encryptPlaintext(const Plaintext& plaintext, Encryptor* encryptor, Ciphertext& destination);
+    vector<T> decrypt(const Ciphertext& ciphertext, Decryptor* decryptor, EncoderType* encoder, const string& varName);
+    bool checkDecryption(const vector<T>& original, const vector<T>& decrypted, T epsilon = 0.000001);
+
+private:
+    bool useCircuit = false;
+    OpProfile* opProfile = nullptr;
+    PerfCounters* perfCounters = nullptr;
+    Tracer* tracer = nullptr;
+    RunRecord lastRun;
 };
 
 #endif // PARAMSRUNNER_H
@@ -40,7 +88,7 @@ void ParamsRunner<T, EncoderType>::print_all_parameters(shared_ptr<SEALContext>
     auto coeff_modulus = context_data.parms().coeff_modulus();
 
     cout << "Modulus Chain: (";
-    for (int i = 0; i < coeff_modulus.size(); i++) {
+    for (size_t i = 0; i < coeff_modulus.size(); i++) {
         auto value = coeff_modulus[i].value();
         q *= value;
         cout << value;
@@ -55,22 +103,47 @@ void ParamsRunner<T, EncoderType>::print_all_parameters(shared_ptr<SEALContext>
     cout << "q = " << q.to_dec_string() << endl;
 }
 
+/** Prints the serialized and in-memory sizes of the keys and of a fresh ciphertext, the memory pool and the peak RSS of every phase */
+template <typename T, class EncoderType>
+void ParamsRunner<T, EncoderType>::printMemory(const RunRecord& run) {
+    cout << "Public key: " << run.publicKeySize << " bytes serialized, " << run.publicKeyMemory << " bytes in memory" << endl;
+    cout << "Secret key: " << run.secretKeySize << " bytes serialized, " << run.secretKeyMemory << " bytes in memory" << endl;
+    cout << "Relinearization keys: " << run.evalKeySize << " bytes serialized, " << run.evalKeyMemory << " bytes in memory" << endl;
+    cout << "Fresh ciphertext: " << run.ciphertextSize << " bytes serialized, " << run.ciphertextMemory << " bytes in memory" << endl;
+    cout << "Memory pool: " << run.poolAllocation << " bytes allocated" << endl;
+    cout << "Peak RSS per phase (MB):";
+    for (auto& phase : run.peakRSS) {
+        cout << " " << phase.first << " " << phase.second / (1024.0 * 1024.0) << ";";
+    }
+    cout << endl;
+}
+
 template <typename T, class EncoderType>
-Plaintext ParamsRunner<T, EncoderType>::encodePlaintext(vector<T> data, T scale, EncoderType* encoder) {
+Plaintext ParamsRunner<T, EncoderType>::encodePlaintext(const vector<T>& data, T scale, EncoderType* encoder) {
     Plaintext plaintext;
-    encoder->encode(data, scale, plaintext);
+    encodePlaintext(data, scale, encoder, plaintext);
     return plaintext;
 }
 
 template <typename T, class EncoderType>
-Ciphertext ParamsRunner<T, EncoderType>::encryptPlaintext(Plaintext plaintext, Encryptor* encryptor) {
+void ParamsRunner<T, EncoderType>::encodePlaintext(const vector<T>& data, T scale, EncoderType* encoder, Plaintext& destination) {
+    encoder->encode(data, scale, destination);
+}
+
+template <typename T, class EncoderType>
+Ciphertext ParamsRunner<T, EncoderType>::encryptPlaintext(const Plaintext& plaintext, Encryptor* encryptor) {
     Ciphertext ciphertext;
-    encryptor->encrypt(plaintext, ciphertext);
+    encryptPlaintext(plaintext, encryptor, ciphertext);
     return ciphertext;
 }
 
+template <typename T, class EncoderType>
+void ParamsRunner<T, EncoderType>::encryptPlaintext(const Plaintext& plaintext, Encryptor* encryptor, Ciphertext& destination) {
+    encryptor->encrypt(plaintext, destination);
+}
+
 template <typename T, class EncoderType> 
-vector<T> ParamsRunner<T, EncoderType>::decrypt(Ciphertext ciphertext, Decryptor* decryptor, EncoderType* encoder, string varName) {
+vector<T> ParamsRunner<T, EncoderType>::decrypt(const Ciphertext& ciphertext, Decryptor* decryptor, EncoderType* encoder, const string& varName) {
     Plaintext decrypted;
     decryptor->decrypt(ciphertext, decrypted);
 
@@ -84,7 +157,7 @@ vector<T> ParamsRunner<T, EncoderType>::decrypt(Ciphertext ciphertext, Decryptor
 }
 
 template <typename T, class EncoderType>
-bool ParamsRunner<T, EncoderType>::checkDecryption(vector<T> original, vector<T> decrypted, T epsilon) {
+bool ParamsRunner<T, EncoderType>::checkDecryption(const vector<T>& original, const vector<T>& decrypted, T epsilon) {
     // Compare only the first element
     bool isEqual = (abs(original[0] - decrypted[0]) < epsilon);
     if (!isEqual) {
@@ -100,6 +173,7 @@ bool ParamsRunner<T, EncoderType>::checkDecryption(vector<T> original, vector<T>
 
 template <typename T, class EncoderType>
 void ParamsRunner<T, EncoderType>::runDistComp(T x1, T y1, T x2, T y2, shared_ptr<SEALContext> context, T scale) {
+    Tracer::Span span(tracer, "runDistComp", "runner");
     print_all_parameters(context);
     
     vector<T> x1Coord = { x1 };
@@ -107,26 +181,65 @@ void ParamsRunner<T, EncoderType>::runDistComp(T x1, T y1, T x2, T y2, shared_pt
     vector<T> x2Coord = { x2 };
     vector<T> y2Coord = { y2 };
     
+    // (x1 - x2)^2 + (y1 - y2)^2 is at most 2 * (2 * max |coord|)^2
+    size_t depth = DistanceSquaredExpression::depth();
+    T maxCoord = max(max(abs(x1), abs(y1)), max(abs(x2), abs(y2)));
+
+    // A scale that is missing or out of bounds for the modulus is picked from the chain instead
+    if (!ScaleManager::isValidScale(context, scale)) {
+        scale = ScaleManager::chooseScale(context, depth, 8 * maxCoord * maxCoord);
+    }
+    cout << "scale: " << log2(scale) << " bits" << endl;
+
+    // Every phase is timed up to the next one, including its progress output, and its peak RSS is
+    // taken from a high-water mark reset at its start (see MemoryStats), as are its hardware counters
+    lastRun = RunRecord();
+    lastRun.library = "SEAL";
+    MemoryStats::resetPeakRSS();
+    if (perfCounters != nullptr) {
+        perfCounters->start();
+    }
+    auto phaseStart = chrono::steady_clock::now();
+    auto endPhase = [this, &phaseStart](const string& phase) {
+        auto now = chrono::steady_clock::now();
+        lastRun.phases.push_back({ phase, chrono::duration<double, milli>(now - phaseStart).count() });
+        if (tracer != nullptr) {
+            tracer->addSpan(phase, "phase", phaseStart, now);
+        }
+        if (perfCounters != nullptr) {
+            lastRun.counters.push_back({ phase, perfCounters->stop() });
+        }
+        lastRun.peakRSS.push_back({ phase, MemoryStats::getPeakRSS() });
+        MemoryStats::resetPeakRSS();
+        if (perfCounters != nullptr) {
+            perfCounters->start();
+        }
+        phaseStart = chrono::steady_clock::now();
+    };
+
     // Encode coordinates into plaintexts
     cout << "Encoding coordinates into plaintexts..." << endl;
-    auto context_data_ptr = context->get_context_data(context->first_parms_id());
-    auto& context_data = *context_data_ptr;
-    cout << "scale: " << static_cast<int>(log2(scale)) + 1 << endl;
-    cout << "total bit count: " << context_data.total_coeff_modulus_bit_count() << endl;
-    cout << "this: " << (static_cast<int>(log2(scale)) + 1 >= context_data.total_coeff_modulus_bit_count()) << endl;
-    if (scale <= 0 || (static_cast<int>(log2(scale)) + 1 >= context_data.total_coeff_modulus_bit_count())) {
-        cout << "here" << endl;
-    }
     EncoderType encoder(context);
     Plaintext x1Plaintext = encodePlaintext(x1Coord, scale, &encoder);
     Plaintext y1Plaintext = encodePlaintext(y1Coord, scale, &encoder);
     Plaintext x2Plaintext = encodePlaintext(x2Coord, scale, &encoder);
     Plaintext y2Plaintext = encodePlaintext(y2Coord, scale, &encoder);
+    endPhase("encode");
 
     cout << "Running key generation..." << endl;
     KeyGenerator keygen(context);
     auto public_key = keygen.public_key();
     auto secret_key = keygen.secret_key();
+    endPhase("key generation");
+
+    // Relinearization keys are generated once per context, and only if the distance expression multiplies;
+    // single-prime chains do not support key switching
+    RelinKeys relin_keys;
+    bool usingKeySwitching = context->using_keyswitching() && DistanceSquaredExpression::depth() > 0;
+    if (usingKeySwitching) {
+        relin_keys = keygen.relin_keys_local();
+    }
+    endPhase("eval key generation");
 
     cout << "Encrypting plaintexts..." << endl;
     Encryptor encryptor(context, public_key);
@@ -134,6 +247,8 @@ void ParamsRunner<T, EncoderType>::runDistComp(T x1, T y1, T x2, T y2, shared_pt
     Ciphertext y1Ciphertext = encryptPlaintext(y1Plaintext, &encryptor);
     Ciphertext x2Ciphertext = encryptPlaintext(x2Plaintext, &encryptor);
     Ciphertext y2Ciphertext = encryptPlaintext(y2Plaintext, &encryptor);
+    endPhase("encrypt");
+    Ciphertext freshCiphertext = x1Ciphertext; // measured once the run is over
 
     cout << "Decrypting ciphertexts..." << endl;
     Decryptor decryptor(context, secret_key);
@@ -141,16 +256,149 @@ void ParamsRunner<T, EncoderType>::runDistComp(T x1, T y1, T x2, T y2, shared_pt
     decrypt(y1Ciphertext, &decryptor, &encoder, "y1");
     decrypt(x2Ciphertext, &decryptor, &encoder, "x2");
     decrypt(y2Ciphertext, &decryptor, &encoder, "y2");
+    endPhase("input check");
 
-    Evaluator evaluator(context);
-    DistanceComputer<T, EncoderType> distanceComputer(&evaluator, &decryptor, &encoder);
+    TimedEvaluator evaluator(context, opProfile);
+
+    // Mod-switch the inputs down to the lowest level that still fits the distance circuit before any arithmetic;
+    // the circuit path rescales whenever the chain has a level to rescale into, the step-by-step path
+    // whenever the scale manager can do so without dropping below the encoding scale
+    ScaleManager scaleManager(context, &evaluator, scale);
+    size_t rescales = useCircuit ? (context->first_context_data()->next_context_data() ? depth : 0)
+        : ScaleManager::getPlannedRescales(context, scale, depth);
+    double maxMagnitude = 8 * maxCoord * maxCoord;
+    int minBits = LevelPlanner::getRequiredBits(scale, depth, rescales, maxMagnitude);
+    int productBits = LevelPlanner::getProductBits(scale, depth, maxMagnitude);
+    parms_id_type inputParmsId = LevelPlanner::planInputLevel(context, rescales, minBits, productBits);
+    LevelPlanner::modSwitchInputs(&evaluator, { &x1Ciphertext, &y1Ciphertext, &x2Ciphertext, &y2Ciphertext }, inputParmsId);
+    cout << "Inputs mod-switched to chain index " << context->get_context_data(inputParmsId)->chain_index() << endl;
+    endPhase("level reduction");
+
+    DistanceComputer<T, EncoderType> distanceComputer(&evaluator, &decryptor, &encoder, &scaleManager, usingKeySwitching ? &relin_keys : nullptr);
+    distanceComputer.setTracer(tracer);
 
     // Compute square of distance
     vector<T> distSq = distanceComputer.computeDistanceSquared(x1, y1, x2, y2);
     print_vector(distSq, 1, 9);
 
     // Homomorphically compute square of distance
-    Ciphertext distSqCiphertext = distanceComputer.computeDistanceSquared(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext);
+    Ciphertext distSqCiphertext;
+    if (useCircuit) {
+        distSqCiphertext = distanceComputer.computeDistanceSquaredCircuit(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext, context);
+    }
+    else {
+        distanceComputer.computeDistanceSquared(x1Ciphertext, y1Ciphertext, x2Ciphertext, y2Ciphertext, distSqCiphertext);
+    }
+
+    endPhase("evaluate");
+
+    // Shrink the result before it would be sent back
+    streamoff fullSize = distSqCiphertext.save_size();
+    ResultCompactor compactor(context, &evaluator, usingKeySwitching ? &relin_keys : nullptr);
+    compactor.compact(distSqCiphertext, scale, 8 * maxCoord * maxCoord);
+    cout << "Result ciphertext size: " << fullSize << " bytes, " << distSqCiphertext.save_size() << " bytes after compaction at chain index "
+        << context->get_context_data(distSqCiphertext.parms_id())->chain_index() << endl;
+    endPhase("compaction");
+    lastRun.resultSize = static_cast<size_t>(fullSize);
+    lastRun.compactedResultSize = static_cast<size_t>(distSqCiphertext.save_size());
+
     vector<T> decrypted = decrypt(distSqCiphertext, &decryptor, &encoder, "Distance Squared");
-    checkDecryption(distSq, decrypted);
- }
\ No newline at end of file
+    lastRun.correct = checkDecryption(distSq, decrypted);
+    endPhase("decrypt");
+
+    auto& parms = context->first_context_data()->parms();
+    lastRun.ringDimension = parms.poly_modulus_degree();
+    lastRun.logQ = context->first_context_data()->total_coeff_modulus_bit_count();
+    lastRun.plaintextModulus = 0;
+    lastRun.scale = scale;
+
+    // Sizes are measured after the last phase, so that serializing the keys does not count towards any of them.
+    // In memory, a key is made of polynomials over every prime of the key level: two for the public key, one for
+    // the secret key, and two for each of the primes but the special one in every relinearization key
+    size_t keyPolyMemory = context->key_context_data()->parms().coeff_modulus().size() * parms.poly_modulus_degree() * sizeof(uint64_t);
+    size_t decompositionCount = context->key_context_data()->parms().coeff_modulus().size() - 1;
+    lastRun.ciphertextSize = static_cast<size_t>(freshCiphertext.save_size());
+    lastRun.ciphertextMemory = freshCiphertext.size() * freshCiphertext.coeff_modulus_size() * freshCiphertext.poly_modulus_degree()
+        * sizeof(uint64_t);
+    lastRun.publicKeySize = static_cast<size_t>(public_key.save_size());
+    lastRun.publicKeyMemory = 2 * keyPolyMemory;
+    lastRun.secretKeySize = static_cast<size_t>(secret_key.save_size());
+    lastRun.secretKeyMemory = keyPolyMemory;
+    lastRun.evalKeySize = usingKeySwitching ? static_cast<size_t>(relin_keys.save_size()) : 0;
+    lastRun.evalKeyMemory = usingKeySwitching ? relin_keys.size() * decompositionCount * 2 * keyPolyMemory : 0;
+    lastRun.poolAllocation = MemoryManager::GetPool().alloc_byte_count();
+    printMemory(lastRun);
+    if (perfCounters != nullptr) {
+        perfCounters->stop();
+        PerfCounters::printReport(lastRun.counters);
+    }
+ }
+
+/** @brief Measures the precision of every slot after each level of squaring, from the fresh ciphertext
+ *  up to `maxDepth` levels or the levels of the modulus chain, whichever is fewer, stopping once it falls
+ *  under `minPrecisionBits`.
+ *
+ *  Every slot holds a point of the unit circle (see PrecisionStats), so the errors of all levels are comparable.
+ *  Every product is rescaled.
+ */
+template <typename T, class EncoderType>
+void ParamsRunner<T, EncoderType>::runPrecisionCheck(shared_ptr<SEALContext> context, double scale, double minPrecisionBits, size_t maxDepth) {
+    print_all_parameters(context);
+
+    if (!ScaleManager::isValidScale(context, scale)) {
+        scale = ScaleManager::chooseScale(context, 1, 1);
+    }
+    cout << "scale: " << log2(scale) << " bits" << endl;
+
+    cout << "Running key generation..." << endl;
+    KeyGenerator keygen(context);
+    RelinKeys relin_keys;
+    if (context->using_keyswitching()) {
+        relin_keys = keygen.relin_keys_local();
+    }
+    Encryptor encryptor(context, keygen.public_key());
+    Decryptor decryptor(context, keygen.secret_key());
+    Evaluator evaluator(context);
+    EncoderType encoder(context);
+
+    vector<complex<double>> expected = PrecisionStats::makeUnitCircleSlots(encoder.slot_count());
+    Plaintext plaintext;
+    encoder.encode(expected, scale, plaintext);
+    Ciphertext ciphertext;
+    encryptor.encrypt(plaintext, ciphertext);
+
+    // Every level rescales away a prime of the chain
+    maxDepth = min(maxDepth, context->first_context_data()->chain_index());
+    for (size_t depth = 0; depth <= maxDepth; depth++) {
+        vector<complex<double>> actual;
+        try {
+            if (depth > 0) {
+                evaluator.square_inplace(ciphertext);
+                if (context->using_keyswitching()) {
+                    evaluator.relinearize_inplace(ciphertext, relin_keys);
+                }
+                if (context->get_context_data(ciphertext.parms_id())->next_context_data()) {
+                    evaluator.rescale_to_next_inplace(ciphertext);
+                }
+                for (complex<double>& value : expected) {
+                    value *= value;
+                }
+            }
+            Plaintext decrypted;
+            decryptor.decrypt(ciphertext, decrypted);
+            encoder.decode(decrypted, actual);
+        }
+        catch (const exception& e) {
+            cout << "Level " << depth << ": could not be computed (" << e.what() << ")" << endl;
+            break;
+        }
+
+        PrecisionStats stats = PrecisionStats::compare(expected, actual);
+        cout << "Level " << depth << ": precision " << stats.getPrecisionBits() << " bits (max error " << stats.maxError
+            << "), mean " << stats.getMeanPrecisionBits() << " bits (mean error " << stats.meanError << ")" << endl;
+        if (stats.getPrecisionBits() < minPrecisionBits) {
+            cout << "Precision fell under " << minPrecisionBits << " bits" << endl;
+            break;
+        }
+    }
+}
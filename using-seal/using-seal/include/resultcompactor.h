@@ -0,0 +1,43 @@
+#ifndef RESULTCOMPACTOR_H
+#define RESULTCOMPACTOR_H
+
+#include <seal/seal.h>
+#include "levelplanner.h"
+#include "scalemanager.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief Shrinks a result ciphertext before it is serialized and sent back:
+ * it is relinearized down to size 2, rescaled while the scale stays above the
+ * encoding scale, and mod-switched to the lowest level that still holds it.
+ */
+class ResultCompactor {
+
+public:
+    /** Relinearization is skipped if `relinKeys` is null, as single-prime chains do not support key switching */
+    ResultCompactor(shared_ptr<SEALContext> context, TimedEvaluator* evaluator, RelinKeys* relinKeys = nullptr)
+        : context(context), evaluator(evaluator), relinKeys(relinKeys) {};
+    ~ResultCompactor() {};
+
+    /** `minScale` is the lowest scale rescaling may leave (0 disables rescaling) and
+     *  `maxMagnitude` bounds the absolute value of the result
+     */
+    void compact(Ciphertext& result, double minScale, double maxMagnitude) const {
+        if (result.size() > 2 && relinKeys != nullptr) {
+            evaluator->relinearize_inplace(result, *relinKeys);
+        }
+
+        ScaleManager(context, evaluator, minScale).rescaleToScale(result, minScale);
+
+        int minBits = LevelPlanner::getRequiredBits(result.scale(), 0, 0, maxMagnitude);
+        evaluator->mod_switch_to_inplace(result, LevelPlanner::planLowestLevel(context, result.parms_id(), minBits));
+    }
+
+private:
+    shared_ptr<SEALContext> context;
+    TimedEvaluator* evaluator;
+    RelinKeys* relinKeys;
+};
+
+#endif // RESULTCOMPACTOR_H
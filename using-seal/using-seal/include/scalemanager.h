@@ -0,0 +1,201 @@
+#ifndef SCALEMANAGER_H
+#define SCALEMANAGER_H
+
+#include <cmath>
+#include <stdexcept>
+#include <seal/seal.h>
+#include "timedevaluator.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief Keeps CKKS scales and levels in step so that callers never have to:
+ * products are rescaled as soon as they are computed, and the operands of an
+ * addition or subtraction are brought to a common level and scale first.
+ *
+ * A product is only rescaled if its scale stays above the encoding scale afterwards,
+ * so chains whose primes are larger than the scale keep working without rescaling.
+ * Relinearization is left to the caller, so that it can still be deferred.
+ */
+class ScaleManager {
+
+public:
+    ScaleManager(shared_ptr<SEALContext> context, TimedEvaluator* evaluator, double scale)
+        : context(context), evaluator(evaluator), scale(scale) {};
+    ~ScaleManager() {};
+
+    /** Picks the encoding scale from the modulus chain: the size of the primes that are rescaled
+     *  away if the chain has one for every multiplication and the first prime still holds the result,
+     *  otherwise the largest power of two whose square after each multiplication still fits the modulus
+     */
+    static double chooseScale(shared_ptr<SEALContext> context, size_t depth, double maxMagnitude) {
+        auto contextData = context->first_context_data();
+        const auto& primes = contextData->parms().coeff_modulus();
+        double magnitudeBits = log2(maxMagnitude + 1) + 1;
+
+        int primeBits = primes.back().bit_count();
+        if (depth > 0 && primes.size() > depth && primes[0].bit_count() > primeBits + magnitudeBits) {
+            return pow(2.0, primeBits);
+        }
+        double scaleBits = (contextData->total_coeff_modulus_bit_count() - magnitudeBits) / pow(2.0, static_cast<double>(depth));
+        return pow(2.0, floor(scaleBits));
+    }
+
+    /** Returns whether the scale is positive and leaves room in the modulus of the first level */
+    static bool isValidScale(shared_ptr<SEALContext> context, double scale) {
+        return scale > 0 && static_cast<int>(log2(scale)) + 1 < context->first_context_data()->total_coeff_modulus_bit_count();
+    }
+
+    /** Returns how many of the `depth` products of a circuit will be rescaled, starting from the first level */
+    static size_t getPlannedRescales(shared_ptr<SEALContext> context, double scale, size_t depth) {
+        auto contextData = context->first_context_data();
+        double currentScale = scale;
+        size_t rescales = 0;
+        for (size_t i = 0; i < depth; i++) {
+            currentScale *= currentScale;
+            if (contextData->next_context_data() && canRescale(contextData, currentScale, scale)) {
+                currentScale /= contextData->parms().coeff_modulus().back().value();
+                contextData = contextData->next_context_data();
+                rescales++;
+            }
+        }
+        return rescales;
+    }
+
+    void multiply(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination) const {
+        if (&a == &b) {
+            evaluator->square(a, destination);
+        }
+        else {
+            alignLevels(a, b, destination, [this](const Ciphertext& x, const Ciphertext& y, Ciphertext& result) {
+                evaluator->multiply(x, y, result);
+            });
+        }
+        rescale(destination);
+    }
+
+    void square_inplace(Ciphertext& ciphertext) const {
+        evaluator->square_inplace(ciphertext);
+        rescale(ciphertext);
+    }
+
+    void add(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination) const {
+        align(a, b, destination, [this](const Ciphertext& x, const Ciphertext& y, Ciphertext& result) {
+            evaluator->add(x, y, result);
+        });
+    }
+
+    void sub(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination) const {
+        align(a, b, destination, [this](const Ciphertext& x, const Ciphertext& y, Ciphertext& result) {
+            evaluator->sub(x, y, result);
+        });
+    }
+
+    void add_inplace(Ciphertext& destination, const Ciphertext& other) const {
+        Ciphertext sum;
+        add(destination, other, sum);
+        destination = move(sum);
+    }
+
+    /** Rescales while the scale stays above `minScale`; primes are only close to a power of two,
+     *  so the scale may end up to a bit below it
+     */
+    void rescaleToScale(Ciphertext& ciphertext, double minScale) const {
+        auto contextData = context->get_context_data(ciphertext.parms_id());
+        while (contextData->next_context_data() && canRescale(contextData, ciphertext.scale(), minScale)) {
+            evaluator->rescale_to_next_inplace(ciphertext);
+            contextData = contextData->next_context_data();
+        }
+    }
+
+    double getScale() const {
+        return scale;
+    }
+
+    /** Mod-switches a copy of the operand at the higher level down to the level of the other one */
+    template <class Operation>
+    void alignLevels(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination, Operation operation) const {
+        size_t aLevel = context->get_context_data(a.parms_id())->chain_index();
+        size_t bLevel = context->get_context_data(b.parms_id())->chain_index();
+        if (aLevel == bLevel) {
+            operation(a, b, destination);
+            return;
+        }
+        Ciphertext switched;
+        if (aLevel > bLevel) {
+            evaluator->mod_switch_to(a, b.parms_id(), switched);
+            operation(switched, b, destination);
+        }
+        else {
+            evaluator->mod_switch_to(b, a.parms_id(), switched);
+            operation(a, switched, destination);
+        }
+    }
+
+private:
+    shared_ptr<SEALContext> context;
+    TimedEvaluator* evaluator;
+    double scale;
+
+    // Relative difference below which two scales are taken to be the same
+    static constexpr double scaleTolerance = 1.0 / (1 << 20);
+
+    static bool canRescale(shared_ptr<const SEALContext::ContextData> contextData, double currentScale, double minScale) {
+        return minScale > 0 && currentScale / contextData->parms().coeff_modulus().back().value() > minScale / 2;
+    }
+
+    /** Rescales a fresh product once, if that keeps at least the encoding scale */
+    void rescale(Ciphertext& ciphertext) const {
+        auto contextData = context->get_context_data(ciphertext.parms_id());
+        if (contextData->next_context_data() && canRescale(contextData, ciphertext.scale(), scale)) {
+            evaluator->rescale_to_next_inplace(ciphertext);
+        }
+    }
+
+    /** Aligns scales, then levels. Scales that agree to `scaleTolerance` differ only by floating-point
+     *  error and are relabelled; otherwise the operand with more levels left is multiplied by 1 encoded at
+     *  the scale that its next rescale turns into the scale of the other one
+     */
+    template <class Operation>
+    void align(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination, Operation operation) const {
+        if (a.scale() == b.scale()) {
+            alignLevels(a, b, destination, operation);
+            return;
+        }
+        if (abs(a.scale() / b.scale() - 1) <= scaleTolerance) {
+            Ciphertext relabelled = b;
+            relabelled.scale() = a.scale();
+            alignLevels(a, relabelled, destination, operation);
+            return;
+        }
+        size_t aLevel = context->get_context_data(a.parms_id())->chain_index();
+        size_t bLevel = context->get_context_data(b.parms_id())->chain_index();
+        if (aLevel >= bLevel) {
+            Ciphertext corrected = a;
+            correctScale(corrected, b.scale());
+            alignLevels(corrected, b, destination, operation);
+        }
+        else {
+            Ciphertext corrected = b;
+            correctScale(corrected, a.scale());
+            alignLevels(a, corrected, destination, operation);
+        }
+    }
+
+    /** Brings the scale of a ciphertext to `targetScale` without changing its value, at the cost of a level */
+    void correctScale(Ciphertext& ciphertext, double targetScale) const {
+        auto contextData = context->get_context_data(ciphertext.parms_id());
+        if (!contextData->next_context_data()) {
+            throw invalid_argument("Scales of operands differ and no level is left to align them");
+        }
+        double plainScale = targetScale * contextData->parms().coeff_modulus().back().value() / ciphertext.scale();
+        CKKSEncoder encoder(context);
+        Plaintext one;
+        encoder.encode(1.0, ciphertext.parms_id(), plainScale, one);
+        evaluator->multiply_plain_inplace(ciphertext, one);
+        evaluator->rescale_to_next_inplace(ciphertext);
+        ciphertext.scale() = targetScale; // equal up to the rounding of the double arithmetic above
+    }
+};
+
+#endif // SCALEMANAGER_H
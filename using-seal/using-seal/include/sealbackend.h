@@ -0,0 +1,208 @@
+#ifndef SEALBACKEND_H
+#define SEALBACKEND_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <seal/seal.h>
+#include "levelplanner.h"
+#include "resultcompactor.h"
+#include "scalemanager.h"
+#include "timedevaluator.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief Runs circuits with SEAL's CKKS scheme, for use by CircuitExecutor and DistancePipeline.
+ *
+ * Products are only left unrelinearized if relinearization keys are available, and
+ * rescaling is only used if the modulus chain has a level to rescale into. Operands at
+ * different levels or scales, e.g. a fresh input and a rescaled product, are aligned by a ScaleManager.
+ * A backend built from an existing Evaluator can only evaluate; a backend built from
+ * a scale owns its keys and tools once `generateKeys` is called, and its Galois keys once
+ * `generateGaloisKeys` is.
+ */
+class SealBackend {
+
+public:
+    typedef Ciphertext CiphertextType;
+
+    SealBackend(shared_ptr<SEALContext> context, TimedEvaluator* evaluator, RelinKeys* relinKeys = nullptr, GaloisKeys* galoisKeys = nullptr)
+        : context(context), scale(0), evaluator(evaluator), relinKeys(relinKeys), galoisKeys(galoisKeys),
+          hasNextLevel(context->first_context_data()->next_context_data() != nullptr) {};
+
+    SealBackend(shared_ptr<SEALContext> context, double scale)
+        : context(context), scale(scale), evaluator(nullptr), relinKeys(nullptr), galoisKeys(nullptr),
+          hasNextLevel(context->first_context_data()->next_context_data() != nullptr) {};
+    ~SealBackend() {};
+
+    string getLibrary() const {
+        return "SEAL";
+    }
+
+    size_t getRingDimension() const {
+        return context->first_context_data()->parms().poly_modulus_degree();
+    }
+
+    bool isExact() const {
+        return false;
+    }
+
+    double getFixedPointScale() const {
+        return 1;
+    }
+
+    void generateKeys() {
+        keygen.reset(new KeyGenerator(context));
+        encryptor.reset(new Encryptor(context, keygen->public_key()));
+        decryptor.reset(new Decryptor(context, keygen->secret_key()));
+        encoder.reset(new CKKSEncoder(context));
+        ownedEvaluator.reset(new TimedEvaluator(context));
+        evaluator = ownedEvaluator.get();
+
+        // Single-prime chains do not support key switching
+        if (context->using_keyswitching()) {
+            ownedRelinKeys = keygen->relin_keys_local();
+            relinKeys = &ownedRelinKeys;
+        }
+    }
+
+    /** Generates the Galois keys for rotations by the given steps, which `rotate` needs unless keys were passed to the constructor */
+    void generateGaloisKeys(const vector<int>& rotations) {
+        if (!keygen) {
+            throw logic_error("generateKeys must be called before generateGaloisKeys");
+        }
+        if (!context->using_keyswitching()) {
+            throw logic_error("Rotations need key switching, which single-prime chains do not support");
+        }
+        ownedGaloisKeys = keygen->galois_keys_local(rotations);
+        galoisKeys = &ownedGaloisKeys;
+    }
+
+    CiphertextType encrypt(double value) const {
+        if (!encryptor) {
+            throw logic_error("generateKeys must be called before encrypt");
+        }
+        Plaintext plaintext;
+        encoder->encode(vector<double>{ value }, scale, plaintext);
+        CiphertextType ciphertext;
+        encryptor->encrypt(plaintext, ciphertext);
+        return ciphertext;
+    }
+
+    double decrypt(const CiphertextType& ciphertext) const {
+        if (!decryptor) {
+            throw logic_error("generateKeys must be called before decrypt");
+        }
+        Plaintext decrypted;
+        decryptor->decrypt(ciphertext, decrypted);
+        vector<double> decoded;
+        encoder->decode(decrypted, decoded);
+        return decoded[0];
+    }
+
+    /** Mod-switches the inputs to the lowest level that still fits a circuit of the given depth */
+    void prepareInputs(vector<CiphertextType>& inputs, size_t depth, double maxMagnitude) const {
+        size_t rescales = hasNextLevel ? depth : 0;
+        int minBits = LevelPlanner::getRequiredBits(scale, depth, rescales, maxMagnitude);
+        int productBits = LevelPlanner::getProductBits(scale, depth, maxMagnitude);
+        parms_id_type parmsId = LevelPlanner::planInputLevel(context, rescales, minBits, productBits);
+        for (CiphertextType& input : inputs) {
+            evaluator->mod_switch_to_inplace(input, parmsId);
+        }
+    }
+
+    /** Relinearizes, rescales and mod-switches the output to the lowest level that holds a result of the given magnitude */
+    void compactOutput(CiphertextType& output, double maxMagnitude) const {
+        ResultCompactor(context, evaluator, relinKeys).compact(output, scale, maxMagnitude);
+    }
+
+    size_t getSerializedSize(const CiphertextType& ciphertext) const {
+        return static_cast<size_t>(ciphertext.save_size());
+    }
+
+    bool supportsLazyRelinearization() const {
+        return relinKeys != nullptr;
+    }
+
+    bool usesRescaling() const {
+        return hasNextLevel;
+    }
+
+    CiphertextType sub(const CiphertextType& a, const CiphertextType& b) const {
+        CiphertextType result;
+        ScaleManager(context, evaluator, scale).sub(a, b, result);
+        return result;
+    }
+
+    CiphertextType add(const CiphertextType& a, const CiphertextType& b) const {
+        CiphertextType result;
+        ScaleManager(context, evaluator, scale).add(a, b, result);
+        return result;
+    }
+
+    /** Rescaling is placed by the circuit, so the operands' levels are aligned but the product is not rescaled */
+    CiphertextType mult(const CiphertextType& a, const CiphertextType& b) const {
+        CiphertextType result;
+        ScaleManager(context, evaluator, scale).alignLevels(a, b, result, [this](const Ciphertext& x, const Ciphertext& y, Ciphertext& product) {
+            evaluator->multiply(x, y, product);
+        });
+        return result;
+    }
+
+    CiphertextType square(const CiphertextType& a) const {
+        CiphertextType result;
+        evaluator->square(a, result);
+        return result;
+    }
+
+    CiphertextType rotate(const CiphertextType& a, int rotation) const {
+        if (galoisKeys == nullptr) {
+            throw logic_error("rotate needs Galois keys: pass them to the constructor or call generateGaloisKeys");
+        }
+        CiphertextType result;
+        evaluator->rotate_vector(a, rotation, *galoisKeys, result);
+        return result;
+    }
+
+    /** SEAL does not expose hoisted rotations, so each rotation switches keys on its own */
+    vector<CiphertextType> rotateMany(const CiphertextType& a, const vector<int>& rotations) const {
+        vector<CiphertextType> rotated;
+        for (int rotation : rotations) {
+            rotated.push_back(rotate(a, rotation));
+        }
+        return rotated;
+    }
+
+    CiphertextType relinearize(const CiphertextType& a) const {
+        CiphertextType result;
+        evaluator->relinearize(a, *relinKeys, result);
+        return result;
+    }
+
+    CiphertextType rescale(const CiphertextType& a) const {
+        CiphertextType result;
+        evaluator->rescale_to_next(a, result);
+        return result;
+    }
+
+private:
+    shared_ptr<SEALContext> context;
+    double scale;
+    TimedEvaluator* evaluator;
+    RelinKeys* relinKeys;
+    GaloisKeys* galoisKeys;
+    bool hasNextLevel;
+
+    // Only set by generateKeys
+    unique_ptr<KeyGenerator> keygen;
+    unique_ptr<Encryptor> encryptor;
+    unique_ptr<Decryptor> decryptor;
+    unique_ptr<CKKSEncoder> encoder;
+    unique_ptr<TimedEvaluator> ownedEvaluator;
+    RelinKeys ownedRelinKeys;
+    GaloisKeys ownedGaloisKeys;
+};
+
+#endif // SEALBACKEND_H
@@ -0,0 +1,116 @@
+#ifndef TIMEDEVALUATOR_H
+#define TIMEDEVALUATOR_H
+
+#include <chrono>
+#include <string>
+#include <seal/seal.h>
+#include "ophistogram.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief An Evaluator that records the latency of every call into an OpProfile, the counterpart of
+ * PALISADE's StartTiming, whose samples are keyed by the same kind of operation names.
+ *
+ * SEAL's Evaluator has no virtual methods, so only calls made through a TimedEvaluator (not through
+ * an Evaluator pointer to one) are timed. Without a profile, calls go straight to the Evaluator.
+ */
+class TimedEvaluator : public Evaluator {
+
+public:
+    TimedEvaluator(shared_ptr<SEALContext> context, OpProfile* opProfile = nullptr) : Evaluator(context), opProfile(opProfile) {};
+    ~TimedEvaluator() {};
+
+    /** Records into `opProfile` from now on; nullptr disables it */
+    void setOpProfile(OpProfile* opProfile) {
+        this->opProfile = opProfile;
+    }
+
+    using Evaluator::add;
+    using Evaluator::add_inplace;
+    using Evaluator::sub;
+    using Evaluator::multiply;
+    using Evaluator::multiply_plain_inplace;
+    using Evaluator::square;
+    using Evaluator::square_inplace;
+    using Evaluator::relinearize;
+    using Evaluator::relinearize_inplace;
+    using Evaluator::rescale_to_next;
+    using Evaluator::rescale_to_next_inplace;
+    using Evaluator::mod_switch_to;
+    using Evaluator::mod_switch_to_inplace;
+    using Evaluator::rotate_vector;
+
+    void add(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination) {
+        time("add", [&]() { Evaluator::add(a, b, destination); });
+    }
+
+    void add_inplace(Ciphertext& a, const Ciphertext& b) {
+        time("add", [&]() { Evaluator::add_inplace(a, b); });
+    }
+
+    void sub(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination) {
+        time("sub", [&]() { Evaluator::sub(a, b, destination); });
+    }
+
+    void multiply(const Ciphertext& a, const Ciphertext& b, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("multiply", [&]() { Evaluator::multiply(a, b, destination, pool); });
+    }
+
+    void multiply_plain_inplace(Ciphertext& a, const Plaintext& plain, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("multiply plain", [&]() { Evaluator::multiply_plain_inplace(a, plain, pool); });
+    }
+
+    void square(const Ciphertext& a, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("square", [&]() { Evaluator::square(a, destination, pool); });
+    }
+
+    void square_inplace(Ciphertext& a, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("square", [&]() { Evaluator::square_inplace(a, pool); });
+    }
+
+    void relinearize(const Ciphertext& a, const RelinKeys& relinKeys, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("relinearize", [&]() { Evaluator::relinearize(a, relinKeys, destination, pool); });
+    }
+
+    void relinearize_inplace(Ciphertext& a, const RelinKeys& relinKeys, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("relinearize", [&]() { Evaluator::relinearize_inplace(a, relinKeys, pool); });
+    }
+
+    void rescale_to_next(const Ciphertext& a, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("rescale", [&]() { Evaluator::rescale_to_next(a, destination, pool); });
+    }
+
+    void rescale_to_next_inplace(Ciphertext& a, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("rescale", [&]() { Evaluator::rescale_to_next_inplace(a, pool); });
+    }
+
+    void mod_switch_to(const Ciphertext& a, parms_id_type parmsId, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("mod switch", [&]() { Evaluator::mod_switch_to(a, parmsId, destination, pool); });
+    }
+
+    void mod_switch_to_inplace(Ciphertext& a, parms_id_type parmsId, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("mod switch", [&]() { Evaluator::mod_switch_to_inplace(a, parmsId, pool); });
+    }
+
+    void rotate_vector(const Ciphertext& a, int steps, const GaloisKeys& galoisKeys, Ciphertext& destination, MemoryPoolHandle pool = MemoryManager::GetPool()) {
+        time("rotate", [&]() { Evaluator::rotate_vector(a, steps, galoisKeys, destination, pool); });
+    }
+
+private:
+    OpProfile* opProfile;
+
+    template <class Operation>
+    void time(const char* operation, const Operation& run) {
+        if (opProfile == nullptr) {
+            run();
+            return;
+        }
+        auto start = chrono::steady_clock::now();
+        run();
+        auto finish = chrono::steady_clock::now();
+        opProfile->add(operation, chrono::duration<double, micro>(finish - start).count());
+    }
+};
+
+#endif // TIMEDEVALUATOR_H
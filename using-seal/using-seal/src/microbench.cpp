@@ -0,0 +1,134 @@
+// microbench.cpp : Benchmarks every primitive the distance computation uses on every parameter set, one primitive
+// at a time, so that a slowdown of the distance computation can be traced to the primitive responsible for it.
+//
+
+#include <iostream>
+#include <sstream>
+#include "../include/params.h"
+#include "../include/scalemanager.h"
+#include "benchmarkharness.h"
+#include "distancecircuit.h"
+#include "header.h"
+
+using namespace std;
+using namespace seal;
+
+/** @brief Benchmarks each primitive on one CKKS parameter set and prints the median, p90 and p99 of every primitive, in us.
+ *
+ *  Every iteration times each primitive once on the same inputs: two fresh ciphertexts, their product for relinearize
+ *  and their relinearized product for rescale. Key generation is done once and is not benchmarked here. Multiply and
+ *  square are not relinearized. Relinearize and rotate need key switching, and rescale a level below the first one,
+ *  so they are left out of the sets whose chains do not have them.
+ */
+void benchmarkPrimitives(double x, double y, CKKSParam value, const BenchmarkHarness& harness) {
+    shared_ptr<SEALContext> context = value.generateContext();
+    double scale = value.getScale();
+    if (!ScaleManager::isValidScale(context, scale)) {
+        scale = ScaleManager::chooseScale(context, DistanceSquaredExpression::depth(), max(x * x, y * y)); // the largest product
+    }
+    bool usingKeySwitching = context->using_keyswitching();
+    bool canRescale = context->first_context_data()->next_context_data() != nullptr;
+
+    KeyGenerator keygen(context);
+    PublicKey publicKey = keygen.public_key();
+    RelinKeys relinKeys;
+    GaloisKeys galoisKeys;
+    if (usingKeySwitching) {
+        relinKeys = keygen.relin_keys_local();
+        galoisKeys = keygen.galois_keys_local(vector<int>{ 1 });
+    }
+    CKKSEncoder encoder(context);
+    Encryptor encryptor(context, publicKey);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, keygen.secret_key());
+
+    Plaintext xPlaintext, yPlaintext;
+    encoder.encode(x, scale, xPlaintext);
+    encoder.encode(y, scale, yPlaintext);
+    Ciphertext xCiphertext, yCiphertext, product, relinearized;
+    encryptor.encrypt(xPlaintext, xCiphertext);
+    encryptor.encrypt(yPlaintext, yCiphertext);
+    evaluator.multiply(xCiphertext, yCiphertext, product);
+    if (usingKeySwitching) {
+        evaluator.relinearize(product, relinKeys, relinearized);
+    }
+    else {
+        relinearized = product;
+    }
+
+    vector<PhaseStats> stats = harness.run([&](PhaseTimer& timer) {
+        Plaintext plaintext;
+        timer.time("encode", [&]() {
+            encoder.encode(x, scale, plaintext);
+        });
+        Ciphertext result;
+        timer.time("encrypt", [&]() {
+            encryptor.encrypt(plaintext, result);
+        });
+        timer.time("add", [&]() {
+            evaluator.add(xCiphertext, yCiphertext, result);
+        });
+        timer.time("sub", [&]() {
+            evaluator.sub(xCiphertext, yCiphertext, result);
+        });
+        timer.time("multiply", [&]() {
+            evaluator.multiply(xCiphertext, yCiphertext, result);
+        });
+        timer.time("square", [&]() {
+            evaluator.square(xCiphertext, result);
+        });
+        if (usingKeySwitching) {
+            timer.time("relinearize", [&]() {
+                evaluator.relinearize(product, relinKeys, result);
+            });
+        }
+        if (canRescale) {
+            timer.time("rescale", [&]() {
+                evaluator.rescale_to_next(relinearized, result);
+            });
+        }
+        if (usingKeySwitching) {
+            timer.time("rotate", [&]() {
+                evaluator.rotate_vector(xCiphertext, 1, galoisKeys, result);
+            });
+        }
+        Plaintext decrypted;
+        timer.time("decrypt", [&]() {
+            decryptor.decrypt(xCiphertext, decrypted);
+        });
+        vector<double> decoded;
+        timer.time("decode", [&]() {
+            encoder.decode(decrypted, decoded);
+        });
+        timer.time("serialize", [&]() {
+            stringstream stream;
+            xCiphertext.save(stream);
+        });
+    });
+    BenchmarkHarness::printReport(stats, 1e3, "us");
+}
+
+/** Runs with [iterations] [warmup iterations], 50 and 5 by default, so that runs are comparable */
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? stoi(argv[1]) : 50;
+    int warmupIterations = argc > 2 ? stoi(argv[2]) : 5;
+    BenchmarkHarness harness(warmupIterations, iterations);
+    cout << "Benchmarking every primitive " << iterations << " times after " << warmupIterations << " warmup iterations\n" << endl;
+
+    // The coordinates of the national stadium, as in the distance computation
+    double xCoord = 1.304;
+    double yCoord = 103.874;
+
+    for (auto& entry : CKKSParam::ParamSets) {
+        printHeader("CKKS", to_string(entry.first), "Benchmarking");
+        try {
+            benchmarkPrimitives(xCoord, yCoord, entry.second, harness);
+        }
+        catch (const exception& e) {
+            cout << "Failed: " << e.what() << "\n" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -3,27 +3,34 @@
 
 #include <iostream>
 #include <chrono>
+#include <numeric>
+#include <sstream>
 #include "../include/paramsrunner.h"
 #include "../include/params.h"
+#include "../include/sealbackend.h"
+#include "benchmarkharness.h"
+#include "distancepipeline.h"
+#include "header.h"
+#include "ophistogram.h"
+#include "paramautotuner.h"
+#include "paramselector.h"
+#include "perfcounters.h"
+#include "regressiongate.h"
+#include "resultswriter.h"
+#include "scalabilitybenchmark.h"
+#include "sweepscheduler.h"
+#include "tracer.h"
 
 using namespace std;
 using namespace seal;
 using namespace chrono;
 
-void printHeader(string schemeName, string setNumber) {
-    string title = "| Running " + schemeName + " " + setNumber + " parameter set... |";
-    string border(title.length(), '-');
-    cout << border << endl;
-    cout << title << endl;
-    cout << border << endl;
-}
-
 steady_clock::time_point getCurrentTime() {
     return steady_clock::now();
 }
 
 template<typename T, class EncoderType, class ParamType>
-void runDistComp(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<T, EncoderType>* paramsRunner) {
+double runDistComp(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<T, EncoderType>* paramsRunner) {
 
     steady_clock::time_point start = getCurrentTime();
     auto context = value.generateContext();
@@ -34,10 +41,38 @@ void runDistComp(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<T, Encode
     steady_clock::time_point finish = getCurrentTime();
     auto diff = duration_cast<milliseconds> (finish - start).count();
     cout << "Total time taken: " << diff << "ms \n" << endl;
+    return static_cast<double>(diff);
+}
+
+/** Computes the average time for running distance computation for one parameter set */
+template<typename T, class EncoderType, class ParamType>
+double computeDistCompAvgTime(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<T, EncoderType>* paramsRunner, int sampleNum) {
+    double totalTime = 0;
+
+    streambuf* old = cout.rdbuf(0); // remove all the print statements when running
+    for (int i = 0; i < sampleNum; i++) {
+        totalTime += runDistComp<T, EncoderType, ParamType>(x1, y1, x2, y2, value, paramsRunner);
+    }
+    cout.rdbuf(old);
+
+    return totalTime / sampleNum;
+}
+
+/** Appends the last run of `paramsRunner` to the results file, if there is one */
+template <typename T, class EncoderType>
+void writeLastRun(ResultsWriter* resultsWriter, const ParamsRunner<T, EncoderType>& paramsRunner, const string& schemeName, int key) {
+    if (resultsWriter == nullptr) {
+        return;
+    }
+    RunRecord record = paramsRunner.getLastRun();
+    record.scheme = schemeName;
+    record.paramSet = to_string(key);
+    resultsWriter->write(record);
 }
 
 template <typename T, class EncoderType, class ParamType>
-void runDistComp(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string schemeName, ParamsRunner<T, EncoderType> paramsRunner) {
+void runDistComp(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string schemeName, ParamsRunner<T, EncoderType> paramsRunner,
+    ResultsWriter* resultsWriter = nullptr) {
     typename map<int, ParamType>::iterator iter;
 
     for (iter = paramSets.begin(); iter != paramSets.end(); iter++) {
@@ -46,10 +81,11 @@ void runDistComp(T x1, T y1, T x2, T y2, map<int, ParamType> paramSets, string s
 
         printHeader(schemeName, to_string(key));
         runDistComp<T, EncoderType, ParamType>(x1, y1, x2, y2, value, &paramsRunner);
+        writeLastRun(resultsWriter, paramsRunner, schemeName, key);
     }
 }
 
-void runDistCompCKKS(double x1, double y1, double x2, double y2) {
+void runDistCompCKKS(double x1, double y1, double x2, double y2, ResultsWriter* resultsWriter = nullptr) {
     string schemeName = "CKKS";
     ParamsRunner<double, CKKSEncoder> paramsRunner;
     /*
@@ -58,12 +94,679 @@ void runDistCompCKKS(double x1, double y1, double x2, double y2) {
             schemeName, &ckksParamsRunner, sampleNum);
     }
     */
-    runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, CKKSParam::ParamSets, schemeName, paramsRunner);
+    runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, CKKSParam::ParamSets, schemeName, paramsRunner, resultsWriter);
+}
+
+/** Predicts the time of one distance computation: key generation, four encryptions, two products and five decryptions */
+double predictDistCompTime(const CKKSParam& value, const CostModel& costModel) {
+    return costModel.estimate(value.getCostShape()).getWorkloadTime(4, 2, 5);
+}
+
+/** @brief Returns the cost model of this host, for comparing predictions with time limits.
+ *
+ *  The synthetic benchmark of CostModel::calibrate only ranks the sets, so the model is then rescaled by
+ *  one real distance computation on the cheapest CKKS set; if that fails, the model is left as it is.
+ */
+CostModel calibrateCostModel(double x1, double y1, double x2, double y2) {
+    CostModel costModel = CostModel::calibrate();
+    auto cheapest = min_element(CKKSParam::ParamSets.begin(), CKKSParam::ParamSets.end(),
+        [&](const pair<const int, CKKSParam>& a, const pair<const int, CKKSParam>& b) {
+            return predictDistCompTime(a.second, costModel) < predictDistCompTime(b.second, costModel);
+        });
+    if (cheapest != CKKSParam::ParamSets.end()) {
+        double predicted = predictDistCompTime(cheapest->second, costModel);
+        ParamsRunner<double, CKKSEncoder> paramsRunner;
+        try {
+            double measured = computeDistCompAvgTime<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, cheapest->second, &paramsRunner, 1);
+            costModel.addObservation(CostFamily::RNS, predicted, measured);
+        }
+        catch (const exception& e) {
+            cout << "Could not calibrate the cost model on set " << cheapest->first << ": " << e.what() << endl;
+        }
+    }
+    cout << "Cost model calibrated: the library takes " << costModel.getCalibration(CostFamily::RNS) << " times the synthetic estimates\n" << endl;
+    return costModel;
+}
+
+/** @brief Runs the CKKS parameter sets concurrently, one process per core, and prints
+ *  the average time taken by each of them. Sets that the cost model predicts to take longer
+ *  than `timeLimit` ms per run are skipped, and the others start from the longest predicted;
+ *  the times measured rescale `costModel`.
+ */
+void runDistCompCKKSTimeCheck(const string& executable, double x1, double y1, double x2, double y2, int sampleNum,
+    const SweepScheduler& scheduler, CostModel& costModel, double timeLimit) {
+    string coords = to_string(x1) + " " + to_string(y1) + " " + to_string(x2) + " " + to_string(y2);
+    vector<SweepTask> tasks;
+    for (auto& entry : CKKSParam::ParamSets) {
+        string key = to_string(entry.first);
+        double predicted = predictDistCompTime(entry.second, costModel);
+        if (timeLimit > 0 && predicted > timeLimit) {
+            cout << "Skipping CKKS " << key << ", as it is predicted to take " << predicted << "ms" << endl;
+            continue;
+        }
+        tasks.push_back({ key, "\"" + executable + "\" --sweep-task " + key + " " + to_string(sampleNum) + " " + coords, predicted });
+    }
+
+    // SEAL evaluates on the calling thread, so every set runs on one thread, pinned to a core of its own
+    cout << "Running each CKKS parameter set " << sampleNum << " times on 1 thread, several sets at a time" << endl;
+    double memoryBoundMPKI;
+    vector<SweepResult> results = scheduler.run(tasks, &memoryBoundMPKI);
+    vector<pair<double, double>> observations;
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& result = results[i];
+        printHeader("CKKS", result.name);
+        cout << "Predicted Time: " << tasks[i].predictedTime << "ms" << endl;
+        if (!result.succeeded) {
+            cout << "Failed to run \n" << endl;
+            continue;
+        }
+        cout << "Average Time Taken: " << result.wallTime << "ms (CPU time: " << result.cpuTime << "ms"
+            << (result.cacheMPKI >= 0 ? ", LLC MPKI: " + to_string(result.cacheMPKI) : "")
+            << (result.rerunInIsolation ? ", rerun in isolation, " + to_string(result.slowdown) + "x as long in parallel" : "")
+            << ") \n" << endl;
+        observations.push_back({ tasks[i].predictedTime, result.wallTime });
+    }
+    SweepScheduler::printMemoryBound(memoryBoundMPKI);
+    costModel.addObservations(CostFamily::RNS, observations);
+    cout << "Cost model recalibrated: the library takes " << costModel.getCalibration(CostFamily::RNS) << " times the synthetic estimates\n" << endl;
+}
+
+/** @brief Runs the time check of a single CKKS parameter set; this is what every sweep task runs.
+ *
+ *  Arguments: --sweep-task <set> <sampleNum> <x1> <y1> <x2> <y2> [--cpu <core>]
+ */
+int runSweepTask(int argc, char* argv[]) {
+    if (argc < 8) {
+        cout << "Usage: --sweep-task <set> <sampleNum> <x1> <y1> <x2> <y2> [--cpu <core>]" << endl;
+        return 1;
+    }
+    int key = stoi(argv[2]);
+    int sampleNum = stoi(argv[3]);
+    if (argc >= 10 && string(argv[8]) == "--cpu") {
+        SweepWorker::pinToCore(stoul(argv[9]));
+    }
+
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+    // Counted in this process, so that the scheduler can tell memory-bound sets, which other tasks slow down
+    PerfCounters perfCounters;
+    perfCounters.start();
+    double cpuStart = SweepWorker::getProcessCpuTime();
+    double avgTime = computeDistCompAvgTime<double, CKKSEncoder, CKKSParam>(stod(argv[4]), stod(argv[5]), stod(argv[6]), stod(argv[7]),
+        CKKSParam::ParamSets.at(key), &paramsRunner, sampleNum);
+    CounterSample counts = perfCounters.stop();
+    SweepWorker::reportResult(avgTime, (SweepWorker::getProcessCpuTime() - cpuStart) / sampleNum,
+        perfCounters.isAvailable() ? counts.getCacheMPKI() : -1);
+    return 0;
+}
+
+/** Returns the key of the smallest CKKS parameter set whose chain supports the given multiplicative depth */
+int selectMinimalCKKSSet(size_t depth) {
+    ParamSelector<CKKSParam> selector([](const CKKSParam& param) { return param.getMaxDepth(); },
+                                      [](const CKKSParam& param) { return param.getPolyModulusDegree(); });
+    return selector.select(CKKSParam::ParamSets, depth);
+}
+
+/** Runs distance computation on the smallest CKKS parameter set whose chain supports
+ *  the multiplicative depth of the distance expression, which is known at compile time
+ */
+void runDistCompCKKSMinimal(double x1, double y1, double x2, double y2, ResultsWriter* resultsWriter = nullptr) {
+    string schemeName = "CKKS";
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+
+    constexpr size_t depth = DistanceSquaredExpression::depth();
+    int key = selectMinimalCKKSSet(depth);
+    cout << "Selected " << schemeName << " parameter set " << key << " for multiplicative depth " << depth << endl;
+
+    printHeader(schemeName, to_string(key));
+    runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, CKKSParam::ParamSets.at(key), &paramsRunner);
+    writeLastRun(resultsWriter, paramsRunner, schemeName, key);
+}
+
+/** Returns the keys of the CKKS sets predicted by `costModel` to take at most `timeLimit` ms per run */
+vector<int> getAffordableSets(const CostModel& costModel, double timeLimit) {
+    vector<int> keys;
+    for (auto& entry : CKKSParam::ParamSets) {
+        if (predictDistCompTime(entry.second, costModel) <= timeLimit) {
+            keys.push_back(entry.first);
+        }
+    }
+    return keys;
+}
+
+/** Measures the precision of every given CKKS parameter set after each level of multiplication, stopping at
+ *  `maxDepth` levels or the levels of its modulus chain, whichever is fewer, or once the precision falls
+ *  under `minPrecisionBits`
+ */
+void runPrecisionCheckCKKS(const vector<int>& keys, double minPrecisionBits, size_t maxDepth) {
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+    for (int key : keys) {
+        CKKSParam value = CKKSParam::ParamSets.at(key);
+        printHeader("CKKS", to_string(key));
+        paramsRunner.runPrecisionCheck(value.generateContext(), value.getScale(), minPrecisionBits, maxDepth);
+        cout << endl;
+    }
+}
+
+/** @brief Benchmarks the distance computation on one CKKS parameter set phase by phase, without any printing
+ *  in the timed code, and prints the median, p90 and p99 of every phase.
+ *
+ *  The evaluation is the step-by-step computation of DistanceComputer: differences, squares rescaled by
+ *  the scale manager, and a single relinearization of the sum.
+ */
+void benchmarkDistCompCKKS(double x1, double y1, double x2, double y2, CKKSParam value, const BenchmarkHarness& harness) {
+    vector<double> coords = { x1, y1, x2, y2 };
+    double maxCoord = max(max(abs(x1), abs(y1)), max(abs(x2), abs(y2)));
+    vector<PhaseStats> stats = harness.run([&](PhaseTimer& timer) {
+        shared_ptr<SEALContext> context;
+        timer.time("context generation", [&]() {
+            context = value.generateContext();
+        });
+        double scale = value.getScale();
+        if (!ScaleManager::isValidScale(context, scale)) {
+            scale = ScaleManager::chooseScale(context, DistanceSquaredExpression::depth(), 8 * maxCoord * maxCoord);
+        }
+
+        unique_ptr<KeyGenerator> keygen;
+        PublicKey publicKey;
+        timer.time("key generation", [&]() {
+            keygen.reset(new KeyGenerator(context));
+            publicKey = keygen->public_key();
+        });
+        RelinKeys relinKeys;
+        bool usingKeySwitching = context->using_keyswitching();
+        timer.time("eval key generation", [&]() {
+            if (usingKeySwitching) {
+                relinKeys = keygen->relin_keys_local();
+            }
+        });
+
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, publicKey);
+        vector<Ciphertext> ciphertexts(coords.size());
+        for (size_t i = 0; i < coords.size(); i++) {
+            Plaintext plaintext;
+            timer.time("encode", [&]() {
+                encoder.encode(coords[i], scale, plaintext);
+            });
+            timer.time("encrypt", [&]() {
+                encryptor.encrypt(plaintext, ciphertexts[i]);
+            });
+        }
+
+        TimedEvaluator evaluator(context);
+        ScaleManager scaleManager(context, &evaluator, scale);
+        Ciphertext distance, yDiff;
+        timer.time("evaluate", [&]() {
+            scaleManager.sub(ciphertexts[0], ciphertexts[2], distance);
+            scaleManager.sub(ciphertexts[1], ciphertexts[3], yDiff);
+            scaleManager.square_inplace(distance);
+            scaleManager.square_inplace(yDiff);
+            scaleManager.add_inplace(distance, yDiff);
+            if (usingKeySwitching) {
+                evaluator.relinearize_inplace(distance, relinKeys);
+            }
+        });
+
+        Decryptor decryptor(context, keygen->secret_key());
+        Plaintext decrypted;
+        timer.time("decrypt", [&]() {
+            decryptor.decrypt(distance, decrypted);
+        });
+        vector<double> decoded;
+        timer.time("decode", [&]() {
+            encoder.decode(decrypted, decoded);
+        });
+    });
+    BenchmarkHarness::printReport(stats);
+}
+
+/** Runs the distance computation `sampleNum` times on one parameter set through a TimedEvaluator
+ *  and prints the latency histogram of every evaluator operation, e.g. square against relinearize
+ */
+template<typename T, class EncoderType, class ParamType>
+void profileDistComp(T x1, T y1, T x2, T y2, ParamType value, ParamsRunner<T, EncoderType>* paramsRunner, int sampleNum) {
+    OpProfile opProfile;
+    paramsRunner->setOpProfile(&opProfile);
+    for (int i = 0; i < sampleNum; i++) {
+        runDistComp<T, EncoderType, ParamType>(x1, y1, x2, y2, value, paramsRunner);
+    }
+    paramsRunner->setOpProfile(nullptr);
+    opProfile.print();
+}
+
+/** Registers every CKKS parameter set that the cost model predicts to take at most `timeLimit` ms per run with the
+ *  unified distance pipeline; by default, all of them
+ */
+void registerBackends(BackendRegistry& registry, const CostModel& costModel = CostModel(),
+    double timeLimit = numeric_limits<double>::infinity()) {
+    for (auto& entry : CKKSParam::ParamSets) {
+        CKKSParam value = entry.second;
+        if (predictDistCompTime(value, costModel) > timeLimit) {
+            continue;
+        }
+        registry.add("SEAL CKKS " + to_string(entry.first), [value]() mutable {
+            unique_ptr<SealBackend> backend(new SealBackend(value.generateContext(), value.getScale()));
+            return unique_ptr<DistanceRunner>(new DistancePipeline<SealBackend>(move(backend)));
+        });
+    }
+}
+
+/** Runs the library-independent distance pipeline on the given registered parameter sets */
+void runDistCompUnified(double x1, double y1, double x2, double y2, const BackendRegistry& registry, vector<string> paramSetNames) {
+    for (string paramSetName : paramSetNames) {
+        printHeader("unified", paramSetName);
+
+        DistanceResult result = registry.create(paramSetName)->run(x1, y1, x2, y2);
+        cout << "Library: " << result.library << ", poly_modulus_degree = " << result.ringDimension << endl;
+        cout << "Distance Squared: " << result.expected << ", Decrypted: " << result.actual << endl;
+        cout << (result.correct ? "Successful" : "Failed") << endl;
+        cout << "Result size: " << result.resultSize << " bytes" << endl;
+        cout << "Evaluation time: " << result.evaluationTime << "ms \n" << endl;
+    }
+}
+
+/** @brief Runs one registered parameter set for the binary of the other library and prints its result (see RemoteDistanceRunner).
+ *
+ *  Arguments: --unified-task <name> <x1> <y1> <x2> <y2>
+ */
+int runUnifiedTask(int argc, char* argv[]) {
+    if (argc < 7) {
+        cout << "Usage: --unified-task <name> <x1> <y1> <x2> <y2>" << endl;
+        return 1;
+    }
+    BackendRegistry registry;
+    registerBackends(registry);
+    DistanceResult result = registry.create(argv[2])->run(stod(argv[3]), stod(argv[4]), stod(argv[5]), stod(argv[6]));
+    RemoteDistanceRunner::reportResult(result);
+    return 0;
+}
+
+/** Lists the parameter sets that the cost model predicts to take at most `timeLimit` ms per run, for the binary of the other library */
+int listBackends(double timeLimit, double x1, double y1, double x2, double y2) {
+    BackendRegistry registry;
+    registerBackends(registry, calibrateCostModel(x1, y1, x2, y2), timeLimit);
+    for (const string& name : registry.getParamSetNames()) {
+        RemoteDistanceRunner::reportParamSetName(name);
+    }
+    return 0;
+}
+
+/** @brief Routes the distance workload of every ring dimension to the fastest parameter set of either library, then runs it there.
+ *
+ *  The sets of this binary that the cost model predicts to take at most `timeLimit` ms per run are measured in process,
+ *  and those that the binary of the other library, `peer`, affords by its own cost model, in that binary.
+ */
+int runRouted(const string& peer, size_t trials, double timeLimit, double x1, double y1, double x2, double y2) {
+    BackendRegistry registry;
+    registerBackends(registry, calibrateCostModel(x1, y1, x2, y2), timeLimit);
+    vector<string> names = registry.getParamSetNames();
+    vector<string> remoteNames = registerRemoteBackends(registry, peer);
+    if (remoteNames.empty()) {
+        cout << peer << " listed no parameter sets; routing among those of SEAL only" << endl;
+    }
+    names.insert(names.end(), remoteNames.begin(), remoteNames.end());
+
+    cout << "Measuring " << names.size() << " parameter sets " << trials << " times each..." << endl;
+    BackendRouter router(trials);
+    router.measure(registry, names, x1, y1, x2, y2);
+    cout << "ROUTES BY RING DIMENSION" << endl;
+    router.printRoutes();
+
+    vector<string> routedNames;
+    for (const auto& entry : router.getRoutes()) {
+        routedNames.push_back(entry.second.paramSetName);
+    }
+    runDistCompUnified(x1, y1, x2, y2, registry, routedNames);
+    return 0;
+}
+
+/** @brief Makes the CKKS search space over poly_modulus_degree, scale (and with it the size of every prime
+ *  in the chain) and chain layout, listing the smallest degrees first.
+ *
+ *  The layouts are the SEAL counterparts of PALISADE's rescaling and key switching techniques: a chain that
+ *  rescales after every product, a chain that never rescales but keeps a special prime for relinearization,
+ *  and a single prime that neither rescales nor switches keys. The first prime holds `integerBits` bits of
+ *  the value on top of the scale it ends up at; candidates above the bit budget of the security level are left out.
+ */
+vector<AutotuneCandidate<CKKSParam>> makeCKKSCandidates(int depth, sec_level_type securityLevel, int integerBits = 20) {
+    vector<AutotuneCandidate<CKKSParam>> candidates;
+    for (size_t polyModulusDegree : { 1024, 2048, 4096, 8192, 16384, 32768 }) {
+        for (int scaleBits : { 20, 30, 40, 50 }) {
+            int first = min(60, scaleBits + integerBits);
+            vector<int> rescaling(1, first);
+            rescaling.insert(rescaling.end(), depth, scaleBits);
+            rescaling.push_back(first);
+
+            int unrescaled = (depth + 1) * scaleBits + integerBits;
+            vector<vector<int>> chains = { rescaling };
+            if (unrescaled <= 60) {
+                chains.push_back({ unrescaled, unrescaled });
+                chains.push_back({ unrescaled });
+            }
+
+            for (const vector<int>& chain : chains) {
+                if (accumulate(chain.begin(), chain.end(), 0) > CoeffModulus::MaxBitCount(polyModulusDegree, securityLevel)) {
+                    continue;
+                }
+                ostringstream name;
+                name << "CKKSParam(" << polyModulusDegree << ", {";
+                for (size_t i = 0; i < chain.size(); i++) {
+                    name << (i == 0 ? " " : ", ") << chain[i];
+                }
+                name << " }, pow(2.0, " << scaleBits << "))";
+                candidates.push_back({ name.str(), CKKSParam(polyModulusDegree, chain, pow(2.0, scaleBits)) });
+            }
+        }
+    }
+    return candidates;
+}
+
+/** @brief Searches the given candidates for the fastest CKKS parameter set that runs the distance workload
+ *  through the unified pipeline within `precision`, and prints it in the form used by params.cpp
+ */
+void runAutotuneCKKS(double x1, double y1, double x2, double y2, const vector<AutotuneCandidate<CKKSParam>>& candidates,
+    double precision, int sampleNum) {
+    ParamAutotuner<CKKSParam> autotuner([](const CKKSParam& param) {
+        CKKSParam value = param;
+        unique_ptr<SealBackend> backend(new SealBackend(value.generateContext(), value.getScale()));
+        return unique_ptr<DistanceRunner>(new DistancePipeline<SealBackend>(move(backend)));
+    }, precision, sampleNum);
+
+    cout << "Searching " << candidates.size() << " CKKS candidates..." << endl;
+    try {
+        size_t best = autotuner.tune(candidates, x1, y1, x2, y2);
+        autotuner.printResults();
+        const AutotuneResult& result = autotuner.getResults()[best];
+        cout << "Fastest correct CKKS configuration (poly_modulus_degree = " << result.ringDimension << ", "
+            << result.avgTime << "ms):" << endl;
+        cout << candidates[best].name << "\n" << endl;
+    }
+    catch (const runtime_error& e) {
+        autotuner.printResults();
+        cout << e.what() << "\n" << endl;
+    }
 }
 
-int main()
+/** Runs the distance computation `runs` times on one CKKS parameter set, without printing, and collects the runs */
+void collectRunsCKKS(double x1, double y1, double x2, double y2, int key, int runs, vector<RunRecord>& records, ResultsWriter* resultsWriter) {
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+    for (int i = 0; i < runs; i++) {
+        streambuf* old = cout.rdbuf(0);
+        runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, CKKSParam::ParamSets.at(key), &paramsRunner);
+        cout.rdbuf(old);
+
+        RunRecord record = paramsRunner.getLastRun();
+        record.scheme = "CKKS";
+        record.paramSet = to_string(key);
+        records.push_back(record);
+        if (resultsWriter != nullptr) {
+            resultsWriter->write(record);
+        }
+    }
+}
+
+/** @brief Records a baseline for the regression gate: runs every CKKS parameter set that the cost model predicts
+ *  to take at most `timeLimit` ms per run `runs` times and writes the runs to `path`.
+ *
+ *  @param runs if 0, as many as the gate needs to detect a single regressed set among them, and at least 10
+ */
+int recordBaseline(const string& path, int runs, double timeLimit, double x1, double y1, double x2, double y2) {
+    ResultsWriter resultsWriter(path);
+    CostModel costModel = calibrateCostModel(x1, y1, x2, y2);
+    vector<RunRecord> records;
+    vector<int> keys = getAffordableSets(costModel, timeLimit);
+    int requiredRuns = static_cast<int>(RegressionGate().getRequiredRuns(keys.size()));
+    if (runs <= 0) {
+        runs = max(10, requiredRuns);
+    }
+    else if (runs < requiredRuns) {
+        cout << "With " << runs << " runs the gate cannot detect a single regressed set among " << keys.size()
+            << "; record at least " << requiredRuns << endl;
+    }
+    for (int key : keys) {
+        cout << "Recording CKKS " << key << " (" << runs << " runs)..." << endl;
+        collectRunsCKKS(x1, y1, x2, y2, key, runs, records, &resultsWriter);
+    }
+    cout << "Recorded " << records.size() << " runs in " << path << endl;
+    return 0;
+}
+
+/** @brief Runs every SEAL parameter set of the baseline as many times as the baseline did and compares
+ *  the total times of every set; returns 1 if any of them regressed or is missing (see RegressionGate), or if the
+ *  baseline cannot be read, 0 otherwise.
+ *
+ *  @param resultsPath if not empty, the fresh runs are also written there, e.g. to become the next baseline
+ */
+int runRegressionGate(const string& baselinePath, const string& resultsPath, double x1, double y1, double x2, double y2) {
+    // Only the SEAL runs of the baseline are compared; a file that cannot be read fails the gate
+    vector<RunRecord> baseline;
+    map<int, int> runsPerSet;
+    try {
+        for (const RunRecord& record : ResultsReader::read(baselinePath)) {
+            if (record.library == "SEAL" && record.scheme == "CKKS") {
+                baseline.push_back(record);
+                runsPerSet[stoi(record.paramSet)]++;
+            }
+        }
+    }
+    catch (const exception& e) {
+        cout << "Could not read the baseline " << baselinePath << ": " << e.what() << endl;
+        return 1;
+    }
+    if (runsPerSet.empty()) {
+        cout << "The baseline " << baselinePath << " has no SEAL runs" << endl;
+        return 1;
+    }
+
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (!resultsPath.empty()) {
+        resultsWriter.reset(new ResultsWriter(resultsPath));
+    }
+    vector<RunRecord> current;
+    for (auto& entry : runsPerSet) {
+        cout << "Running CKKS " << entry.first << " (" << entry.second << " runs)..." << endl;
+        if (CKKSParam::ParamSets.count(entry.first) == 0) {
+            cout << "No such parameter set, so its phases are missing" << endl;
+            continue;
+        }
+        collectRunsCKKS(x1, y1, x2, y2, entry.first, entry.second, current, resultsWriter.get());
+    }
+
+    vector<RegressionResult> results = RegressionGate().compare(baseline, current);
+    RegressionGate::printReport(results);
+    bool regressed = RegressionGate::hasRegression(results);
+    cout << (regressed ? "REGRESSION DETECTED" : "NO REGRESSION") << endl;
+    return regressed ? 1 : 0;
+}
+
+/** @brief Counts cycles, instructions, cache misses and branch misses over every phase of the distance computation on
+ *  every CKKS parameter set, however long it takes, as the largest ring dimensions are the ones that show a memory bound;
+ *  the runner prints the counts after each run. Returns 1 if no counter is available.
+ *
+ *  A phase whose IPC drops and whose cache MPKI rises with the ring dimension is bound by memory bandwidth rather than compute.
+ *  @param resultsPath if not empty, the runs are also written there, with their counts
+ */
+int runPerfCounters(const string& resultsPath, double x1, double y1, double x2, double y2) {
+    PerfCounters perfCounters;
+    if (!perfCounters.isAvailable()) {
+        cout << "No hardware counter is available; perf_event_open needs Linux and perf_event_paranoid at most 2" << endl;
+        return 1;
+    }
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (!resultsPath.empty()) {
+        resultsWriter.reset(new ResultsWriter(resultsPath));
+    }
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+    paramsRunner.setPerfCounters(&perfCounters);
+    for (auto& entry : CKKSParam::ParamSets) {
+        printHeader("CKKS", to_string(entry.first));
+        runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, entry.second, &paramsRunner);
+        writeLastRun(resultsWriter.get(), paramsRunner, "CKKS", entry.first);
+    }
+    return 0;
+}
+
+/** @brief Traces the distance computation on every CKKS parameter set that the cost model predicts to take at most a minute
+ *  per run, step by step and then through the optimized circuit, whose concurrent branches are traced on their own threads,
+ *  and writes the spans to `path` as Chrome trace events.
+ *
+ *  Every run is within a span of its parameter set, of which context generation is the part before its runDistComp span.
+ */
+int runTrace(const string& path, double x1, double y1, double x2, double y2) {
+    Tracer tracer;
+    CostModel costModel = calibrateCostModel(x1, y1, x2, y2);
+    double timeLimit = 60000; // in ms
+
+    ParamsRunner<double, CKKSEncoder> paramsRunner;
+    paramsRunner.setTracer(&tracer);
+    for (bool useCircuit : { false, true }) {
+        paramsRunner.setUseCircuit(useCircuit);
+        for (auto& entry : CKKSParam::ParamSets) {
+            if (predictDistCompTime(entry.second, costModel) > timeLimit) {
+                continue;
+            }
+            printHeader("CKKS", to_string(entry.first));
+            Tracer::Span span(&tracer, "CKKS " + to_string(entry.first) + (useCircuit ? " circuit" : ""), "parameter set");
+            runDistComp<double, CKKSEncoder, CKKSParam>(x1, y1, x2, y2, entry.second, &paramsRunner);
+        }
+    }
+
+    if (!tracer.write(path)) {
+        cout << "Could not write the trace to " << path << endl;
+        return 1;
+    }
+    cout << "Wrote " << tracer.getSpanCount() << " spans to " << path << endl;
+    return 0;
+}
+
+/** Returns the time in ms per batch of `batchSize` distances, all between the same two points, as `workers` threads
+ *  with their own encoder, encryptor, evaluator, decryptor and memory pool but the same keys each encode, encrypt,
+ *  evaluate, decrypt and decode `batchesPerWorker` batches
+ */
+double timeDistCompBatches(shared_ptr<SEALContext> context, double scale, const PublicKey& publicKey, const SecretKey& secretKey,
+    const RelinKeys* relinKeys, const vector<double>& coords, size_t workers, size_t batchSize, size_t batchesPerWorker) {
+    auto worker = [&]() {
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, publicKey);
+        TimedEvaluator evaluator(context);
+        ScaleManager scaleManager(context, &evaluator, scale);
+        Decryptor decryptor(context, secretKey);
+        vector<Ciphertext> ciphertexts(coords.size());
+        Plaintext plaintext;
+        Ciphertext distance, yDiff;
+        vector<double> decoded;
+        for (size_t batch = 0; batch < batchesPerWorker; batch++) {
+            for (size_t i = 0; i < coords.size(); i++) {
+                encoder.encode(vector<double>(batchSize, coords[i]), scale, plaintext);
+                encryptor.encrypt(plaintext, ciphertexts[i]);
+            }
+            scaleManager.sub(ciphertexts[0], ciphertexts[2], distance);
+            scaleManager.sub(ciphertexts[1], ciphertexts[3], yDiff);
+            scaleManager.square_inplace(distance);
+            scaleManager.square_inplace(yDiff);
+            scaleManager.add_inplace(distance, yDiff);
+            if (relinKeys != nullptr) {
+                evaluator.relinearize_inplace(distance, *relinKeys);
+            }
+            decryptor.decrypt(distance, plaintext);
+            encoder.decode(plaintext, decoded);
+        }
+    };
+
+    // Switches the global profile once, for all workers: every allocation of a worker then comes from a pool of its
+    // own instead of the global pool, whose mutex the workers would otherwise contend for. The guard holds the
+    // profile mutex until the workers are joined, so it must not be constructed by the workers themselves.
+    MMProfGuard poolGuard(make_unique<MMProfThreadLocal>());
+    steady_clock::time_point start = getCurrentTime();
+    vector<thread> threads;
+    for (size_t i = 0; i < workers; i++) {
+        threads.emplace_back(worker);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    return duration_cast<microseconds>(getCurrentTime() - start).count() / 1000.0 / (workers * batchesPerWorker);
+}
+
+/** @brief Measures the distance throughput on every CKKS parameter set that the cost model predicts to take at most
+ *  `timeLimit` ms per run, sweeping the number of worker threads from 1 to the number of physical cores and the batch
+ *  size from 1 distance to a full ciphertext of poly_modulus_degree / 2 slots, and prints the throughput and efficiency curves.
+ *
+ *  SEAL evaluates every operation on the calling thread, so the workers share out independent batches. Each worker
+ *  allocates from a thread-local memory pool, so a ring dimension that stops scaling does so on what the cores
+ *  still share, such as the last-level cache and memory bandwidth, not on the lock of the global pool.
+ *  @param csvPath if not empty, the points are also written there as CSV
+ */
+int runScalability(const string& csvPath, double timeLimit, double x1, double y1, double x2, double y2) {
+    unique_ptr<ofstream> csv;
+    if (!csvPath.empty()) {
+        csv.reset(new ofstream(csvPath));
+        if (!*csv) {
+            cout << "Could not open " << csvPath << endl;
+            return 1;
+        }
+        *csv << ScalabilityBenchmark::getCSVHeader() << "\n";
+    }
+    vector<double> coords = { x1, y1, x2, y2 };
+    double maxCoord = max(max(abs(x1), abs(y1)), max(abs(x2), abs(y2)));
+    size_t batchesPerWorker = 2;
+    ScalabilityBenchmark benchmark;
+    vector<size_t> threadCounts = ScalabilityBenchmark::getThreadCounts();
+    CostModel costModel = calibrateCostModel(x1, y1, x2, y2);
+
+    for (auto& entry : CKKSParam::ParamSets) {
+        if (predictDistCompTime(entry.second, costModel) > timeLimit) {
+            continue;
+        }
+        printHeader("CKKS", to_string(entry.first));
+        try {
+            shared_ptr<SEALContext> context = entry.second.generateContext();
+            double scale = entry.second.getScale();
+            if (!ScaleManager::isValidScale(context, scale)) {
+                scale = ScaleManager::chooseScale(context, DistanceSquaredExpression::depth(), 8 * maxCoord * maxCoord);
+            }
+            KeyGenerator keygen(context);
+            PublicKey publicKey = keygen.public_key();
+            RelinKeys relinKeys;
+            if (context->using_keyswitching()) {
+                relinKeys = keygen.relin_keys_local();
+            }
+            const RelinKeys* relinKeysPtr = context->using_keyswitching() ? &relinKeys : nullptr;
+
+            size_t ringDimension = entry.second.getPolyModulusDegree();
+            vector<ScalabilityPoint> points = benchmark.run(threadCounts, ScalabilityBenchmark::getBatchSizes(ringDimension / 2),
+                [&](size_t threads, size_t batchSize) {
+                    return timeDistCompBatches(context, scale, publicKey, keygen.secret_key(), relinKeysPtr, coords, threads, batchSize,
+                        batchesPerWorker);
+                });
+            ScalabilityBenchmark::printCurves(points);
+            if (csv) {
+                ScalabilityBenchmark::writeCSV(*csv, "SEAL", "CKKS", to_string(entry.first), ringDimension, points);
+            }
+        }
+        catch (const exception& e) {
+            cout << "Skipped: " << e.what() << endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
 {
-    
+    if (argc > 1 && string(argv[1]) == "--sweep-task") {
+        return runSweepTask(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--unified-task") {
+        return runUnifiedTask(argc, argv);
+    }
+
+    // With --results <file>, every run of the distance computation is also appended to the file,
+    // as CSV if its name ends in ".csv" and as JSON lines otherwise
+    unique_ptr<ResultsWriter> resultsWriter;
+    if (argc > 2 && string(argv[1]) == "--results") {
+        resultsWriter.reset(new ResultsWriter(argv[2]));
+    }
+
     // The coordinates of the national stadium are
     // Latitude: 1.3044172525405884 or 1304.4172525405884 x 10^{-3}
     // Longitude: 103.87432861328125 or 103874.32861328125 x 10^{-3}
@@ -75,6 +778,79 @@ int main()
     double dsoXCoordDouble = 1.290;
     double dsoYCoordDouble = 103.789;
 
-    runDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    // --record-baseline <file> [runs] and --regression-gate <baseline> [<results>] compare sweeps of the same coordinates
+    if (argc > 2 && string(argv[1]) == "--record-baseline") {
+        double timeLimit = 10000; // in ms per run, so that a baseline of 10 runs per set stays affordable
+        return recordBaseline(argv[2], argc > 3 ? stoi(argv[3]) : 0, timeLimit, stadiumXCoordDouble, stadiumYCoordDouble,
+            dsoXCoordDouble, dsoYCoordDouble);
+    }
+    if (argc > 2 && string(argv[1]) == "--regression-gate") {
+        return runRegressionGate(argv[2], argc > 3 ? argv[3] : "", stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    }
+    // --perf-counters [<results>] reports hardware counters per phase and parameter set instead of the usual runs
+    if (argc > 1 && string(argv[1]) == "--perf-counters") {
+        return runPerfCounters(argc > 2 ? argv[2] : "", stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    }
+    // --trace <file> writes the spans of every stage of the distance computation, to be opened in chrome://tracing
+    if (argc > 2 && string(argv[1]) == "--trace") {
+        return runTrace(argv[2], stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    }
+    // --list-backends and --route <peer> [trials] route every ring dimension to the faster library, with the PALISADE binary as peer
+    if (argc > 1 && string(argv[1]) == "--list-backends") {
+        double timeLimit = 10000; // in ms per run, as every listed set is measured a few times
+        return listBackends(timeLimit, stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    }
+    if (argc > 2 && string(argv[1]) == "--route") {
+        double timeLimit = 10000; // in ms per run, as for --list-backends
+        return runRouted(argv[2], argc > 3 ? stoul(argv[3]) : 3, timeLimit, stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble,
+            dsoYCoordDouble);
+    }
+    // --scalability [<csv>] sweeps worker threads and batch sizes to size machines, instead of the usual runs
+    if (argc > 1 && string(argv[1]) == "--scalability") {
+        double timeLimit = 10000; // in ms per run, as every set is run a few times per thread count and batch size
+        return runScalability(argc > 2 ? argv[2] : "", timeLimit, stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble,
+            dsoYCoordDouble);
+    }
+
+    runDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, resultsWriter.get());
+
+    int sampleNum = 5; // number of times to run each parameter set
+    SweepScheduler scheduler;
+    CostModel costModel = calibrateCostModel(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble);
+    double timeLimit = 60000; // in ms
+    runDistCompCKKSTimeCheck(argv[0], stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, sampleNum, scheduler,
+        costModel, timeLimit);
+
+    runDistCompCKKSMinimal(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, resultsWriter.get());
+
+    BenchmarkHarness harness(2, 20); // 2 warmup iterations, 20 recorded ones
+    int minimalKey = selectMinimalCKKSSet(DistanceSquaredExpression::depth());
+    printHeader("benchmark CKKS", to_string(minimalKey));
+    benchmarkDistCompCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, CKKSParam::ParamSets.at(minimalKey),
+        harness);
+
+    ParamsRunner<double, CKKSEncoder> profiledParamsRunner;
+    printHeader("profile CKKS", to_string(minimalKey));
+    profileDistComp<double, CKKSEncoder, CKKSParam>(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble,
+        CKKSParam::ParamSets.at(minimalKey), &profiledParamsRunner, sampleNum);
+
+    BackendRegistry registry;
+    registerBackends(registry, costModel, timeLimit);
+    runDistCompUnified(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, registry, registry.getParamSetNames());
+
+    // As for PALISADE; every chain here has fewer levels, which cap the check first. The precision check and the
+    // autotuner skip the same sets, and candidates, as the time check
+    double minPrecisionBits = 10;
+    size_t maxDepth = 32;
+    runPrecisionCheckCKKS(getAffordableSets(costModel, timeLimit), minPrecisionBits, maxDepth);
+
+    double precision = 0.000001; // as for the unified pipeline
+    vector<AutotuneCandidate<CKKSParam>> candidates;
+    for (const AutotuneCandidate<CKKSParam>& candidate : makeCKKSCandidates(DistanceSquaredExpression::depth(), sec_level_type::tc128)) {
+        if (predictDistCompTime(candidate.param, costModel) <= timeLimit) {
+            candidates.push_back(candidate);
+        }
+    }
+    runAutotuneCKKS(stadiumXCoordDouble, stadiumYCoordDouble, dsoXCoordDouble, dsoYCoordDouble, candidates, precision, 3);
 
 }
\ No newline at end of file
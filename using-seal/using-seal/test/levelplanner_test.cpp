@@ -0,0 +1,53 @@
+// levelplanner_test.cpp : Tests of LevelPlanner on modulus chains whose rescaling primes are smaller than the scale.
+//
+
+#include "levelplanner.h"
+#include "params.h"
+#include "testing.h"
+
+namespace {
+
+const double Scale = pow(2.0, 40);
+
+size_t getChainIndex(shared_ptr<SEALContext> context, parms_id_type parmsId) {
+    return context->get_context_data(parmsId)->chain_index();
+}
+
+}
+
+TEST(requiredBitsCountTheScaleAndTheMagnitude) {
+    // 2^40 scale and 2^10 magnitude, once rescaled: 40 + ceil(log2(1025)) + 1
+    CHECK(LevelPlanner::getRequiredBits(Scale, 1, 1, 1024) == 52);
+    // Not rescaled, the product carries the square of the scale
+    CHECK(LevelPlanner::getRequiredBits(Scale, 1, 0, 1024) == 92);
+    CHECK(LevelPlanner::getProductBits(Scale, 1, 1024) == 92);
+    CHECK(LevelPlanner::getProductBits(Scale, 0, 1024) == 0);
+}
+
+TEST(inputLevelLeavesRoomForTheFirstProduct) {
+    // Data levels of 120, 90 and 60 bits: after its rescale, the level of 90 bits still fits the result,
+    // but the product of two 2^40-scaled inputs needs 92 bits before the rescale
+    auto context = CKKSParam(8192, { 60, 30, 30, 60 }).generateContext();
+    int minBits = LevelPlanner::getRequiredBits(Scale, 1, 1, 1024);
+    CHECK(getChainIndex(context, LevelPlanner::planInputLevel(context, 1, minBits, 0)) == 1);
+    int productBits = LevelPlanner::getProductBits(Scale, 1, 1024);
+    CHECK(getChainIndex(context, LevelPlanner::planInputLevel(context, 1, minBits, productBits)) == 2);
+}
+
+TEST(inputLevelDropsTheLevelsTheCircuitDoesNotUse) {
+    // Data levels of 220 down to 60 bits in steps of 40: a circuit of depth 1 needs only the two lowest
+    auto context = CKKSParam(16384, { 60, 40, 40, 40, 40, 60 }).generateContext();
+    int minBits = LevelPlanner::getRequiredBits(Scale, 1, 1, 1024);
+    int productBits = LevelPlanner::getProductBits(Scale, 1, 1024);
+    CHECK(getChainIndex(context, LevelPlanner::planInputLevel(context, 1, minBits, productBits)) == 1);
+    // Without a rescale, the result keeps the square of the scale at the level it was computed at
+    int unrescaledBits = LevelPlanner::getRequiredBits(Scale, 1, 0, 1024);
+    CHECK(getChainIndex(context, LevelPlanner::planInputLevel(context, 0, unrescaledBits, productBits)) == 1);
+}
+
+TEST(lowestLevelStillHoldsTheResult) {
+    auto context = CKKSParam(16384, { 60, 40, 40, 40, 40, 60 }).generateContext();
+    int minBits = LevelPlanner::getRequiredBits(Scale, 0, 0, 1024);
+    CHECK(getChainIndex(context, LevelPlanner::planLowestLevel(context, context->first_parms_id(), minBits)) == 0);
+    CHECK(getChainIndex(context, LevelPlanner::planLowestLevel(context, context->first_parms_id(), 61)) == 1);
+}
@@ -0,0 +1,128 @@
+// scalemanager_test.cpp : Tests of ScaleManager's choice of scale, its rescale plan, and its alignment of operands.
+//
+
+#include "params.h"
+#include "scalemanager.h"
+#include "testing.h"
+
+namespace {
+
+const double Magnitude = 1024;
+
+/** Keys and the objects that use them, for one context and encoding scale */
+struct Environment {
+    shared_ptr<SEALContext> context;
+    KeyGenerator keygen;
+    RelinKeys relinKeys;
+    Encryptor encryptor;
+    Decryptor decryptor;
+    CKKSEncoder encoder;
+    TimedEvaluator evaluator;
+    ScaleManager scaleManager;
+
+    Environment(shared_ptr<SEALContext> context, double scale)
+        : context(context), keygen(context), relinKeys(keygen.relin_keys_local()), encryptor(context, keygen.public_key()),
+          decryptor(context, keygen.secret_key()), encoder(context), evaluator(context), scaleManager(context, &evaluator, scale) {};
+
+    Ciphertext encrypt(const vector<double>& values) {
+        Plaintext plaintext;
+        encoder.encode(values, scaleManager.getScale(), plaintext);
+        Ciphertext ciphertext;
+        encryptor.encrypt(plaintext, ciphertext);
+        return ciphertext;
+    }
+
+    vector<double> decrypt(const Ciphertext& ciphertext) {
+        Plaintext plaintext;
+        decryptor.decrypt(ciphertext, plaintext);
+        vector<double> values;
+        encoder.decode(plaintext, values);
+        return values;
+    }
+
+    size_t getChainIndex(const Ciphertext& ciphertext) const {
+        return context->get_context_data(ciphertext.parms_id())->chain_index();
+    }
+};
+
+const vector<double> X{ 1.5, -2, 3 };
+const vector<double> Y{ 0.5, 4, -1 };
+
+/** Checks that the first slots of `values` are x * y + x */
+void checkProductPlusInput(const vector<double>& values, double tolerance) {
+    for (size_t i = 0; i < X.size(); i++) {
+        CHECK_NEAR(values[i], X[i] * Y[i] + X[i], tolerance);
+    }
+}
+
+}
+
+TEST(scaleIsThePrimeSizeWhenTheChainHasAPrimePerProduct) {
+    auto context = CKKSParam(8192, { 60, 40, 40, 60 }).generateContext();
+    CHECK(ScaleManager::chooseScale(context, 2, Magnitude) == pow(2.0, 40));
+}
+
+TEST(scaleFitsTheModulusWhenTheFirstPrimeCannotHoldTheResult) {
+    // The first prime of 45 bits cannot hold 40 bits of scale and 11 of magnitude, so the scale is
+    // the largest power of two whose fourth power, after two products, fits the 125 bits with the magnitude
+    auto context = CKKSParam(8192, { 45, 40, 40, 60 }).generateContext();
+    double scale = ScaleManager::chooseScale(context, 2, Magnitude);
+    CHECK(scale == pow(2.0, 28));
+    CHECK(ScaleManager::isValidScale(context, scale));
+}
+
+TEST(scaleMustLeaveRoomInTheModulus) {
+    auto context = CKKSParam(8192, { 60, 40, 40, 60 }).generateContext();
+    CHECK(ScaleManager::isValidScale(context, pow(2.0, 40)));
+    CHECK(!ScaleManager::isValidScale(context, pow(2.0, 140)));
+    CHECK(!ScaleManager::isValidScale(context, 0));
+}
+
+TEST(productsAreRescaledWhileTheChainHasLevels) {
+    auto context = CKKSParam(8192, { 60, 40, 40, 60 }).generateContext();
+    CHECK(ScaleManager::getPlannedRescales(context, pow(2.0, 40), 1) == 1);
+    CHECK(ScaleManager::getPlannedRescales(context, pow(2.0, 40), 2) == 2);
+    // The last level has nothing left to rescale into
+    CHECK(ScaleManager::getPlannedRescales(context, pow(2.0, 40), 3) == 2);
+}
+
+TEST(productsBelowThePrimeSizeAreNotRescaled) {
+    // A product of two 2^20-scaled values would drop to a scale of about 1 if rescaled by a 40-bit prime
+    auto context = CKKSParam(8192, { 60, 40, 40, 60 }).generateContext();
+    CHECK(ScaleManager::getPlannedRescales(context, pow(2.0, 20), 1) == 0);
+    CHECK(ScaleManager::getPlannedRescales(context, pow(2.0, 20), 2) == 1);
+}
+
+TEST(rescaledProductIsAlignedWithAFreshInput) {
+    Environment environment(CKKSParam(8192, { 60, 40, 40, 60 }).generateContext(), pow(2.0, 40));
+    Ciphertext x = environment.encrypt(X);
+    Ciphertext y = environment.encrypt(Y);
+    Ciphertext product;
+    environment.scaleManager.multiply(x, y, product);
+    environment.evaluator.relinearize_inplace(product, environment.relinKeys);
+    CHECK(environment.getChainIndex(product) == environment.getChainIndex(x) - 1);
+
+    // The product is a level below x, at a scale only close to 2^40
+    Ciphertext sum;
+    environment.scaleManager.add(product, x, sum);
+    CHECK(environment.getChainIndex(sum) == environment.getChainIndex(product));
+    checkProductPlusInput(environment.decrypt(sum), 1e-3);
+}
+
+TEST(unrescaledProductIsBroughtToTheScaleOfAFreshInput) {
+    // At a scale of 2^20 the product keeps its scale of 2^40, so x has to be brought to it first
+    Environment environment(CKKSParam(8192, { 60, 40, 40, 60 }).generateContext(), pow(2.0, 20));
+    Ciphertext x = environment.encrypt(X);
+    Ciphertext y = environment.encrypt(Y);
+    Ciphertext product;
+    environment.scaleManager.multiply(x, y, product);
+    environment.evaluator.relinearize_inplace(product, environment.relinKeys);
+    CHECK(environment.getChainIndex(product) == environment.getChainIndex(x));
+
+    Ciphertext sum;
+    environment.scaleManager.add(x, product, sum);
+    // Multiplying x by 1 and rescaling it costs it a level
+    CHECK(sum.scale() == product.scale());
+    CHECK(environment.getChainIndex(sum) == environment.getChainIndex(x) - 1);
+    checkProductPlusInput(environment.decrypt(sum), 1e-2);
+}